@@ -0,0 +1,365 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FT232H.h"
+#include "RA8875.h"
+#include "RA8875Emulator.h"
+#include "TimingModel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+//
+// Repeatable RA8875 benchmarks.  Every scenario runs a fixed number of
+// operations with a fixed random seed and reports throughput, USB traffic
+// per operation and the latency distribution, as a table and optionally as
+// JSON.  Runs against an FT232H, the emulator, or the emulator's timing
+// model (in which case times are the model's predictions).
+//
+
+struct Result
+{
+	std::string name;
+	size_t   ops;
+	double   seconds;
+	hw::TransferStats traffic;
+	double   p50Us;
+	double   p99Us;
+};
+
+// xorshift32, so runs are identical on every platform.
+static uint32_t s_random = 1;
+
+static uint32_t nextRandom()
+{
+	s_random ^= s_random << 13;
+	s_random ^= s_random >> 17;
+	s_random ^= s_random << 5;
+	return s_random;
+}
+
+static uint16_t randomBelow(uint16_t n)
+{
+	return uint16_t(nextRandom() % n);
+}
+
+// Nearest rank percentile of sorted samples.
+static double percentile(const std::vector<double>& sorted, double q)
+{
+	if (sorted.empty())
+		return 0;
+	size_t rank = size_t(q * sorted.size() + 0.999999);
+	return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+class Bench
+{
+public:
+	Bench(hw::IDevice& device, hw::RA8875& tft, hw::TimingModel* model)
+		: m_device(&device)
+		, m_tft(&tft)
+		, m_model(model)
+	{
+	}
+
+	///
+	/// Time 'ops' calls of 'op'.  'load' runs before each call, untimed but
+	/// with its traffic counted: input set up for the call, or other work
+	/// for scenarios measured under load.
+	///
+	void run(const char* name, size_t ops, const std::function<void(size_t)>& op, const std::function<void(size_t)>& load = nullptr)
+	{
+		std::vector<double> latency;
+		latency.reserve(ops);
+
+		m_tft->flush();
+		m_device->resetTransferStats();
+		double start = now();
+		double loadTime = 0;
+
+		for (size_t i = 0; i < ops; ++i)
+		{
+			if (load)
+			{
+				double t = now();
+				load(i);
+				loadTime += now() - t;
+			}
+
+			double t = now();
+			op(i);
+			latency.push_back(now() - t);
+		}
+		m_tft->flush();
+
+		Result r;
+		r.name = name;
+		r.ops = ops;
+		r.seconds = (now() - start - loadTime) / 1e6;
+		r.traffic = m_device->transferStats();
+		std::sort(latency.begin(), latency.end());
+		r.p50Us = percentile(latency, 0.50);
+		r.p99Us = percentile(latency, 0.99);
+		m_results.push_back(r);
+	}
+
+	const std::vector<Result>& results() const { return m_results; }
+
+private:
+	// Microseconds, real or predicted.
+	double now() const
+	{
+		if (m_model != nullptr)
+			return m_model->elapsedUs();
+
+		using namespace std::chrono;
+		return duration_cast<duration<double, std::micro>>(steady_clock::now().time_since_epoch()).count();
+	}
+
+private:
+	hw::IDevice*      m_device;
+	hw::RA8875*       m_tft;
+	hw::TimingModel*  m_model;
+	std::vector<Result> m_results;
+};
+
+static bool selected(const std::vector<const char*>& filters, const char* name)
+{
+	if (filters.empty())
+		return true;
+	for (const char* f : filters)
+	{
+		if (strncmp(name, f, strlen(f)) == 0)
+			return true;
+	}
+	return false;
+}
+
+static void printTable(const std::vector<Result>& results)
+{
+	printf("%-20s %7s %10s %10s %12s %10s %10s\n",
+		"scenario", "ops", "ops/s", "bytes/op", "transfers/op", "p50 us", "p99 us");
+	for (const Result& r : results)
+	{
+		printf("%-20s %7zu %10.1f %10.1f %12.2f %10.1f %10.1f\n",
+			r.name.c_str(), r.ops, r.seconds > 0 ? r.ops / r.seconds : 0,
+			double(r.traffic.bytesWritten + r.traffic.bytesRead) / r.ops,
+			double(r.traffic.writes + r.traffic.reads) / r.ops,
+			r.p50Us, r.p99Us);
+	}
+}
+
+static bool writeJson(const char* path, const char* device, size_t iterations, uint32_t seed, const std::vector<Result>& results)
+{
+	FILE* f = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+	if (f == nullptr)
+	{
+		fprintf(stderr, "Unable to write %s\n", path);
+		return false;
+	}
+
+	fprintf(f, "{\n  \"device\": \"%s\",\n  \"iterations\": %zu,\n  \"seed\": %u,\n  \"scenarios\": [\n", device, iterations, seed);
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const Result& r = results[i];
+		fprintf(f, "    { \"name\": \"%s\", \"ops\": %zu, \"seconds\": %.6f, \"opsPerSec\": %.3f, "
+			"\"bytesWritten\": %zu, \"bytesRead\": %zu, \"bytesPerOp\": %.3f, "
+			"\"writes\": %zu, \"reads\": %zu, \"transfersPerOp\": %.3f, "
+			"\"p50Us\": %.3f, \"p99Us\": %.3f }%s\n",
+			r.name.c_str(), r.ops, r.seconds, r.seconds > 0 ? r.ops / r.seconds : 0,
+			r.traffic.bytesWritten, r.traffic.bytesRead, double(r.traffic.bytesWritten + r.traffic.bytesRead) / r.ops,
+			r.traffic.writes, r.traffic.reads, double(r.traffic.writes + r.traffic.reads) / r.ops,
+			r.p50Us, r.p99Us, i + 1 < results.size() ? "," : "");
+	}
+	fprintf(f, "  ]\n}\n");
+
+	if (f != stdout)
+		fclose(f);
+	return true;
+}
+
+static int usage()
+{
+	fprintf(stderr,
+		"usage: bench [-d ft232h|emulator|model] [-n iterations] [-s seed] [-b] [-j file] [scenario...]\n"
+		"  -d        device (default ft232h)\n"
+		"  -n        operations per scenario (default 100)\n"
+		"  -s        random seed (default 1)\n"
+		"  -b        buffered device writes\n"
+		"  -j file   also write JSON results, '-' for stdout\n"
+		"  scenario  run only scenarios whose names start with these\n"
+		"scenarios: fillScreen, fillRect, drawRect, fillCircle, drawCircle, drawLine,\n"
+		"           text-<font>, drawPixels, touchPoll\n");
+	return 1;
+}
+
+int main(int argc, char* argv[])
+{
+	const char* deviceName = "ft232h";
+	const char* json = nullptr;
+	size_t iterations = 100;
+	uint32_t seed = 1;
+	bool buffered = false;
+	std::vector<const char*> filters;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+			deviceName = argv[++i];
+		else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+			iterations = size_t(std::max(1, atoi(argv[++i])));
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+			seed = uint32_t(strtoul(argv[++i], nullptr, 0));
+		else if (strcmp(argv[i], "-b") == 0)
+			buffered = true;
+		else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+			json = argv[++i];
+		else if (argv[i][0] != '-')
+			filters.push_back(argv[i]);
+		else
+			return usage();
+	}
+	// xorshift32 never leaves 0.
+	if (seed == 0)
+		seed = 1;
+	s_random = seed;
+
+	hw::FT232H ft232h;
+	hw::RA8875Emulator emulator;
+	hw::TimingModel model;
+	hw::IDevice* device = nullptr;
+	hw::RA8875Emulator* emulated = nullptr;
+
+	if (strcmp(deviceName, "ft232h") == 0)
+	{
+		ft232h.setBuffered(buffered);
+		device = &ft232h;
+	}
+	else if (strcmp(deviceName, "emulator") == 0)
+	{
+		emulator.setBuffered(buffered);
+		device = emulated = &emulator;
+	}
+	else if (strcmp(deviceName, "model") == 0)
+	{
+		model.setBuffered(buffered);
+		device = emulated = &model;
+	}
+	else
+		return usage();
+
+	if (!device->open())
+		return 1;
+
+	hw::RA8875 tft(*device);
+	if (!tft.begin(TFT_DisplaySize::_800x480))
+	{
+		fprintf(stderr, "RA8875 Not Found!\n");
+		return 1;
+	}
+	tft.displayOn(true);
+
+	const uint16_t w = tft.width();
+	const uint16_t h = tft.height();
+	Bench bench(*device, tft, emulated == &model ? &model : nullptr);
+
+	if (selected(filters, "fillScreen"))
+		bench.run("fillScreen", iterations, [&](size_t) { tft.fillScreen(uint16_t(nextRandom())); });
+
+	if (selected(filters, "fillRect"))
+		bench.run("fillRect", iterations, [&](size_t) {
+			tft.fillRect(randomBelow(w / 2), randomBelow(h / 2), randomBelow(w / 2) + 1, randomBelow(h / 2) + 1, uint16_t(nextRandom()));
+		});
+
+	if (selected(filters, "drawRect"))
+		bench.run("drawRect", iterations, [&](size_t) {
+			tft.drawRect(randomBelow(w / 2), randomBelow(h / 2), randomBelow(w / 2) + 1, randomBelow(h / 2) + 1, uint16_t(nextRandom()));
+		});
+
+	if (selected(filters, "fillCircle"))
+		bench.run("fillCircle", iterations, [&](size_t) {
+			tft.fillCircle(randomBelow(w), randomBelow(h), uint8_t(randomBelow(100) + 1), uint16_t(nextRandom()));
+		});
+
+	if (selected(filters, "drawCircle"))
+		bench.run("drawCircle", iterations, [&](size_t) {
+			tft.drawCircle(randomBelow(w), randomBelow(h), uint8_t(randomBelow(100) + 1), uint16_t(nextRandom()));
+		});
+
+	if (selected(filters, "drawLine"))
+		bench.run("drawLine", iterations, [&](size_t) {
+			tft.drawLine(randomBelow(w), randomBelow(h), randomBelow(w), randomBelow(h), uint16_t(nextRandom()));
+		});
+
+	// One line of text per operation, in each font.
+	static const struct { TFT_Font font; const char* name; } fonts[] = {
+		{ TFT_Font::Internal,    "text-Internal" },
+		{ TFT_Font::Calibri20,   "text-Calibri20" },
+		{ TFT_Font::Calibri24,   "text-Calibri24" },
+		{ TFT_Font::Calibri30,   "text-Calibri30" },
+		{ TFT_Font::Consolas20,  "text-Consolas20" },
+		{ TFT_Font::Consolas24,  "text-Consolas24" },
+		{ TFT_Font::ComicNeue20, "text-ComicNeue20" },
+		{ TFT_Font::ComicNeue24, "text-ComicNeue24" },
+	};
+	for (const auto& f : fonts)
+	{
+		if (!selected(filters, f.name))
+			continue;
+		tft.textMode();
+		tft.setFont(f.font);
+		tft.textColor(RA8875_WHITE, RA8875_BLACK);
+		bench.run(f.name, iterations, [&](size_t i) {
+			tft.textSetCursor(0, int16_t((i * 32) % (h - 32)));
+			tft.textWrite("The quick brown fox jumps");
+		});
+		tft.graphicsMode();
+	}
+
+	// Whole frames, a row per drawPixels() call.  The frame is generated
+	// untimed, so only the upload is measured.
+	if (selected(filters, "drawPixels"))
+	{
+		std::vector<uint16_t> frame(size_t(w) * h);
+		bench.run("drawPixels", std::max<size_t>(iterations / 10, 1),
+			[&](size_t) {
+				for (uint16_t y = 0; y < h; ++y)
+					tft.drawPixels(&frame[size_t(y) * w], w, 0, int16_t(y));
+			},
+			[&](size_t i) {
+				for (uint16_t y = 0; y < h; ++y)
+				{
+					for (uint16_t x = 0; x < w; ++x)
+						frame[size_t(y) * w + x] = uint16_t((x + y + i) * 0x0841);
+				}
+			});
+	}
+
+	// A touch poll after every small fill; the fill's traffic is included.
+	if (selected(filters, "touchPoll"))
+	{
+		tft.touchEnable(true);
+		bench.run("touchPoll", iterations,
+			[&](size_t) {
+				uint16_t x, y;
+				tft.touchPoll(&x, &y);
+			},
+			[&](size_t i) {
+				if (emulated != nullptr && i % 4 == 0)
+					emulated->touch(randomBelow(1024), randomBelow(1024));
+				tft.fillRect(randomBelow(w - 64), randomBelow(h - 64), 64, 64, uint16_t(nextRandom()));
+			});
+		tft.touchEnable(false);
+	}
+
+	printTable(bench.results());
+	if (json != nullptr && !writeJson(json, deviceName, iterations, seed, bench.results()))
+		return 1;
+
+	device->close();
+	return 0;
+}
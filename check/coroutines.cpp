@@ -0,0 +1,169 @@
+#include <stdio.h>
+
+#include "RA8875Coroutines.h"
+#include "RA8875Emulator.h"
+
+//
+// C++20 checks of RA8875Coroutines.h against the emulator, no hardware
+// needed.  Coroutines on two displays share one IoLoop; register and
+// touch reads must match the blocking calls, and a sync must only resume
+// once the pipelined draw has reached display memory.  Exits with 1 if
+// anything differs.
+//
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define CHECK_COROUTINES 1
+#endif
+#endif
+
+#ifdef CHECK_COROUTINES
+
+// Split reads that finish only after a few polls, as they would over USB,
+// so coroutines really do park in the loop.
+class SlowEmulator : public hw::RA8875Emulator
+{
+public:
+	SlowEmulator() : m_pending(false), m_polls(0), m_result(0) {}
+
+	bool beginRead(uint8_t* data, int expected, int timeoutMs) override
+	{
+		if (m_pending)
+			return false;
+		m_result = RA8875Emulator::read(data, expected, timeoutMs);
+		m_pending = true;
+		m_polls = 4;
+		return true;
+	}
+
+	bool pollRead(int& result) override
+	{
+		if (!m_pending || --m_polls > 0)
+			return false;
+		m_pending = false;
+		result = m_result;
+		return true;
+	}
+
+	// A blocking read finishes the split read first, as IDevice asks.
+	int read(uint8_t* data, int expected, int timeoutMs) override
+	{
+		m_pending = false;
+		return RA8875Emulator::read(data, expected, timeoutMs);
+	}
+
+private:
+	bool m_pending;
+	int  m_polls;
+	int  m_result;
+};
+
+static bool s_ok = true;
+
+static void expect(bool condition, const char* what)
+{
+	if (!condition)
+	{
+		fprintf(stderr, "coroutines: %s\n", what);
+		s_ok = false;
+	}
+}
+
+static hw::Task<int> systemRegister(const hw::RA8875& tft)
+{
+	co_return co_await tft.readRegister8Async(TFT_Register::SYSR);
+}
+
+// Nested tasks, and reads interleaved with the other display's.
+static hw::Task<> readLoop(const hw::RA8875& tft, int& matches)
+{
+	for (int i = 0; i < 16; ++i)
+		matches += co_await systemRegister(tft) == tft.readRegister8(TFT_Register::SYSR);
+}
+
+static hw::Task<> drawLoop(hw::RA8875& tft, hw::RA8875Emulator& emulator, int& matches)
+{
+	for (int i = 0; i < 16; ++i)
+	{
+		uint16_t color = uint16_t(0x1111 * (i + 1));
+		tft.fillRect(int16_t(i * 10), 0, 10, 10, color);
+		co_await tft.syncAsync();
+		matches += emulator.display().getPixel(i * 10 + 5, 5) == color;
+	}
+}
+
+static hw::Task<> touchLoop(const hw::RA8875& tft, hw::RA8875Emulator& emulator, bool& ok)
+{
+	ok = !co_await tft.touchedAsync();
+	emulator.touch(0x2A5, 0x13E);
+	ok = co_await tft.touchedAsync() && ok;
+	hw::TouchPoint point = co_await tft.touchReadAsync();
+	ok = point.x == 0x2A5 && point.y == 0x13E && ok;
+	ok = !co_await tft.touchedAsync() && ok;
+}
+
+// A coroutine that runs as soon as it is called, for awaiting outside an
+// IoLoop.
+struct Eager
+{
+	struct promise_type
+	{
+		Eager               get_return_object() { return Eager(); }
+		std::suspend_never  initial_suspend() noexcept { return {}; }
+		std::suspend_never  final_suspend() noexcept { return {}; }
+		void                return_void() {}
+		void                unhandled_exception() { std::terminate(); }
+	};
+};
+
+static Eager readEagerly(const hw::RA8875& tft, int& value)
+{
+	value = co_await tft.readRegister8Async(TFT_Register::SYSR);
+}
+
+int main()
+{
+	SlowEmulator emulatorA, emulatorB;
+	emulatorA.open();
+	emulatorB.open();
+	hw::RA8875 tftA(emulatorA), tftB(emulatorB);
+	if (!tftA.begin(TFT_DisplaySize::_800x480) || !tftB.begin(TFT_DisplaySize::_800x480))
+	{
+		fprintf(stderr, "Unable to initialise the emulated displays\n");
+		return 1;
+	}
+	tftA.setPipelined(true);
+	tftB.touchEnable(true);
+
+	int readsA = 0, readsB = 0, draws = 0;
+	bool touch = false;
+	{
+		hw::IoLoop loop;
+		loop.spawn(readLoop(tftA, readsA));
+		loop.spawn(drawLoop(tftA, emulatorA, draws));
+		loop.spawn(readLoop(tftB, readsB));
+		loop.spawn(touchLoop(tftB, emulatorB, touch));
+		loop.run();
+	}
+	expect(readsA == 16 && readsB == 16, "register reads in a loop differ from readRegister8()");
+	expect(draws == 16, "syncAsync() resumed before the draw reached display memory");
+	expect(touch, "touch reads in a loop differ from the emulated panel");
+
+	// Outside a loop the awaiters poll in place.
+	int outside = -1;
+	readEagerly(tftA, outside);
+	expect(outside == tftA.readRegister8(TFT_Register::SYSR), "register read outside a loop differs");
+
+	printf("%s\n", s_ok ? "all coroutine checks passed" : "some coroutine checks FAILED");
+	return s_ok ? 0 : 1;
+}
+
+#else
+
+int main()
+{
+	fprintf(stderr, "checkCoroutines needs a C++20 compiler with coroutine support\n");
+	return 1;
+}
+
+#endif
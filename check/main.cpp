@@ -0,0 +1,961 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "AsyncRA8875.h"
+#include "Canvas.h"
+#include "CommandStream.h"
+#include "DisplayList.h"
+#include "FramePipeline.h"
+#include "PixelFormat.h"
+#include "RA8875.h"
+#include "RA8875Emulator.h"
+#include "RA8875Registers.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+//
+// Correctness checks against the emulator, no hardware needed.  Every
+// primitive is drawn through the driver, in each way the driver can send
+// it, and the emulated display memory compared with pixels worked out
+// here from the geometry.  Text, pixel format conversion and dithering,
+// captured and recorded streams and AsyncRA8875 are checked the same way.
+// Whole frames sent by presentFrame() and by a FramePipeline must both
+// end up on the display unchanged.  Exits with 1 if anything differs.
+//
+
+// xorshift32, so runs are identical on every platform.
+static uint32_t s_random = 1;
+
+static uint32_t nextRandom()
+{
+	s_random ^= s_random << 13;
+	s_random ^= s_random >> 17;
+	s_random ^= s_random << 5;
+	return s_random;
+}
+
+static uint16_t randomBelow(uint16_t n)
+{
+	return uint16_t(nextRandom() % n);
+}
+
+static const int kWidth = 800;
+static const int kHeight = 480;
+
+enum class Shape
+{
+	Pixel, Line, Rect, FillRect, Circle, FillCircle, Triangle, FillTriangle,
+	Ellipse, FillEllipse, Curve, FillCurve, Count
+};
+
+static const char* shapeName(Shape shape)
+{
+	static const char* names[] = {
+		"pixel", "line", "rect", "fillRect", "circle", "fillCircle", "triangle", "fillTriangle",
+		"ellipse", "fillEllipse", "curve", "fillCurve",
+	};
+	return names[int(shape)];
+}
+
+// How the driver sends the primitive.
+enum class Path
+{
+	Direct,         // register writes, polling the engine
+	Pipelined,      // engine waits deferred
+	DisplayList,    // pre-encoded, gated on the WAIT pin
+	Framebuffer,    // drawn on the host, uploaded by flushFramebuffer()
+	Count
+};
+
+static const char* pathName(Path path)
+{
+	static const char* names[] = { "direct", "pipelined", "displayList", "framebuffer" };
+	return names[int(path)];
+}
+
+// One primitive call; 'a' holds the RA8875 method arguments in order.
+struct Call
+{
+	Shape    shape;
+	uint16_t a[6];
+	uint16_t color;
+};
+
+///
+/// Random arguments that keep the shape on screen, so the checks don't
+/// depend on how the chip clips.
+///
+static Call randomCall(Shape shape)
+{
+	Call c;
+	c.shape = shape;
+	c.color = uint16_t(nextRandom() | 1);
+	memset(c.a, 0, sizeof(c.a));
+
+	switch (shape)
+	{
+	case Shape::Pixel:
+		c.a[0] = randomBelow(kWidth);
+		c.a[1] = randomBelow(kHeight);
+		break;
+	case Shape::Line:
+		c.a[0] = randomBelow(kWidth);
+		c.a[1] = randomBelow(kHeight);
+		c.a[2] = randomBelow(kWidth);
+		c.a[3] = randomBelow(kHeight);
+		break;
+	case Shape::Rect:
+	case Shape::FillRect:
+		// Position and size.
+		c.a[0] = randomBelow(kWidth - 1);
+		c.a[1] = randomBelow(kHeight - 1);
+		c.a[2] = uint16_t(2 + randomBelow(uint16_t(kWidth - 1 - c.a[0])));
+		c.a[3] = uint16_t(2 + randomBelow(uint16_t(kHeight - 1 - c.a[1])));
+		break;
+	case Shape::Circle:
+	case Shape::FillCircle:
+		c.a[2] = uint16_t(1 + randomBelow(100));
+		c.a[0] = uint16_t(c.a[2] + randomBelow(uint16_t(kWidth - 2 * c.a[2])));
+		c.a[1] = uint16_t(c.a[2] + randomBelow(uint16_t(kHeight - 2 * c.a[2])));
+		break;
+	case Shape::Triangle:
+	case Shape::FillTriangle:
+		for (int i = 0; i < 6; i += 2)
+		{
+			c.a[i] = randomBelow(kWidth);
+			c.a[i + 1] = randomBelow(kHeight);
+		}
+		break;
+	case Shape::Ellipse:
+	case Shape::FillEllipse:
+	case Shape::Curve:
+	case Shape::FillCurve:
+		c.a[2] = uint16_t(1 + randomBelow(150));
+		c.a[3] = uint16_t(1 + randomBelow(100));
+		c.a[0] = uint16_t(c.a[2] + randomBelow(uint16_t(kWidth - 2 * c.a[2])));
+		c.a[1] = uint16_t(c.a[3] + randomBelow(uint16_t(kHeight - 2 * c.a[3])));
+		c.a[4] = randomBelow(4);
+		break;
+	case Shape::Count:
+		break;
+	}
+	return c;
+}
+
+static void draw(const hw::RA8875& tft, const Call& c)
+{
+	const uint16_t* a = c.a;
+	switch (c.shape)
+	{
+	case Shape::Pixel:        tft.drawPixel(int16_t(a[0]), int16_t(a[1]), c.color); break;
+	case Shape::Line:         tft.drawLine(a[0], a[1], a[2], a[3], c.color); break;
+	case Shape::Rect:         tft.drawRect(a[0], a[1], a[2], a[3], c.color); break;
+	case Shape::FillRect:     tft.fillRect(a[0], a[1], a[2], a[3], c.color); break;
+	case Shape::Circle:       tft.drawCircle(a[0], a[1], uint8_t(a[2]), c.color); break;
+	case Shape::FillCircle:   tft.fillCircle(a[0], a[1], uint8_t(a[2]), c.color); break;
+	case Shape::Triangle:     tft.drawTriangle(a[0], a[1], a[2], a[3], a[4], a[5], c.color); break;
+	case Shape::FillTriangle: tft.fillTriangle(a[0], a[1], a[2], a[3], a[4], a[5], c.color); break;
+	case Shape::Ellipse:      tft.drawEllipse(a[0], a[1], a[2], a[3], c.color); break;
+	case Shape::FillEllipse:  tft.fillEllipse(a[0], a[1], a[2], a[3], c.color); break;
+	case Shape::Curve:        tft.drawCurve(a[0], a[1], a[2], a[3], uint8_t(a[4]), c.color); break;
+	case Shape::FillCurve:    tft.fillCurve(a[0], a[1], a[2], a[3], uint8_t(a[4]), c.color); break;
+	case Shape::Count:        break;
+	}
+}
+
+// DisplayList has no curves; false if the call can't be recorded.
+static bool record(hw::DisplayList& list, const Call& c)
+{
+	const uint16_t* a = c.a;
+	switch (c.shape)
+	{
+	case Shape::Pixel:        list.drawPixel(int16_t(a[0]), int16_t(a[1]), c.color); return true;
+	case Shape::Line:         list.drawLine(a[0], a[1], a[2], a[3], c.color); return true;
+	case Shape::Rect:         list.drawRect(a[0], a[1], a[2], a[3], c.color); return true;
+	case Shape::FillRect:     list.fillRect(a[0], a[1], a[2], a[3], c.color); return true;
+	case Shape::Circle:       list.drawCircle(a[0], a[1], uint8_t(a[2]), c.color); return true;
+	case Shape::FillCircle:   list.fillCircle(a[0], a[1], uint8_t(a[2]), c.color); return true;
+	case Shape::Triangle:     list.drawTriangle(a[0], a[1], a[2], a[3], a[4], a[5], c.color); return true;
+	case Shape::FillTriangle: list.fillTriangle(a[0], a[1], a[2], a[3], a[4], a[5], c.color); return true;
+	case Shape::Ellipse:      list.drawEllipse(a[0], a[1], a[2], a[3], c.color); return true;
+	case Shape::FillEllipse:  list.fillEllipse(a[0], a[1], a[2], a[3], c.color); return true;
+	default:                  return false;
+	}
+}
+
+//
+// The expected pixels, worked out here from the geometry rather than with
+// Canvas's drawing code, so a mistake shared by the emulator and Canvas
+// still shows.  Ellipses and curves are left to Canvas.
+//
+
+///
+/// One pixel per step along the major axis, the minor axis rounded to the
+/// nearest pixel and halves away from the start, as Bresenham draws it.
+///
+static void referenceLine(hw::Canvas& canvas, int x0, int y0, int x1, int y1, uint16_t color)
+{
+	int dx = x1 - x0;
+	int dy = y1 - y0;
+	bool xMajor = std::abs(dx) >= std::abs(dy);
+	int steps = std::max(std::abs(dx), std::abs(dy));
+	int minor = xMajor ? std::abs(dy) : std::abs(dx);
+
+	for (int i = 0; i <= steps; ++i)
+	{
+		int offset = steps == 0 ? 0 : int((2LL * minor * i + steps) / (2LL * steps));
+		int along = xMajor ? i : offset;
+		int across = xMajor ? offset : i;
+		canvas.drawPixel(x0 + (dx < 0 ? -along : along), y0 + (dy < 0 ? -across : across), color);
+	}
+}
+
+///
+/// In the octant above the diagonal a circle has one pixel per column, at
+/// the nearest row; it never passes exactly between two pixel centres, so
+/// there is no rounding to decide.  The other seven octants are mirrors.
+/// Filled, each of those pixels spans the row to its mirror image.
+///
+static void referenceCircle(hw::Canvas& canvas, int cx, int cy, int r, uint16_t color, bool filled)
+{
+	for (int x = 0; x <= r; ++x)
+	{
+		int y = int(std::lround(std::sqrt(double(r) * r - double(x) * x)));
+		if (x > y)
+			break;
+
+		const int points[2][2] = { { x, y }, { y, x } };
+		for (const int* p : points)
+		{
+			if (filled)
+			{
+				canvas.drawHLine(cx - p[0], cx + p[0], cy - p[1], color);
+				canvas.drawHLine(cx - p[0], cx + p[0], cy + p[1], color);
+				continue;
+			}
+			canvas.drawPixel(cx - p[0], cy - p[1], color);
+			canvas.drawPixel(cx + p[0], cy - p[1], color);
+			canvas.drawPixel(cx - p[0], cy + p[1], color);
+			canvas.drawPixel(cx + p[0], cy + p[1], color);
+		}
+	}
+}
+
+struct Vertex
+{
+	int x, y;
+};
+
+// Where edge a-b crosses row 'y', rounded toward a.
+static int edgeCrossing(Vertex a, Vertex b, int y)
+{
+	if (a.y == b.y)
+		return a.x;
+	int offset = int((long long)std::abs(b.x - a.x) * (y - a.y) / (b.y - a.y));
+	return b.x < a.x ? a.x - offset : a.x + offset;
+}
+
+///
+/// Top to bottom, one span per row between the edge spanning the whole
+/// height and whichever of the other two covers the row, then those two
+/// edges outlined.  Vertices on the same row keep their argument order.
+///
+static void referenceFillTriangle(hw::Canvas& canvas, const uint16_t* a, uint16_t color)
+{
+	Vertex v[3] = { { a[0], a[1] }, { a[2], a[3] }, { a[4], a[5] } };
+	std::stable_sort(v, v + 3, [](Vertex p, Vertex q) { return p.y < q.y; });
+
+	for (int y = v[0].y; y <= v[2].y; ++y)
+	{
+		int xa = edgeCrossing(v[0], v[2], y);
+		int xb = y < v[1].y ? edgeCrossing(v[0], v[1], y) : edgeCrossing(v[1], v[2], y);
+		canvas.drawHLine(std::min(xa, xb), std::max(xa, xb), y, color);
+	}
+	referenceLine(canvas, v[0].x, v[0].y, v[1].x, v[1].y, color);
+	referenceLine(canvas, v[1].x, v[1].y, v[2].x, v[2].y, color);
+}
+
+static void referenceRect(hw::Canvas& canvas, int x0, int y0, int x1, int y1, uint16_t color, bool filled)
+{
+	for (int y = y0; y <= y1; ++y)
+	{
+		if (filled || y == y0 || y == y1)
+		{
+			canvas.drawHLine(x0, x1, y, color);
+			continue;
+		}
+		canvas.drawPixel(x0, y, color);
+		canvas.drawPixel(x1, y, color);
+	}
+}
+
+// What the RA8875 engine draws for the call.
+static void reference(hw::Canvas& canvas, const Call& c)
+{
+	const uint16_t* a = c.a;
+	uint8_t quadrant = uint8_t(1 << (a[4] & 0x03));
+	switch (c.shape)
+	{
+	case Shape::Pixel:        canvas.drawPixel(a[0], a[1], c.color); break;
+	case Shape::Line:         referenceLine(canvas, a[0], a[1], a[2], a[3], c.color); break;
+	case Shape::Rect:         referenceRect(canvas, a[0], a[1], a[0] + a[2] - 1, a[1] + a[3] - 1, c.color, false); break;
+	case Shape::FillRect:     referenceRect(canvas, a[0], a[1], a[0] + a[2] - 1, a[1] + a[3] - 1, c.color, true); break;
+	case Shape::Circle:       referenceCircle(canvas, a[0], a[1], a[2], c.color, false); break;
+	case Shape::FillCircle:   referenceCircle(canvas, a[0], a[1], a[2], c.color, true); break;
+	case Shape::Triangle:
+		referenceLine(canvas, a[0], a[1], a[2], a[3], c.color);
+		referenceLine(canvas, a[2], a[3], a[4], a[5], c.color);
+		referenceLine(canvas, a[4], a[5], a[0], a[1], c.color);
+		break;
+	case Shape::FillTriangle: referenceFillTriangle(canvas, a, c.color); break;
+	case Shape::Ellipse:      canvas.drawEllipse(a[0], a[1], a[2], a[3], c.color); break;
+	case Shape::FillEllipse:  canvas.fillEllipse(a[0], a[1], a[2], a[3], c.color); break;
+	case Shape::Curve:        canvas.drawEllipse(a[0], a[1], a[2], a[3], c.color, quadrant); break;
+	case Shape::FillCurve:    canvas.fillEllipse(a[0], a[1], a[2], a[3], c.color, quadrant); break;
+	case Shape::Count:        break;
+	}
+}
+
+///
+/// Pixels that differ between the display and 'expected', with the first
+/// one reported.
+///
+static size_t compare(const hw::Canvas& display, const uint16_t* expected, const char* what)
+{
+	size_t bad = 0;
+	for (int y = 0; y < kHeight; ++y)
+	{
+		for (int x = 0; x < kWidth; ++x)
+		{
+			uint16_t want = expected[y * kWidth + x];
+			uint16_t got = display.getPixel(x, y);
+			if (got != want && bad++ == 0)
+				fprintf(stderr, "  %s: (%d,%d) is %04x, expected %04x\n", what, x, y, got, want);
+		}
+	}
+	return bad;
+}
+
+static bool report(const char* name, const char* variant, size_t count, const char* unit, size_t bad)
+{
+	printf("%-14s %-15s %4zu %-6s  %s", name, variant, count, unit, bad == 0 ? "ok\n" : "FAILED");
+	if (bad != 0)
+		printf(" (%zu pixels)\n", bad);
+	return bad == 0;
+}
+
+static bool checkShape(hw::RA8875Emulator& emulator, hw::RA8875& tft, Shape shape, Path path, size_t calls)
+{
+	hw::Canvas expected(kWidth, kHeight);
+	hw::DisplayList list;
+	size_t bad = 0;
+
+	tft.setPipelined(path == Path::Pipelined);
+	tft.setHardwareWait(path == Path::DisplayList);
+	tft.setFramebuffer(path == Path::Framebuffer);
+
+	for (size_t i = 0; i < calls; ++i)
+	{
+		Call c = randomCall(shape);
+
+		tft.fillScreen(0);
+		expected.fill(0);
+		reference(expected, c);
+
+		list.clear();
+		if (path == Path::DisplayList && record(list, c))
+		{
+			if (!list.submit(tft))
+			{
+				fprintf(stderr, "  DisplayList wasn't encoded\n");
+				bad++;
+			}
+		}
+		else
+		{
+			draw(tft, c);
+		}
+
+		if (path == Path::Framebuffer)
+			tft.flushFramebuffer();
+		tft.sync();
+		tft.flush();
+		bad += compare(emulator.display(), expected.data(), shapeName(shape));
+	}
+
+	tft.setPipelined(false);
+	tft.setHardwareWait(false);
+	tft.setFramebuffer(false);
+	return report(shapeName(shape), pathName(path), calls, "calls", bad);
+}
+
+///
+/// A draw captured or recorded but never sent must leave the driver's
+/// register shadow as it was: the same draw made directly afterwards has
+/// to reach the display in full.
+///
+static bool checkDiscarded(hw::RA8875Emulator& emulator, hw::RA8875& tft, bool recording)
+{
+	hw::Canvas expected(kWidth, kHeight);
+	hw::DisplayList list;
+	hw::CommandStream stream;
+	size_t bad = 0;
+
+	tft.setHardwareWait(true);
+	for (int i = 0; i < 4; ++i)
+	{
+		Call c = randomCall(Shape::FillRect);
+
+		tft.fillScreen(0);
+		expected.fill(0);
+		reference(expected, c);
+
+		bool captured;
+		if (recording)
+		{
+			captured = tft.beginRecording(stream);
+			draw(tft, c);
+			tft.endRecording();
+		}
+		else
+		{
+			list.clear();
+			record(list, c);
+			captured = list.encode(tft);
+		}
+		if (!captured)
+		{
+			fprintf(stderr, "  the draw wasn't captured\n");
+			bad++;
+		}
+
+		draw(tft, c);
+		tft.flush();
+		bad += compare(emulator.display(), expected.data(), recording ? "recording" : "capture");
+	}
+	tft.setHardwareWait(false);
+	return report("discarded", recording ? "recording" : "capture", 4, "calls", bad);
+}
+
+///
+/// Frames that change a little at a time: a few random rectangles each,
+/// plus now and then a full-screen change.
+///
+static void nextFrame(std::vector<uint16_t>& frame, size_t index)
+{
+	if (index % 16 == 0)
+	{
+		uint16_t base = uint16_t(nextRandom());
+		for (size_t i = 0; i < frame.size(); ++i)
+			frame[i] = uint16_t(base + i);
+		return;
+	}
+
+	int rects = 1 + randomBelow(6);
+	for (int r = 0; r < rects; ++r)
+	{
+		int x0 = randomBelow(kWidth), y0 = randomBelow(kHeight);
+		int x1 = std::min(kWidth, x0 + 1 + randomBelow(200));
+		int y1 = std::min(kHeight, y0 + 1 + randomBelow(120));
+		uint16_t color = uint16_t(nextRandom());
+		for (int y = y0; y < y1; ++y)
+			std::fill(&frame[y * kWidth + x0], &frame[y * kWidth + x1], color);
+	}
+}
+
+///
+/// presentFrame() on one display, a FramePipeline on another, both fed
+/// the same frames.  The pipeline is drained every few frames, to check
+/// it at points where it has caught up.
+///
+static bool checkFrames(size_t frames)
+{
+	hw::RA8875Emulator direct, piped;
+	direct.open();
+	piped.open();
+	hw::RA8875 tftDirect(direct), tftPiped(piped);
+	if (!tftDirect.begin(TFT_DisplaySize::_800x480) || !tftPiped.begin(TFT_DisplaySize::_800x480))
+	{
+		fprintf(stderr, "Unable to initialise the emulated displays\n");
+		return false;
+	}
+
+	std::vector<uint16_t> frame(size_t(kWidth) * kHeight, 0);
+	size_t badDirect = 0, badPiped = 0;
+	{
+		hw::FramePipeline pipeline(tftPiped);
+		for (size_t i = 0; i < frames; ++i)
+		{
+			nextFrame(frame, i);
+			tftDirect.presentFrame(frame.data());
+			tftDirect.flush();
+			badDirect += compare(direct.display(), frame.data(), "presentFrame");
+
+			pipeline.push(frame.data());
+			if (i % 8 == 7 || i + 1 == frames)
+			{
+				pipeline.drain();
+				badPiped += compare(piped.display(), frame.data(), "FramePipeline");
+			}
+		}
+	}
+
+	// The emulator models 16bpp only.
+	bool ok = report("presentFrame", "16bpp", frames, "frames", badDirect);
+	return report("FramePipeline", "16bpp", frames, "frames", badPiped) && ok;
+}
+
+///
+/// With the framebuffer on, presentFrame() flushes whatever else was drawn
+/// into it, also when no tile of the frame changed.
+///
+static bool checkFramebufferFrames(hw::RA8875Emulator& emulator, hw::RA8875& tft)
+{
+	std::vector<uint16_t> frame(size_t(kWidth) * kHeight, 0);
+	hw::Canvas expected(kWidth, kHeight);
+	size_t bad = 0;
+
+	tft.setFramebuffer(true);
+	for (int i = 0; i < 4; ++i)
+	{
+		// Whole, to cover the rectangle of the last pass.
+		nextFrame(frame, size_t(i));
+		tft.invalidateFrame();
+		tft.presentFrame(frame.data());
+
+		// The same frame again, with a rectangle drawn in between.
+		Call c = randomCall(Shape::FillRect);
+		draw(tft, c);
+		tft.presentFrame(frame.data());
+		tft.flush();
+
+		std::copy(frame.begin(), frame.end(), expected.data());
+		reference(expected, c);
+		bad += compare(emulator.display(), expected.data(), "presentFrame");
+	}
+	tft.setFramebuffer(false);
+	tft.invalidateFrame();
+	return report("presentFrame", "framebuffer", 4, "frames", bad);
+}
+
+///
+/// Internal font text, opaque and transparent, at every scale.  The
+/// emulator has no font ROM and draws each printable character as a block
+/// inset in its 8x16 cell.
+///
+static bool checkText(hw::RA8875Emulator& emulator, hw::RA8875& tft, size_t calls)
+{
+	static const char* strings[] = { "Hello, world", "0123456789", "a b  c", "#" };
+	hw::Canvas expected(kWidth, kHeight);
+	size_t bad = 0;
+
+	for (size_t i = 0; i < calls; ++i)
+	{
+		const char* text = strings[i % 4];
+		int length = int(strlen(text));
+		int scale = randomBelow(4);
+		int w = 8 * (scale + 1);
+		int h = 16 * (scale + 1);
+		int x = randomBelow(uint16_t(kWidth - length * w + 1));
+		int y = randomBelow(uint16_t(kHeight - h + 1));
+		uint16_t fg = uint16_t(nextRandom() | 1);
+		uint16_t bg = uint16_t(nextRandom() | 1);
+		bool transparent = (nextRandom() & 1) != 0;
+
+		tft.fillScreen(0);
+		tft.textMode();
+		tft.textSetCursor(uint16_t(x), uint16_t(y));
+		tft.textEnlarge(uint8_t(scale));
+		if (transparent)
+			tft.textTransparent(fg);
+		else
+			tft.textColor(fg, bg);
+		tft.textWrite(text);
+		tft.graphicsMode();
+		tft.flush();
+
+		expected.fill(0);
+		for (int c = 0; c < length; ++c, x += w)
+		{
+			int s = scale + 1;
+			if (!transparent)
+				referenceRect(expected, x, y, x + w - 1, y + h - 1, bg, true);
+			if (text[c] != ' ')
+				referenceRect(expected, x + s, y + 2 * s, x + 7 * s - 1, y + 14 * s - 1, fg, true);
+		}
+		bad += compare(emulator.display(), expected.data(), "text");
+	}
+	return report("text", "internal", calls, "calls", bad);
+}
+
+// One source pixel in 'format', from 8 bit channels.
+static void storePixel(TFT_PixelFormat format, uint8_t r, uint8_t g, uint8_t b, uint8_t* out)
+{
+	switch (format)
+	{
+	case PixelRGB888:   out[0] = r; out[1] = g; out[2] = b; break;
+	case PixelXRGB8888: out[0] = 0xFF; out[1] = r; out[2] = g; out[3] = b; break;
+	case PixelBGRA8888: out[0] = b; out[1] = g; out[2] = r; out[3] = 0xFF; break;
+	default:
+	{
+		uint16_t c = uint16_t((r >> 3) << 11 | (g >> 2) << 5 | b >> 3);
+		out[0] = uint8_t(c & 0xFF);
+		out[1] = uint8_t(c >> 8);
+		break;
+	}
+	}
+}
+
+///
+/// Mean of one RGB565 channel of the display over a rectangle, in output
+/// steps.
+///
+static double channelMean(const hw::Canvas& display, int x0, int y0, int w, int h, int shift, int mask)
+{
+	double sum = 0;
+	for (int y = y0; y < y0 + h; ++y)
+	{
+		for (int x = x0; x < x0 + w; ++x)
+			sum += (display.getPixel(x, y) >> shift) & mask;
+	}
+	return sum / (double(w) * h);
+}
+
+///
+/// pushRect() from every source format, sent directly and through the
+/// framebuffer.  Without dithering every channel is truncated to 5/6/5
+/// bits.  Dithered, a flat colour must average out to its exact level,
+/// and with ordered dithering be made of the two levels around it.
+///
+static bool checkPixelFormats(hw::RA8875Emulator& emulator, hw::RA8875& tft)
+{
+	static const char* formatNames[] = { "RGB565LE", "RGB888", "XRGB8888", "BGRA8888" };
+	static const char* ditherNames[] = { "", " ordered", " diffused" };
+	const int w = 64, h = 32;
+	bool ok = true;
+
+	std::vector<uint8_t> source(size_t(w) * h * 4);
+	std::vector<uint16_t> expected(size_t(kWidth) * kHeight);
+	for (int f = 0; f < int(PixelFormatCount); ++f)
+	{
+		TFT_PixelFormat format = TFT_PixelFormat(f);
+		size_t size = hw::pixelSize(format);
+		for (int d = 0; d <= int(DitherFloydSteinberg); ++d)
+		{
+			// RGB565 sources are sent as they are.
+			TFT_Dither dither = TFT_Dither(d);
+			if (format == PixelRGB565LE && dither != DitherNone)
+				continue;
+
+			for (int framebuffer = 0; framebuffer < 2; ++framebuffer)
+			{
+				size_t bad = 0;
+				int x = randomBelow(kWidth - w);
+				int y = randomBelow(kHeight - h);
+				// Flat for dithering, just short of the top level so the
+				// bias can't saturate.
+				uint8_t flat[3] = { uint8_t(randomBelow(240)), uint8_t(randomBelow(248)), uint8_t(randomBelow(240)) };
+
+				std::fill(expected.begin(), expected.end(), 0);
+				for (int i = 0; i < w * h; ++i)
+				{
+					uint8_t r = flat[0], g = flat[1], b = flat[2];
+					if (dither == DitherNone)
+					{
+						uint32_t v = nextRandom();
+						r = uint8_t(v);
+						g = uint8_t(v >> 8);
+						b = uint8_t(v >> 16);
+					}
+					storePixel(format, r, g, b, &source[i * size]);
+					expected[(y + i / w) * kWidth + x + i % w] = uint16_t((r >> 3) << 11 | (g >> 2) << 5 | b >> 3);
+				}
+
+				tft.setFramebuffer(framebuffer != 0);
+				tft.setDither(dither);
+				tft.fillScreen(0);
+				tft.pushRect(int16_t(x), int16_t(y), w, h, format, source.data());
+				if (framebuffer)
+					tft.flushFramebuffer();
+				tft.flush();
+
+				const hw::Canvas& display = emulator.display();
+				if (dither == DitherNone)
+				{
+					bad = compare(display, expected.data(), formatNames[f]);
+				}
+				else
+				{
+					const int shifts[3] = { 11, 5, 0 };
+					const int masks[3] = { 0x1F, 0x3F, 0x1F };
+					// The ordered kernels scale each channel to its levels
+					// before the bias, which can lose up to a step.
+					const double tolerance = dither == DitherOrdered ? 0.3 : 0.15;
+					for (int k = 0; k < 3; ++k)
+					{
+						double exact = flat[k] * masks[k] / 255.0;
+						double mean = channelMean(display, x, y, w, h, shifts[k], masks[k]);
+						if (std::fabs(mean - exact) > tolerance)
+						{
+							fprintf(stderr, "  %s%s: channel %d averages %.3f levels, expected %.3f\n",
+								formatNames[f], ditherNames[d], k, mean, exact);
+							bad++;
+						}
+
+						// Ordered, a flat colour takes the two levels around it.
+						int lowest = masks[k], highest = 0;
+						for (int i = 0; i < w * h; ++i)
+						{
+							int level = (display.getPixel(x + i % w, y + i / w) >> shifts[k]) & masks[k];
+							lowest = std::min(lowest, level);
+							highest = std::max(highest, level);
+						}
+						if (dither == DitherOrdered && highest - lowest > 1)
+						{
+							fprintf(stderr, "  %s ordered: channel %d spans levels %d to %d\n",
+								formatNames[f], k, lowest, highest);
+							bad++;
+						}
+					}
+				}
+
+				char variant[32];
+				snprintf(variant, sizeof(variant), "%s%s", framebuffer ? "fb" : "direct", ditherNames[d]);
+				ok = report(formatNames[f], variant, 1, "rects", bad) && ok;
+			}
+		}
+	}
+	tft.setFramebuffer(false);
+	tft.setDither(DitherNone);
+	return ok;
+}
+
+///
+/// Draws captured with beginCapture() and sent later with submitStream(),
+/// and recorded into a CommandStream, recoloured through its patch table,
+/// replayed, saved, loaded and replayed again.  Each must put the same
+/// pixels on the display as the draws made directly.
+///
+static bool checkStreams(hw::RA8875Emulator& emulator, hw::RA8875& tft, size_t calls)
+{
+	static const char* path = "check_stream.bin";
+	hw::Canvas expected(kWidth, kHeight);
+	std::vector<Call> drawn(calls);
+	std::vector<uint8_t> captured;
+	hw::CommandStream stream, loaded;
+	size_t badCapture = 0, badRecording = 0, badLoaded = 0;
+
+	tft.setHardwareWait(true);
+	for (int pass = 0; pass < 4; ++pass)
+	{
+		// Anything but pixels, which take their colour as memory data
+		// rather than from the patchable colour registers.
+		for (Call& c : drawn)
+			c = randomCall(Shape(1 + randomBelow(int(Shape::Count) - 1)));
+
+		tft.fillScreen(0);
+		tft.flush();
+		expected.fill(0);
+		for (const Call& c : drawn)
+			reference(expected, c);
+
+		if (!tft.beginCapture())
+		{
+			fprintf(stderr, "  the draws weren't captured\n");
+			badCapture++;
+		}
+		for (const Call& c : drawn)
+			draw(tft, c);
+		tft.endCapture(captured);
+		tft.submitStream(captured.data(), captured.size());
+		tft.flush();
+		badCapture += compare(emulator.display(), expected.data(), "capture");
+
+		// Recorded in one colour, replayed in another.
+		uint16_t color = uint16_t(nextRandom() | 1);
+		tft.fillScreen(0);
+		expected.fill(0);
+		if (!tft.beginRecording(stream))
+		{
+			fprintf(stderr, "  the draws weren't recorded\n");
+			badRecording++;
+		}
+		tft.markPatch("shapes");
+		for (Call& c : drawn)
+		{
+			draw(tft, c);
+			c.color = color;
+			reference(expected, c);
+		}
+		tft.endRecording();
+		if (!stream.patchColor("shapes", TFT_Register::FGCR0, color))
+		{
+			fprintf(stderr, "  the recording has no colour to patch\n");
+			badRecording++;
+		}
+		tft.replay(stream);
+		tft.flush();
+		badRecording += compare(emulator.display(), expected.data(), "recording");
+
+		tft.fillScreen(0);
+		if (!stream.save(path) || !loaded.load(path) || loaded.bytes() != stream.bytes())
+		{
+			fprintf(stderr, "  the recording didn't survive save() and load()\n");
+			badLoaded++;
+		}
+		tft.replay(loaded);
+		tft.flush();
+		badLoaded += compare(emulator.display(), expected.data(), "loaded");
+	}
+	remove(path);
+	tft.setHardwareWait(false);
+
+	bool ok = report("capture", "submitted", calls * 4, "calls", badCapture);
+	ok = report("recording", "patched", calls * 4, "calls", badRecording) && ok;
+	return report("recording", "loaded", calls * 4, "calls", badLoaded) && ok;
+}
+
+static void drawAsync(hw::AsyncRA8875& async, const Call& c)
+{
+	const uint16_t* a = c.a;
+	switch (c.shape)
+	{
+	case Shape::Pixel:        async.drawPixel(int16_t(a[0]), int16_t(a[1]), c.color); break;
+	case Shape::Line:         async.drawLine(a[0], a[1], a[2], a[3], c.color); break;
+	case Shape::Rect:         async.drawRect(a[0], a[1], a[2], a[3], c.color); break;
+	case Shape::FillRect:     async.fillRect(a[0], a[1], a[2], a[3], c.color); break;
+	case Shape::Circle:       async.drawCircle(a[0], a[1], uint8_t(a[2]), c.color); break;
+	case Shape::FillCircle:   async.fillCircle(a[0], a[1], uint8_t(a[2]), c.color); break;
+	case Shape::Triangle:     async.drawTriangle(a[0], a[1], a[2], a[3], a[4], a[5], c.color); break;
+	case Shape::FillTriangle: async.fillTriangle(a[0], a[1], a[2], a[3], a[4], a[5], c.color); break;
+	case Shape::Ellipse:      async.drawEllipse(a[0], a[1], a[2], a[3], c.color); break;
+	case Shape::FillEllipse:  async.fillEllipse(a[0], a[1], a[2], a[3], c.color); break;
+	case Shape::Curve:        async.drawCurve(a[0], a[1], a[2], a[3], uint8_t(a[4]), c.color); break;
+	case Shape::FillCurve:    async.fillCurve(a[0], a[1], a[2], a[3], uint8_t(a[4]), c.color); break;
+	case Shape::Count:        break;
+	}
+}
+
+///
+/// Calls queued on an AsyncRA8875 run in order: a mix of primitives from
+/// one thread, then rectangles from two threads drawing into separate
+/// halves of the screen, each thread's calls staying in order.  Reads
+/// answer as the blocking calls do.
+///
+static bool checkAsync(hw::RA8875Emulator& emulator, hw::RA8875& tft, size_t calls)
+{
+	hw::Canvas expected(kWidth, kHeight);
+	std::vector<Call> halves[2];
+	size_t bad = 0;
+	uint8_t sysr = tft.readRegister8(TFT_Register::SYSR);
+
+	expected.fill(0);
+	for (size_t i = 0; i < calls; ++i)
+	{
+		for (int half = 0; half < 2; ++half)
+		{
+			Call c = randomCall(Shape::FillRect);
+			c.a[0] = uint16_t(c.a[0] / 2 + half * kWidth / 2);
+			c.a[2] = uint16_t(std::max(1, c.a[2] / 2));
+			halves[half].push_back(c);
+		}
+	}
+
+	{
+		hw::AsyncRA8875 async(tft, 64);
+		async.fillScreen(0);
+		for (size_t i = 0; i < calls; ++i)
+		{
+			Call c = randomCall(Shape(randomBelow(uint16_t(Shape::Count))));
+			drawAsync(async, c);
+			reference(expected, c);
+		}
+		async.fence().get();
+		bad += compare(emulator.display(), expected.data(), "async");
+		if (async.readRegister8(TFT_Register::SYSR).get() != sysr)
+		{
+			fprintf(stderr, "  async: SYSR reads differently\n");
+			bad++;
+		}
+
+		async.fillScreen(0);
+		expected.fill(0);
+		std::thread threads[2];
+		for (int half = 0; half < 2; ++half)
+		{
+			const std::vector<Call>& list = halves[half];
+			threads[half] = std::thread([&async, &list]() {
+				for (const Call& c : list)
+					drawAsync(async, c);
+			});
+			for (const Call& c : list)
+				reference(expected, c);
+		}
+		for (std::thread& t : threads)
+			t.join();
+		async.fence().get();
+		bad += compare(emulator.display(), expected.data(), "async threads");
+	}
+	return report("AsyncRA8875", "queued", calls * 3, "calls", bad);
+}
+
+static int usage()
+{
+	fprintf(stderr,
+		"usage: check [-n calls] [-f frames] [-s seed]\n"
+		"  -n        calls per primitive and path (default 20)\n"
+		"  -f        frames for the frame checks (default 48)\n"
+		"  -s        random seed (default 1)\n");
+	return 1;
+}
+
+int main(int argc, char* argv[])
+{
+	size_t calls = 20;
+	size_t frames = 48;
+	uint32_t seed = 1;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+			calls = size_t(std::max(1, atoi(argv[++i])));
+		else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+			frames = size_t(std::max(1, atoi(argv[++i])));
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+			seed = uint32_t(strtoul(argv[++i], nullptr, 0));
+		else
+			return usage();
+	}
+	s_random = seed != 0 ? seed : 1;
+
+	hw::RA8875Emulator emulator;
+	emulator.open();
+	hw::RA8875 tft(emulator);
+	if (!tft.begin(TFT_DisplaySize::_800x480))
+	{
+		fprintf(stderr, "Unable to initialise the emulated display\n");
+		return 1;
+	}
+
+	bool ok = true;
+	for (int p = 0; p < int(Path::Count); ++p)
+	{
+		for (int s = 0; s < int(Shape::Count); ++s)
+			ok = checkShape(emulator, tft, Shape(s), Path(p), calls) && ok;
+	}
+	ok = checkText(emulator, tft, calls) && ok;
+	ok = checkPixelFormats(emulator, tft) && ok;
+	ok = checkStreams(emulator, tft, calls) && ok;
+	ok = checkAsync(emulator, tft, calls) && ok;
+	ok = checkDiscarded(emulator, tft, false) && ok;
+	ok = checkDiscarded(emulator, tft, true) && ok;
+	ok = checkFramebufferFrames(emulator, tft) && ok;
+	ok = checkFrames(frames) && ok;
+
+	printf("%s\n", ok ? "all checks passed" : "some checks FAILED");
+	return ok ? 0 : 1;
+}
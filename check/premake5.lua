@@ -0,0 +1,28 @@
+project 'check'
+	kind 'consoleapp'
+	language 'c++'
+	flags { "C++11" }
+
+	includedirs { '.', '../libusb', '../libftdi', '../libtft' }
+	files { 'main.cpp' }
+	
+	links {
+		'libtft',
+		'libftdi',
+		'libusb'
+	}
+
+-- RA8875Coroutines.h needs C++20; the library itself stays C++11.
+project 'checkCoroutines'
+	kind 'consoleapp'
+	language 'c++'
+	cppdialect 'C++20'
+
+	includedirs { '.', '../libusb', '../libftdi', '../libtft' }
+	files { 'coroutines.cpp' }
+	
+	links {
+		'libtft',
+		'libftdi',
+		'libusb'
+	}
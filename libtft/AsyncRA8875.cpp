@@ -0,0 +1,276 @@
+#include "AsyncRA8875.h"
+#include "Timeline.h"
+#include <chrono>
+#include <memory>
+
+namespace hw
+{
+	AsyncRA8875::AsyncRA8875(RA8875& tft, size_t capacity)
+		: m_tft(tft)
+		, m_queue(capacity)
+		, m_sleeping(false)
+		, m_stop(false)
+		, m_callsRun(0)
+		, m_batches(0)
+		, m_fullWaits(0)
+	{
+		m_thread = std::thread(&AsyncRA8875::deviceThread, this);
+	}
+
+	/*
+	 * Calls already queued are still run and sent.
+	 */
+	AsyncRA8875::~AsyncRA8875()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_stop = true;
+		}
+		m_wake.notify_one();
+		m_thread.join();
+	}
+
+	void AsyncRA8875::fillScreen(uint16_t color)
+	{
+		queue(Op::FillScreen, color);
+	}
+
+	void AsyncRA8875::drawPixel(int16_t x, int16_t y, uint16_t color)
+	{
+		queue(Op::DrawPixel, uint16_t(x), uint16_t(y), color);
+	}
+
+	void AsyncRA8875::drawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t color)
+	{
+		queue(Op::DrawLine, x0, y0, x1, y1, color);
+	}
+
+	void AsyncRA8875::drawRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color)
+	{
+		queue(Op::DrawRect, x, y, w, h, color);
+	}
+
+	void AsyncRA8875::fillRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color)
+	{
+		queue(Op::FillRect, x, y, w, h, color);
+	}
+
+	void AsyncRA8875::drawCircle(uint16_t x0, uint16_t y0, uint8_t r, uint16_t color)
+	{
+		queue(Op::DrawCircle, x0, y0, r, color);
+	}
+
+	void AsyncRA8875::fillCircle(uint16_t x0, uint16_t y0, uint8_t r, uint16_t color)
+	{
+		queue(Op::FillCircle, x0, y0, r, color);
+	}
+
+	void AsyncRA8875::drawTriangle(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color)
+	{
+		queue(Op::DrawTriangle, x0, y0, x1, y1, x2, y2, color);
+	}
+
+	void AsyncRA8875::fillTriangle(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color)
+	{
+		queue(Op::FillTriangle, x0, y0, x1, y1, x2, y2, color);
+	}
+
+	void AsyncRA8875::drawEllipse(uint16_t xCenter, uint16_t yCenter, uint16_t longAxis, uint16_t shortAxis, uint16_t color)
+	{
+		queue(Op::DrawEllipse, xCenter, yCenter, longAxis, shortAxis, color);
+	}
+
+	void AsyncRA8875::fillEllipse(uint16_t xCenter, uint16_t yCenter, uint16_t longAxis, uint16_t shortAxis, uint16_t color)
+	{
+		queue(Op::FillEllipse, xCenter, yCenter, longAxis, shortAxis, color);
+	}
+
+	void AsyncRA8875::drawCurve(uint16_t xCenter, uint16_t yCenter, uint16_t longAxis, uint16_t shortAxis, uint8_t curvePart, uint16_t color)
+	{
+		queue(Op::DrawCurve, xCenter, yCenter, longAxis, shortAxis, curvePart, color);
+	}
+
+	void AsyncRA8875::fillCurve(uint16_t xCenter, uint16_t yCenter, uint16_t longAxis, uint16_t shortAxis, uint8_t curvePart, uint16_t color)
+	{
+		queue(Op::FillCurve, xCenter, yCenter, longAxis, shortAxis, curvePart, color);
+	}
+
+	void AsyncRA8875::graphicsMode()
+	{
+		queue(Op::GraphicsMode);
+	}
+
+	void AsyncRA8875::textMode()
+	{
+		queue(Op::TextMode);
+	}
+
+	void AsyncRA8875::textSetCursor(uint16_t x, uint16_t y)
+	{
+		queue(Op::TextSetCursor, x, y);
+	}
+
+	void AsyncRA8875::textColor(uint16_t foreColor, uint16_t bgColor)
+	{
+		queue(Op::TextColor, foreColor, bgColor);
+	}
+
+	void AsyncRA8875::textTransparent(uint16_t foreColor)
+	{
+		queue(Op::TextTransparent, foreColor);
+	}
+
+	void AsyncRA8875::textWrite(const char* buffer)
+	{
+		Command cmd;
+		cmd.op = Op::TextWrite;
+		cmd.text = buffer;
+		push(cmd);
+	}
+
+	std::future<bool> AsyncRA8875::touched()
+	{
+		std::shared_ptr<std::promise<bool>> promise(new std::promise<bool>);
+		post([promise](RA8875& tft) {
+			promise->set_value(tft.touched());
+		});
+		return promise->get_future();
+	}
+
+	std::future<AsyncRA8875::TouchSample> AsyncRA8875::touchRead()
+	{
+		std::shared_ptr<std::promise<TouchSample>> promise(new std::promise<TouchSample>);
+		post([promise](RA8875& tft) {
+			TouchSample sample = { false, 0, 0 };
+			sample.touched = tft.touchRead(&sample.x, &sample.y);
+			promise->set_value(sample);
+		});
+		return promise->get_future();
+	}
+
+	std::future<uint8_t> AsyncRA8875::readRegister8(TFT_Register reg)
+	{
+		std::shared_ptr<std::promise<uint8_t>> promise(new std::promise<uint8_t>);
+		post([promise, reg](RA8875& tft) {
+			promise->set_value(tft.readRegister8(reg));
+		});
+		return promise->get_future();
+	}
+
+	void AsyncRA8875::post(std::function<void(RA8875&)> call)
+	{
+		Command cmd;
+		cmd.op = Op::Call;
+		cmd.call = std::move(call);
+		push(cmd);
+	}
+
+	std::future<void> AsyncRA8875::fence()
+	{
+		std::shared_ptr<std::promise<void>> promise(new std::promise<void>);
+		post([promise](RA8875& tft) {
+			tft.flush();
+			promise->set_value();
+		});
+		return promise->get_future();
+	}
+
+	void AsyncRA8875::queue(Op op, uint16_t a0, uint16_t a1, uint16_t a2, uint16_t a3, uint16_t a4, uint16_t a5, uint16_t a6)
+	{
+		Command cmd;
+		cmd.op = op;
+		cmd.arg[0] = a0;
+		cmd.arg[1] = a1;
+		cmd.arg[2] = a2;
+		cmd.arg[3] = a3;
+		cmd.arg[4] = a4;
+		cmd.arg[5] = a5;
+		cmd.arg[6] = a6;
+		push(cmd);
+	}
+
+	/*
+	 * The fences pair with the device thread's: either it sees the new
+	 * command before going to sleep, or we see it sleeping and wake it.
+	 */
+	void AsyncRA8875::push(Command& cmd)
+	{
+		if (!m_queue.tryPush(std::move(cmd)))
+		{
+			m_fullWaits++;
+			while (!m_queue.tryPush(std::move(cmd)))
+				std::this_thread::yield();
+		}
+
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (m_sleeping.load())
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_wake.notify_one();
+		}
+	}
+
+	void AsyncRA8875::run(Command& cmd)
+	{
+		const uint16_t* a = cmd.arg;
+		switch (cmd.op)
+		{
+		case Op::FillScreen:      m_tft.fillScreen(a[0]); break;
+		case Op::DrawPixel:       m_tft.drawPixel(int16_t(a[0]), int16_t(a[1]), a[2]); break;
+		case Op::DrawLine:        m_tft.drawLine(a[0], a[1], a[2], a[3], a[4]); break;
+		case Op::DrawRect:        m_tft.drawRect(a[0], a[1], a[2], a[3], a[4]); break;
+		case Op::FillRect:        m_tft.fillRect(a[0], a[1], a[2], a[3], a[4]); break;
+		case Op::DrawCircle:      m_tft.drawCircle(a[0], a[1], uint8_t(a[2]), a[3]); break;
+		case Op::FillCircle:      m_tft.fillCircle(a[0], a[1], uint8_t(a[2]), a[3]); break;
+		case Op::DrawTriangle:    m_tft.drawTriangle(a[0], a[1], a[2], a[3], a[4], a[5], a[6]); break;
+		case Op::FillTriangle:    m_tft.fillTriangle(a[0], a[1], a[2], a[3], a[4], a[5], a[6]); break;
+		case Op::DrawEllipse:     m_tft.drawEllipse(a[0], a[1], a[2], a[3], a[4]); break;
+		case Op::FillEllipse:     m_tft.fillEllipse(a[0], a[1], a[2], a[3], a[4]); break;
+		case Op::DrawCurve:       m_tft.drawCurve(a[0], a[1], a[2], a[3], uint8_t(a[4]), a[5]); break;
+		case Op::FillCurve:       m_tft.fillCurve(a[0], a[1], a[2], a[3], uint8_t(a[4]), a[5]); break;
+		case Op::GraphicsMode:    m_tft.graphicsMode(); break;
+		case Op::TextMode:        m_tft.textMode(); break;
+		case Op::TextSetCursor:   m_tft.textSetCursor(a[0], a[1]); break;
+		case Op::TextColor:       m_tft.textColor(a[0], a[1]); break;
+		case Op::TextTransparent: m_tft.textTransparent(a[0]); break;
+		case Op::TextWrite:       m_tft.textWrite(cmd.text.c_str()); break;
+		case Op::Call:            cmd.call(m_tft); cmd.call = nullptr; break;
+		}
+	}
+
+	/*
+	 * Run whatever is queued, up to kMaxBatch calls, then flush the device
+	 * so the batch goes out together.  When the ring is empty, sleep until
+	 * a producer wakes us; the timeout is only a safety net.
+	 */
+	void AsyncRA8875::deviceThread()
+	{
+		for (;;)
+		{
+			Command cmd;
+			size_t n = 0;
+			while (n < kMaxBatch && m_queue.tryPop(cmd))
+			{
+				run(cmd);
+				++n;
+			}
+
+			if (n > 0)
+			{
+				TFT_TIMELINE_SCOPE("async", "flush", "calls", int64_t(n));
+				m_tft.flush();
+				m_callsRun += n;
+				m_batches++;
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(m_lock);
+			if (m_stop)
+				return;
+			m_sleeping = true;
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			m_wake.wait_for(lock, std::chrono::milliseconds(10), [&] { return m_stop.load() || !m_queue.empty(); });
+			m_sleeping = false;
+		}
+	}
+}
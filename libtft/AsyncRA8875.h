@@ -0,0 +1,141 @@
+#pragma once
+
+#include "MpscQueue.h"
+#include "RA8875.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+
+namespace hw
+{
+	///
+	/// A thread-safe front end to an RA8875.  Any thread may queue calls,
+	/// which go into a lock-free ring; a single device thread runs them
+	/// against the RA8875 in order, and flushes the device once the ring
+	/// is empty, so calls that arrive together go out together (with the
+	/// FT232H in buffered mode, as one USB write).  Reads come back as
+	/// futures.  Producers only wait while the ring is full.
+	///
+	/// The RA8875 belongs to the device thread while this object exists:
+	/// reach it through post() rather than directly.
+	///
+	class AsyncRA8875
+	{
+	public:
+		// Touch coordinates; 'touched' false when there was no touch event.
+		struct TouchSample
+		{
+			bool     touched;
+			uint16_t x;
+			uint16_t y;
+		};
+
+		explicit AsyncRA8875(RA8875& tft, size_t capacity = 1024);
+		~AsyncRA8875();
+
+		AsyncRA8875(const AsyncRA8875&) = delete;
+		AsyncRA8875& operator=(const AsyncRA8875&) = delete;
+
+		/* Queued calls, same meaning as the RA8875 methods */
+		void    fillScreen(uint16_t color);
+		void    drawPixel(int16_t x, int16_t y, uint16_t color);
+		void    drawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t color);
+		void    drawRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color);
+		void    fillRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color);
+		void    drawCircle(uint16_t x0, uint16_t y0, uint8_t r, uint16_t color);
+		void    fillCircle(uint16_t x0, uint16_t y0, uint8_t r, uint16_t color);
+		void    drawTriangle(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color);
+		void    fillTriangle(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color);
+		void    drawEllipse(uint16_t xCenter, uint16_t yCenter, uint16_t longAxis, uint16_t shortAxis, uint16_t color);
+		void    fillEllipse(uint16_t xCenter, uint16_t yCenter, uint16_t longAxis, uint16_t shortAxis, uint16_t color);
+		void    drawCurve(uint16_t xCenter, uint16_t yCenter, uint16_t longAxis, uint16_t shortAxis, uint8_t curvePart, uint16_t color);
+		void    fillCurve(uint16_t xCenter, uint16_t yCenter, uint16_t longAxis, uint16_t shortAxis, uint8_t curvePart, uint16_t color);
+		void    graphicsMode();
+		void    textMode();
+		void    textSetCursor(uint16_t x, uint16_t y);
+		void    textColor(uint16_t foreColor, uint16_t bgColor);
+		void    textTransparent(uint16_t foreColor);
+		void    textWrite(const char* buffer);
+
+		/* Reads */
+		std::future<bool>        touched();
+		std::future<TouchSample> touchRead();
+		std::future<uint8_t>     readRegister8(TFT_Register reg);
+
+		// Anything else, run on the device thread in queue order.
+		void    post(std::function<void(RA8875&)> call);
+		// Ready once everything queued before it has been sent.
+		std::future<void> fence();
+
+		/* Counters */
+		uint64_t callsRun() const { return m_callsRun.load(); }
+		uint64_t batches() const { return m_batches.load(); }
+		uint64_t fullWaits() const { return m_fullWaits.load(); }
+
+	private:
+		enum class Op : uint8_t
+		{
+			FillScreen,
+			DrawPixel,
+			DrawLine,
+			DrawRect,
+			FillRect,
+			DrawCircle,
+			FillCircle,
+			DrawTriangle,
+			FillTriangle,
+			DrawEllipse,
+			FillEllipse,
+			DrawCurve,
+			FillCurve,
+			GraphicsMode,
+			TextMode,
+			TextSetCursor,
+			TextColor,
+			TextTransparent,
+			TextWrite,
+			Call,
+		};
+
+		// Draw calls carry their arguments inline; only text and Call
+		// allocate.
+		struct Command
+		{
+			Op          op;
+			uint16_t    arg[7];
+			std::string text;
+			std::function<void(RA8875&)> call;
+		};
+
+		// Calls run before the device is flushed, bounding the latency of
+		// the first one under a steady stream.
+		static const size_t kMaxBatch = 256;
+
+		void    queue(Op op, uint16_t a0 = 0, uint16_t a1 = 0, uint16_t a2 = 0, uint16_t a3 = 0,
+		              uint16_t a4 = 0, uint16_t a5 = 0, uint16_t a6 = 0);
+		void    push(Command& cmd);
+		void    run(Command& cmd);
+		void    deviceThread();
+
+	private:
+		RA8875&                 m_tft;
+		MpscQueue<Command>      m_queue;
+
+		// The device thread sleeps on m_wake when idle; producers take the
+		// lock only to wake it.
+		std::mutex              m_lock;
+		std::condition_variable m_wake;
+		std::atomic<bool>       m_sleeping;
+		std::atomic<bool>       m_stop;
+
+		std::atomic<uint64_t>   m_callsRun;
+		std::atomic<uint64_t>   m_batches;
+		std::atomic<uint64_t>   m_fullWaits;
+		std::thread             m_thread;
+	};
+}
@@ -0,0 +1,272 @@
+#include "Canvas.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+
+namespace hw
+{
+	Canvas::Canvas(int width, int height)
+		: m_width(0)
+		, m_height(0)
+	{
+		resize(width, height);
+	}
+
+	void Canvas::resize(int width, int height)
+	{
+		m_width = std::max(width, 0);
+		m_height = std::max(height, 0);
+		m_pixels.assign(size_t(m_width) * size_t(m_height), 0);
+		resetClip();
+	}
+
+	void Canvas::setClip(int x0, int y0, int x1, int y1)
+	{
+		m_clipX0 = std::max(std::min(x0, x1), 0);
+		m_clipY0 = std::max(std::min(y0, y1), 0);
+		m_clipX1 = std::min(std::max(x0, x1), m_width - 1);
+		m_clipY1 = std::min(std::max(y0, y1), m_height - 1);
+	}
+
+	void Canvas::resetClip()
+	{
+		setClip(0, 0, m_width - 1, m_height - 1);
+	}
+
+	uint16_t Canvas::getPixel(int x, int y) const
+	{
+		if (x < 0 || y < 0 || x >= m_width || y >= m_height)
+			return 0;
+		return m_pixels[size_t(y) * m_width + x];
+	}
+
+	void Canvas::drawPixel(int x, int y, uint16_t color)
+	{
+		if (x < m_clipX0 || x > m_clipX1 || y < m_clipY0 || y > m_clipY1)
+			return;
+		m_pixels[size_t(y) * m_width + x] = color;
+	}
+
+	void Canvas::drawHLine(int x0, int x1, int y, uint16_t color)
+	{
+		if (x0 > x1)
+			std::swap(x0, x1);
+		if (y < m_clipY0 || y > m_clipY1)
+			return;
+
+		x0 = std::max(x0, m_clipX0);
+		x1 = std::min(x1, m_clipX1);
+		if (x0 > x1)
+			return;
+
+		uint16_t* row = &m_pixels[size_t(y) * m_width];
+		std::fill(row + x0, row + x1 + 1, color);
+	}
+
+	void Canvas::fill(uint16_t color)
+	{
+		fillRect(m_clipX0, m_clipY0, m_clipX1, m_clipY1, color);
+	}
+
+	void Canvas::drawLine(int x0, int y0, int x1, int y1, uint16_t color)
+	{
+		// Bresenham.
+		int dx = std::abs(x1 - x0);
+		int dy = -std::abs(y1 - y0);
+		int sx = x0 < x1 ? 1 : -1;
+		int sy = y0 < y1 ? 1 : -1;
+		int err = dx + dy;
+
+		while (true)
+		{
+			drawPixel(x0, y0, color);
+			if (x0 == x1 && y0 == y1)
+				break;
+
+			int e2 = 2 * err;
+			if (e2 >= dy)
+			{
+				err += dy;
+				x0 += sx;
+			}
+			if (e2 <= dx)
+			{
+				err += dx;
+				y0 += sy;
+			}
+		}
+	}
+
+	void Canvas::drawRect(int x0, int y0, int x1, int y1, uint16_t color)
+	{
+		drawHLine(x0, x1, y0, color);
+		drawHLine(x0, x1, y1, color);
+		drawLine(x0, y0, x0, y1, color);
+		drawLine(x1, y0, x1, y1, color);
+	}
+
+	void Canvas::fillRect(int x0, int y0, int x1, int y1, uint16_t color)
+	{
+		if (y0 > y1)
+			std::swap(y0, y1);
+		for (int y = std::max(y0, m_clipY0); y <= std::min(y1, m_clipY1); ++y)
+			drawHLine(x0, x1, y, color);
+	}
+
+	void Canvas::drawTriangle(int x0, int y0, int x1, int y1, int x2, int y2, uint16_t color)
+	{
+		drawLine(x0, y0, x1, y1, color);
+		drawLine(x1, y1, x2, y2, color);
+		drawLine(x2, y2, x0, y0, color);
+	}
+
+	static int edgeX(int xa, int ya, int xb, int yb, int y)
+	{
+		if (ya == yb)
+			return xa;
+		return xa + int((long long)(xb - xa) * (y - ya) / (yb - ya));
+	}
+
+	void Canvas::fillTriangle(int x0, int y0, int x1, int y1, int x2, int y2, uint16_t color)
+	{
+		// Sort by y, then fill one span per row between the long edge (0-2)
+		// and the two short ones.
+		if (y0 > y1) { std::swap(x0, x1); std::swap(y0, y1); }
+		if (y1 > y2) { std::swap(x1, x2); std::swap(y1, y2); }
+		if (y0 > y1) { std::swap(x0, x1); std::swap(y0, y1); }
+
+		for (int y = std::max(y0, m_clipY0); y <= std::min(y2, m_clipY1); ++y)
+		{
+			int xa = edgeX(x0, y0, x2, y2, y);
+			int xb = y < y1 ? edgeX(x0, y0, x1, y1, y) : edgeX(x1, y1, x2, y2, y);
+			drawHLine(xa, xb, y, color);
+		}
+
+		// Rows where two vertices meet need both ends.
+		drawLine(x0, y0, x1, y1, color);
+		drawLine(x1, y1, x2, y2, color);
+	}
+
+	void Canvas::drawEllipse(int cx, int cy, int a, int b, uint16_t color, uint8_t quadrants)
+	{
+		ellipse(cx, cy, a, b, color, quadrants, false);
+	}
+
+	void Canvas::fillEllipse(int cx, int cy, int a, int b, uint16_t color, uint8_t quadrants)
+	{
+		ellipse(cx, cy, a, b, color, quadrants, true);
+	}
+
+	///
+	/// Midpoint ellipse with horizontal axis 'a' and vertical axis 'b'.
+	///
+	void Canvas::ellipse(int cx, int cy, int a, int b, uint16_t color, uint8_t quadrants, bool filled)
+	{
+		if (a < 0 || b < 0)
+			return;
+		if (b == 0)
+		{
+			// Flat: the loops below would only reach the centre.
+			drawHLine((quadrants & (LowerLeft | UpperLeft)) ? cx - a : cx,
+				(quadrants & (LowerRight | UpperRight)) ? cx + a : cx, cy, color);
+			return;
+		}
+
+		long long a2 = (long long)a * a;
+		long long b2 = (long long)b * b;
+		int x = 0;
+		int y = b;
+		long long dx = 0;
+		long long dy = 2 * a2 * y;
+
+		// Region 1: slope above -1.
+		double d1 = b2 - a2 * b + 0.25 * a2;
+		while (dx < dy)
+		{
+			ellipsePoints(cx, cy, x, y, color, quadrants, filled);
+			++x;
+			dx += 2 * b2;
+			if (d1 < 0)
+			{
+				d1 += dx + b2;
+			}
+			else
+			{
+				--y;
+				dy -= 2 * a2;
+				d1 += dx - dy + b2;
+			}
+		}
+
+		// Region 2: the steep part down to the horizontal axis.
+		double d2 = b2 * (x + 0.5) * (x + 0.5) + a2 * double(y - 1) * (y - 1) - double(a2) * b2;
+		while (y >= 0)
+		{
+			ellipsePoints(cx, cy, x, y, color, quadrants, filled);
+			--y;
+			dy -= 2 * a2;
+			if (d2 > 0)
+			{
+				d2 += a2 - dy;
+			}
+			else
+			{
+				++x;
+				dx += 2 * b2;
+				d2 += dx - dy + a2;
+			}
+		}
+	}
+
+	void Canvas::ellipsePoints(int cx, int cy, int x, int y, uint16_t color, uint8_t quadrants, bool filled)
+	{
+		if (filled)
+		{
+			if (quadrants & LowerLeft)  drawHLine(cx - x, cx, cy + y, color);
+			if (quadrants & UpperLeft)  drawHLine(cx - x, cx, cy - y, color);
+			if (quadrants & UpperRight) drawHLine(cx, cx + x, cy - y, color);
+			if (quadrants & LowerRight) drawHLine(cx, cx + x, cy + y, color);
+		}
+		else
+		{
+			if (quadrants & LowerLeft)  drawPixel(cx - x, cy + y, color);
+			if (quadrants & UpperLeft)  drawPixel(cx - x, cy - y, color);
+			if (quadrants & UpperRight) drawPixel(cx + x, cy - y, color);
+			if (quadrants & LowerRight) drawPixel(cx + x, cy + y, color);
+		}
+	}
+
+	bool Canvas::savePPM(const char* path) const
+	{
+		FILE* f = fopen(path, "wb");
+		if (f == nullptr)
+		{
+			fprintf(stderr, "Unable to write %s\n", path);
+			return false;
+		}
+
+		fprintf(f, "P6\n%d %d\n255\n", m_width, m_height);
+
+		std::vector<uint8_t> row(size_t(m_width) * 3);
+		bool ok = true;
+		for (int y = 0; ok && y < m_height; ++y)
+		{
+			const uint16_t* src = &m_pixels[size_t(y) * m_width];
+			for (int x = 0; x < m_width; ++x)
+			{
+				// Replicate the top bits so full scale maps to 255.
+				uint8_t r = uint8_t((src[x] >> 11) & 0x1F);
+				uint8_t g = uint8_t((src[x] >> 5) & 0x3F);
+				uint8_t b = uint8_t(src[x] & 0x1F);
+				row[x * 3 + 0] = uint8_t(r << 3 | r >> 2);
+				row[x * 3 + 1] = uint8_t(g << 2 | g >> 4);
+				row[x * 3 + 2] = uint8_t(b << 3 | b >> 2);
+			}
+			ok = fwrite(row.data(), 1, row.size(), f) == row.size();
+		}
+
+		fclose(f);
+		return ok;
+	}
+}
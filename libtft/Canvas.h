@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+namespace hw
+{
+	///
+	/// An RGB565 pixel buffer with a software version of the RA8875 drawing
+	/// primitives.  Coordinates are inclusive corners, as in the RA8875
+	/// registers, and everything is clipped to the clip window.
+	///
+	class Canvas
+	{
+	public:
+		// Ellipse quadrants, in the RA8875 curve part order.
+		enum Quadrant : uint8_t
+		{
+			LowerLeft  = 0x01,
+			UpperLeft  = 0x02,
+			UpperRight = 0x04,
+			LowerRight = 0x08,
+			AllQuadrants = 0x0F,
+		};
+
+		Canvas(int width = 0, int height = 0);
+
+		void      resize(int width, int height);
+		int       width() const { return m_width; }
+		int       height() const { return m_height; }
+		uint16_t* data() { return m_pixels.data(); }
+		const uint16_t* data() const { return m_pixels.data(); }
+
+		void      setClip(int x0, int y0, int x1, int y1);
+		void      resetClip();
+		int       clipX0() const { return m_clipX0; }
+		int       clipY0() const { return m_clipY0; }
+		int       clipX1() const { return m_clipX1; }
+		int       clipY1() const { return m_clipY1; }
+
+		uint16_t  getPixel(int x, int y) const;
+		void      drawPixel(int x, int y, uint16_t color);
+		void      drawHLine(int x0, int x1, int y, uint16_t color);
+		void      fill(uint16_t color);
+
+		void      drawLine(int x0, int y0, int x1, int y1, uint16_t color);
+		void      drawRect(int x0, int y0, int x1, int y1, uint16_t color);
+		void      fillRect(int x0, int y0, int x1, int y1, uint16_t color);
+		void      drawTriangle(int x0, int y0, int x1, int y1, int x2, int y2, uint16_t color);
+		void      fillTriangle(int x0, int y0, int x1, int y1, int x2, int y2, uint16_t color);
+		void      drawEllipse(int cx, int cy, int a, int b, uint16_t color, uint8_t quadrants = AllQuadrants);
+		void      fillEllipse(int cx, int cy, int a, int b, uint16_t color, uint8_t quadrants = AllQuadrants);
+
+		// Binary PPM (P6), 8 bits per channel.
+		bool      savePPM(const char* path) const;
+
+	private:
+		void      ellipse(int cx, int cy, int a, int b, uint16_t color, uint8_t quadrants, bool filled);
+		void      ellipsePoints(int cx, int cy, int x, int y, uint16_t color, uint8_t quadrants, bool filled);
+
+	private:
+		int       m_width;
+		int       m_height;
+		int       m_clipX0, m_clipY0, m_clipX1, m_clipY1;
+		std::vector<uint16_t> m_pixels;
+	};
+}
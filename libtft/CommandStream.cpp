@@ -0,0 +1,214 @@
+#include "CommandStream.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace hw
+{
+	// File layout, all integers little endian:
+	//   "RA8875CS" u32 version
+	//   u8 colour depth (from version 2; version 1 files are 16bpp)
+	//   u32 size, size bytes of stream
+	//   u32 groups, per group: u16 length, name
+	//   u32 patches, per patch: u32 offset, u16 group, u8 register
+	static const char     kMagic[8] = { 'R', 'A', '8', '8', '7', '5', 'C', 'S' };
+	static const uint32_t kVersion  = 2;
+
+	static bool writeU32(FILE* f, uint32_t v)
+	{
+		uint8_t b[] = { uint8_t(v), uint8_t(v >> 8), uint8_t(v >> 16), uint8_t(v >> 24) };
+		return fwrite(b, 1, 4, f) == 4;
+	}
+
+	static bool writeU16(FILE* f, uint16_t v)
+	{
+		uint8_t b[] = { uint8_t(v), uint8_t(v >> 8) };
+		return fwrite(b, 1, 2, f) == 2;
+	}
+
+	static bool readU32(FILE* f, uint32_t& v)
+	{
+		uint8_t b[4];
+		if (fread(b, 1, 4, f) != 4)
+			return false;
+		v = uint32_t(b[0]) | uint32_t(b[1]) << 8 | uint32_t(b[2]) << 16 | uint32_t(b[3]) << 24;
+		return true;
+	}
+
+	static bool readU16(FILE* f, uint16_t& v)
+	{
+		uint8_t b[2];
+		if (fread(b, 1, 2, f) != 2)
+			return false;
+		v = uint16_t(b[0] | b[1] << 8);
+		return true;
+	}
+
+	CommandStream::CommandStream()
+		: m_colorDepth(16)
+	{
+	}
+
+	void CommandStream::clear()
+	{
+		m_bytes.clear();
+		m_patches.clear();
+		m_groups.clear();
+		m_colorDepth = 16;
+	}
+
+	bool CommandStream::save(const char* path) const
+	{
+		FILE* f = fopen(path, "wb");
+		if (f == nullptr)
+		{
+			fprintf(stderr, "Unable to write command stream %s\n", path);
+			return false;
+		}
+
+		bool ok = fwrite(kMagic, 1, sizeof(kMagic), f) == sizeof(kMagic)
+			&& writeU32(f, kVersion)
+			&& fwrite(&m_colorDepth, 1, 1, f) == 1
+			&& writeU32(f, uint32_t(m_bytes.size()))
+			&& fwrite(m_bytes.data(), 1, m_bytes.size(), f) == m_bytes.size()
+			&& writeU32(f, uint32_t(m_groups.size()));
+
+		for (size_t i = 0; ok && i < m_groups.size(); ++i)
+		{
+			ok = writeU16(f, uint16_t(m_groups[i].size()))
+				&& fwrite(m_groups[i].data(), 1, m_groups[i].size(), f) == m_groups[i].size();
+		}
+
+		ok = ok && writeU32(f, uint32_t(m_patches.size()));
+		for (size_t i = 0; ok && i < m_patches.size(); ++i)
+		{
+			const Patch& p = m_patches[i];
+			ok = writeU32(f, p.offset) && writeU16(f, p.group) && fwrite(&p.reg, 1, 1, f) == 1;
+		}
+
+		fclose(f);
+		return ok;
+	}
+
+	bool CommandStream::load(const char* path)
+	{
+		clear();
+
+		FILE* f = fopen(path, "rb");
+		if (f == nullptr)
+		{
+			fprintf(stderr, "Unable to read command stream %s\n", path);
+			return false;
+		}
+
+		char     magic[sizeof(kMagic)];
+		uint32_t version = 0;
+		uint32_t count = 0;
+
+		bool ok = fread(magic, 1, sizeof(magic), f) == sizeof(magic)
+			&& memcmp(magic, kMagic, sizeof(kMagic)) == 0
+			&& readU32(f, version) && (version == 1 || version == kVersion)
+			&& (version == 1 || (fread(&m_colorDepth, 1, 1, f) == 1 && (m_colorDepth == 8 || m_colorDepth == 16)))
+			&& readU32(f, count);
+
+		if (ok)
+		{
+			m_bytes.resize(count);
+			ok = fread(m_bytes.data(), 1, count, f) == count && readU32(f, count);
+		}
+
+		for (uint32_t i = 0; ok && i < count; ++i)
+		{
+			uint16_t length = 0;
+			ok = readU16(f, length);
+			if (ok)
+			{
+				std::string name(length, '\0');
+				ok = fread(&name[0], 1, length, f) == length;
+				m_groups.push_back(name);
+			}
+		}
+
+		ok = ok && readU32(f, count);
+		for (uint32_t i = 0; ok && i < count; ++i)
+		{
+			Patch p;
+			ok = readU32(f, p.offset) && readU16(f, p.group) && fread(&p.reg, 1, 1, f) == 1
+				&& p.offset < m_bytes.size() && p.group < m_groups.size();
+			m_patches.push_back(p);
+		}
+
+		fclose(f);
+		if (!ok)
+		{
+			fprintf(stderr, "Malformed command stream %s\n", path);
+			clear();
+		}
+		return ok;
+	}
+
+	///
+	/// Overwrite every value written to 'reg' inside the patch group.
+	/// Returns false if the group never wrote that register.
+	///
+	bool CommandStream::patchRegister8(const char* group, TFT_Register reg, uint8_t val)
+	{
+		int index = findGroup(group);
+		if (index < 0)
+			return false;
+
+		bool found = false;
+		for (const Patch& p : m_patches)
+		{
+			if (p.group == index && p.reg == reg)
+			{
+				m_bytes[p.offset] = val;
+				found = true;
+			}
+		}
+		return found;
+	}
+
+	bool CommandStream::patchRegister16(const char* group, TFT_Register reg, uint16_t val)
+	{
+		bool lo = patchRegister8(group, TFT_Register(reg + 0), uint8_t(val & 0xFF));
+		bool hi = patchRegister8(group, TFT_Register(reg + 1), uint8_t(val >> 8));
+		return lo || hi;
+	}
+
+	///
+	/// Packed like RA8875::setColorRegister() packed it when recording.
+	///
+	bool CommandStream::patchColor(const char* group, TFT_Register reg, uint16_t color)
+	{
+		uint8_t rgb[3];
+		colorRegisters(color, m_colorDepth, rgb);
+		bool r = patchRegister8(group, TFT_Register(reg + 0), rgb[0]);
+		bool g = patchRegister8(group, TFT_Register(reg + 1), rgb[1]);
+		bool b = patchRegister8(group, TFT_Register(reg + 2), rgb[2]);
+		return r || g || b;
+	}
+
+	int CommandStream::findGroup(const char* group) const
+	{
+		for (size_t i = 0; i < m_groups.size(); ++i)
+		{
+			if (m_groups[i] == group)
+				return int(i);
+		}
+		return -1;
+	}
+
+	void CommandStream::addGroup(const char* name)
+	{
+		m_groups.push_back(name);
+	}
+
+	void CommandStream::addPatch(size_t offset, uint8_t reg)
+	{
+		if (m_groups.empty())
+			return;
+
+		Patch p = { uint32_t(offset), uint16_t(m_groups.size() - 1), reg };
+		m_patches.push_back(p);
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "RA8875.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace hw
+{
+	///
+	/// A recorded RA8875 command stream that can be replayed any number of
+	/// times with a single device write, e.g. for static screen chrome.
+	///
+	/// While recording, RA8875::markPatch() opens a named patch group; every
+	/// register written after it is listed in the patch table, so colours and
+	/// coordinates can later be changed in place without re-encoding.
+	/// Recording, like DisplayList encoding, needs setHardwareWait(true).
+	///
+	class CommandStream
+	{
+	public:
+		CommandStream();
+
+		void    clear();
+		bool    empty() const { return m_bytes.empty(); }
+		// The colour depth at recording time, which patchColor() packs for.
+		uint8_t colorDepth() const { return m_colorDepth; }
+		const std::vector<uint8_t>& bytes() const { return m_bytes; }
+
+		/* Persistence */
+		bool    save(const char* path) const;
+		bool    load(const char* path);
+
+		/* Patching, 'group' is the name given to RA8875::markPatch() */
+		bool    patchRegister8(const char* group, TFT_Register reg, uint8_t val);
+		bool    patchRegister16(const char* group, TFT_Register reg, uint16_t val);
+		bool    patchColor(const char* group, TFT_Register reg, uint16_t color);
+
+	private:
+		friend class RA8875;
+
+		struct Patch
+		{
+			uint32_t offset;    // of the register value within m_bytes
+			uint16_t group;
+			uint8_t  reg;
+		};
+
+		int     findGroup(const char* group) const;
+		void    addGroup(const char* name);
+		void    addPatch(size_t offset, uint8_t reg);
+
+	private:
+		std::vector<uint8_t>     m_bytes;
+		std::vector<Patch>       m_patches;
+		std::vector<std::string> m_groups;
+		uint8_t                  m_colorDepth;
+	};
+}
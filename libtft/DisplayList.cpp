@@ -0,0 +1,161 @@
+#include "DisplayList.h"
+
+namespace hw
+{
+	DisplayList::DisplayList()
+	{
+	}
+
+	void DisplayList::clear()
+	{
+		m_commands.clear();
+		m_text.clear();
+		m_stream.clear();
+	}
+
+	void DisplayList::fillScreen(uint16_t color)
+	{
+		record(Op::FillScreen, color);
+	}
+
+	void DisplayList::drawPixel(int16_t x, int16_t y, uint16_t color)
+	{
+		record(Op::DrawPixel, uint16_t(x), uint16_t(y), color);
+	}
+
+	void DisplayList::drawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t color)
+	{
+		record(Op::DrawLine, x0, y0, x1, y1, color);
+	}
+
+	void DisplayList::drawRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color)
+	{
+		record(Op::DrawRect, x, y, w, h, color);
+	}
+
+	void DisplayList::fillRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color)
+	{
+		record(Op::FillRect, x, y, w, h, color);
+	}
+
+	void DisplayList::drawCircle(uint16_t x0, uint16_t y0, uint8_t r, uint16_t color)
+	{
+		record(Op::DrawCircle, x0, y0, r, color);
+	}
+
+	void DisplayList::fillCircle(uint16_t x0, uint16_t y0, uint8_t r, uint16_t color)
+	{
+		record(Op::FillCircle, x0, y0, r, color);
+	}
+
+	void DisplayList::drawTriangle(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color)
+	{
+		record(Op::DrawTriangle, x0, y0, x1, y1, x2, y2, color);
+	}
+
+	void DisplayList::fillTriangle(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color)
+	{
+		record(Op::FillTriangle, x0, y0, x1, y1, x2, y2, color);
+	}
+
+	void DisplayList::drawEllipse(uint16_t xCenter, uint16_t yCenter, uint16_t longAxis, uint16_t shortAxis, uint16_t color)
+	{
+		record(Op::DrawEllipse, xCenter, yCenter, longAxis, shortAxis, color);
+	}
+
+	void DisplayList::fillEllipse(uint16_t xCenter, uint16_t yCenter, uint16_t longAxis, uint16_t shortAxis, uint16_t color)
+	{
+		record(Op::FillEllipse, xCenter, yCenter, longAxis, shortAxis, color);
+	}
+
+	void DisplayList::textSetCursor(uint16_t x, uint16_t y)
+	{
+		record(Op::TextSetCursor, x, y);
+	}
+
+	void DisplayList::textColor(uint16_t foreColor, uint16_t bgColor)
+	{
+		record(Op::TextColor, foreColor, bgColor);
+	}
+
+	void DisplayList::textTransparent(uint16_t foreColor)
+	{
+		record(Op::TextTransparent, foreColor);
+	}
+
+	void DisplayList::textWrite(const char* buffer)
+	{
+		if (buffer == nullptr)
+			return;
+
+		// Offsets into m_text are split across two arguments to stay 16 bit.
+		size_t offset = m_text.size();
+		m_text.append(buffer);
+		m_text.push_back('\0');
+		record(Op::TextWrite, uint16_t(offset & 0xFFFF), uint16_t(offset >> 16));
+	}
+
+	///
+	/// Run the recorded calls against 'tft' with command capture on, leaving
+	/// the encoded bytes in stream().  The stream relies on the register
+	/// state the RA8875 object has now, so it should be sent right away.
+	///
+	bool DisplayList::encode(RA8875& tft)
+	{
+		m_stream.clear();
+		if (!tft.beginCapture())
+			return false;
+
+		replay(tft);
+		tft.endCapture(m_stream);
+		return true;
+	}
+
+	///
+	/// Encode the list and send it as one stream.  Without hardware wait
+	/// enabled the calls are made directly instead.
+	///
+	bool DisplayList::submit(RA8875& tft)
+	{
+		if (!encode(tft))
+		{
+			replay(tft);
+			return false;
+		}
+
+		tft.submitStream(m_stream.data(), m_stream.size());
+		return true;
+	}
+
+	void DisplayList::record(Op op, uint16_t a0, uint16_t a1, uint16_t a2, uint16_t a3, uint16_t a4, uint16_t a5, uint16_t a6)
+	{
+		Command cmd = { op, { a0, a1, a2, a3, a4, a5, a6 } };
+		m_commands.push_back(cmd);
+	}
+
+	void DisplayList::replay(RA8875& tft) const
+	{
+		for (const Command& cmd : m_commands)
+		{
+			const uint16_t* a = cmd.arg;
+			switch (cmd.op)
+			{
+			case Op::FillScreen:      tft.fillScreen(a[0]); break;
+			case Op::DrawPixel:       tft.drawPixel(int16_t(a[0]), int16_t(a[1]), a[2]); break;
+			case Op::DrawLine:        tft.drawLine(a[0], a[1], a[2], a[3], a[4]); break;
+			case Op::DrawRect:        tft.drawRect(a[0], a[1], a[2], a[3], a[4]); break;
+			case Op::FillRect:        tft.fillRect(a[0], a[1], a[2], a[3], a[4]); break;
+			case Op::DrawCircle:      tft.drawCircle(a[0], a[1], uint8_t(a[2]), a[3]); break;
+			case Op::FillCircle:      tft.fillCircle(a[0], a[1], uint8_t(a[2]), a[3]); break;
+			case Op::DrawTriangle:    tft.drawTriangle(a[0], a[1], a[2], a[3], a[4], a[5], a[6]); break;
+			case Op::FillTriangle:    tft.fillTriangle(a[0], a[1], a[2], a[3], a[4], a[5], a[6]); break;
+			case Op::DrawEllipse:     tft.drawEllipse(a[0], a[1], a[2], a[3], a[4]); break;
+			case Op::FillEllipse:     tft.fillEllipse(a[0], a[1], a[2], a[3], a[4]); break;
+			case Op::TextSetCursor:   tft.textSetCursor(a[0], a[1]); break;
+			case Op::TextColor:       tft.textColor(a[0], a[1]); break;
+			case Op::TextTransparent: tft.textTransparent(a[0]); break;
+			case Op::TextWrite:       tft.textWrite(m_text.c_str() + (size_t(a[1]) << 16 | a[0])); break;
+			}
+		}
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "RA8875.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace hw
+{
+	///
+	/// Records a sequence of RA8875 drawing calls and sends them as a single
+	/// pre-encoded MPSSE command stream, so a full screen of primitives costs
+	/// a handful of USB transfers instead of dozens per primitive.
+	///
+	/// Encoding needs the RA8875 WAIT pin wired to a pin the device can wait
+	/// on and RA8875::setHardwareWait(true), since the stream can't poll the
+	/// draw engine.
+	///
+	class DisplayList
+	{
+	public:
+		DisplayList();
+
+		void    clear();
+		size_t  size() const { return m_commands.size(); }
+
+		/* Recorded calls, same meaning as the RA8875 methods */
+		void    fillScreen(uint16_t color);
+		void    drawPixel(int16_t x, int16_t y, uint16_t color);
+		void    drawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t color);
+		void    drawRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color);
+		void    fillRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color);
+		void    drawCircle(uint16_t x0, uint16_t y0, uint8_t r, uint16_t color);
+		void    fillCircle(uint16_t x0, uint16_t y0, uint8_t r, uint16_t color);
+		void    drawTriangle(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color);
+		void    fillTriangle(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color);
+		void    drawEllipse(uint16_t xCenter, uint16_t yCenter, uint16_t longAxis, uint16_t shortAxis, uint16_t color);
+		void    fillEllipse(uint16_t xCenter, uint16_t yCenter, uint16_t longAxis, uint16_t shortAxis, uint16_t color);
+		void    textSetCursor(uint16_t x, uint16_t y);
+		void    textColor(uint16_t foreColor, uint16_t bgColor);
+		void    textTransparent(uint16_t foreColor);
+		void    textWrite(const char* buffer);
+
+		/* Encoding & submission */
+		bool    encode(RA8875& tft);
+		bool    submit(RA8875& tft);
+		const std::vector<uint8_t>& stream() const { return m_stream; }
+
+	private:
+		enum class Op : uint8_t
+		{
+			FillScreen,
+			DrawPixel,
+			DrawLine,
+			DrawRect,
+			FillRect,
+			DrawCircle,
+			FillCircle,
+			DrawTriangle,
+			FillTriangle,
+			DrawEllipse,
+			FillEllipse,
+			TextSetCursor,
+			TextColor,
+			TextTransparent,
+			TextWrite,
+		};
+
+		struct Command
+		{
+			Op       op;
+			uint16_t arg[7];
+		};
+
+		void    record(Op op, uint16_t a0 = 0, uint16_t a1 = 0, uint16_t a2 = 0, uint16_t a3 = 0,
+		               uint16_t a4 = 0, uint16_t a5 = 0, uint16_t a6 = 0);
+		void    replay(RA8875& tft) const;
+
+	private:
+		std::vector<Command> m_commands;
+		std::string          m_text;      // NUL separated strings for TextWrite
+		std::vector<uint8_t> m_stream;
+	};
+}
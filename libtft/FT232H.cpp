@@ -1,18 +1,39 @@
 	#include "FT232H.h"
+#include "Timeline.h"
 #include <stdio.h>
 #include <ftdi.h>
+#include <libusb.h>
 
+#include <algorithm>
 #include <chrono>
-#include <thread>
 #include <iso646.h>
 #include <math.h>
 
 namespace hw
 {
+	// Matches the read/write chunk size configured in open().
+	static const size_t kChunkSize = 65535;
+
+	// Latency timer and longest sleep between deadline checks per profile.
+	static const int kLowLatencyTimerMs = 1;
+	static const int kLowLatencyWakeMs  = 1;
+	static const int kLowCpuTimerMs     = 16;
+	static const int kLowCpuWakeMs      = 100;
+
 	FT232H::FT232H()
 		: m_ftdi(nullptr)
 		, m_gpio_direction(0)
 		, m_gpio_values(0)
+		, m_buffered(false)
+		, m_lastFlush()
+		, m_transfers()
+		, m_ringNext(0)
+		, m_capturing(false)
+		, m_profile(LatencyProfile::LowestLatency)
+		, m_pendingRead(nullptr)
+		, m_readDeadline()
+		, m_readFinished(false)
+		, m_finishedResult(0)
 	{
 	}
 
@@ -20,8 +41,23 @@ namespace hw
 		: m_ftdi(lhs.m_ftdi)
 		, m_gpio_direction(lhs.m_gpio_direction)
 		, m_gpio_values(lhs.m_gpio_values)
+		, m_buffered(lhs.m_buffered)
+		, m_buffer(std::move(lhs.m_buffer))
+		, m_lastFlush(lhs.m_lastFlush)
+		, m_transfers(lhs.m_transfers)
+		, m_ring(std::move(lhs.m_ring))
+		, m_ringNext(lhs.m_ringNext)
+		, m_capturing(lhs.m_capturing)
+		, m_capture(std::move(lhs.m_capture))
+		, m_profile(lhs.m_profile)
+		, m_pendingRead(lhs.m_pendingRead)
+		, m_readDeadline(lhs.m_readDeadline)
+		, m_readFinished(lhs.m_readFinished)
+		, m_finishedResult(lhs.m_finishedResult)
 	{
 		lhs.m_ftdi = nullptr;
+		lhs.m_pendingRead = nullptr;
+		lhs.m_readFinished = false;
 	}
 
 
@@ -36,6 +72,19 @@ namespace hw
 		std::swap(m_ftdi, lhs.m_ftdi);
 		m_gpio_direction = lhs.m_gpio_direction;
 		m_gpio_values = lhs.m_gpio_values;
+		m_buffered = lhs.m_buffered;
+		m_buffer = std::move(lhs.m_buffer);
+		m_lastFlush = lhs.m_lastFlush;
+		m_transfers = lhs.m_transfers;
+		m_ring = std::move(lhs.m_ring);
+		m_ringNext = lhs.m_ringNext;
+		m_capturing = lhs.m_capturing;
+		m_capture = std::move(lhs.m_capture);
+		m_profile = lhs.m_profile;
+		std::swap(m_pendingRead, lhs.m_pendingRead);
+		m_readDeadline = lhs.m_readDeadline;
+		std::swap(m_readFinished, lhs.m_readFinished);
+		m_finishedResult = lhs.m_finishedResult;
 		return *this;
 	}
 
@@ -72,6 +121,10 @@ namespace hw
 		// Clear pending read data & write buffers.
 		ftdi_usb_purge_buffers(m_ftdi);
 
+		// The chip's 16ms default latency timer would delay every reply that
+		// isn't flushed with SEND_IMMEDIATE.
+		setLatencyProfile(m_profile);
+
 		// Enable MPSSE and syncronize communication with device.
 		mpsse_enable();
 		mpsse_sync();
@@ -88,6 +141,14 @@ namespace hw
 	{
 		if (m_ftdi != nullptr)
 		{
+			if (m_pendingRead != nullptr)
+			{
+				cancelRead(m_pendingRead);
+				m_pendingRead = nullptr;
+			}
+			m_readFinished = false;
+			flush();
+			drainAsync();
 			ftdi_usb_close(m_ftdi);
 			ftdi_free(m_ftdi);
 			m_ftdi = nullptr;
@@ -123,6 +184,48 @@ namespace hw
 		return m_gpio_values;
 	}
 
+	///
+	/// Encode a single GPIO bank update.  Only the bank that holds the pin is
+	/// written, so the command is 3 bytes instead of the 6 used by
+	/// mpsse_write_gpio().
+	///
+	size_t FT232H::encodePinValue(Pin pin, bool value, uint8_t* out)
+	{
+		outputPin(pin, value);
+		if (static_cast<int>(pin) < 8)
+		{
+			out[0] = SET_BITS_LOW;
+			out[1] = uint8_t(m_gpio_values & 0xff);
+			out[2] = uint8_t(m_gpio_direction & 0xff);
+		}
+		else
+		{
+			out[0] = SET_BITS_HIGH;
+			out[1] = uint8_t(m_gpio_values >> 8);
+			out[2] = uint8_t(m_gpio_direction >> 8);
+		}
+		return 3;
+	}
+
+	///
+	/// The MPSSE wait-on-I/O commands only watch GPIOL1, which is D5.  The
+	/// chip stops processing commands until the level matches, so no USB
+	/// round trip is needed to wait for the target.
+	///
+	bool FT232H::waitForPin(Pin pin, bool value)
+	{
+		if (!canWaitForPin(pin))
+			return false;
+
+		writeByte(value ? WAIT_ON_HIGH : WAIT_ON_LOW);
+		return true;
+	}
+
+	bool FT232H::canWaitForPin(Pin pin) const
+	{
+		return pin == Pin::D5;
+	}
+
 	/// 
 	/// Set the clock speed of the MPSSE engine.  Can be any value from 450hz
 	/// to 30mhz and will pick that speed or the closest speed below it.
@@ -147,11 +250,7 @@ namespace hw
 		else
 			writeByte(DIS_3_PHASE);
 
-		// Compute divisor for requested clock.
-		// Use equation from section 3.8.1 of:
-		//  http://www.ftdichip.com/Support/Documents/AppNotes/AN_108_Command_Processor_for_MPSSE_and_MCU_Host_Bus_Emulation_Modes.pdf
-		// Note equation is using 60mhz master clock instead of 12mhz.
-		int divisor = int(ceil((30000000.0 - float(clock_hz)) / float(clock_hz))) & 0xFFFF;
+		int divisor = clockDivisor(clock_hz);
 		if (three_phase)
 			divisor = int(divisor*(2.0 / 3.0));
 
@@ -160,35 +259,358 @@ namespace hw
 		writeUInt16(uint16_t(divisor));
 	}
 
+	size_t FT232H::encodeClock(int clock_hz, uint8_t* out)
+	{
+		int divisor = clockDivisor(clock_hz);
+		out[0] = TCK_DIVISOR;
+		out[1] = uint8_t(divisor & 0xff);
+		out[2] = uint8_t(divisor >> 8);
+		return 3;
+	}
+
 	int FT232H::write(const uint8_t* data, size_t length)
 	{
-		return ftdi_write_data(m_ftdi, data, static_cast<int>(length));
+		if (m_capturing)
+		{
+			m_capture.insert(m_capture.end(), data, data + length);
+			return static_cast<int>(length);
+		}
+
+		if (!m_buffered)
+		{
+			TFT_TIMELINE_SCOPE("usb", "write", "bytes", int64_t(length));
+			m_transfers.writes += (length + kChunkSize - 1) / kChunkSize;
+			m_transfers.bytesWritten += length;
+			return ftdi_write_data(m_ftdi, data, static_cast<int>(length));
+		}
+
+		// Fill the buffer a chunk at a time, so every flush is exactly one
+		// transfer and large writes stream through the async ring.
+		size_t done = 0;
+		while (done < length)
+		{
+			if (m_buffer.size() == kChunkSize)
+				flush();
+
+			size_t n = std::min(length - done, kChunkSize - m_buffer.size());
+			m_buffer.insert(m_buffer.end(), data + done, data + done + n);
+			done += n;
+		}
+		return static_cast<int>(length);
 	}
 
 	int FT232H::read(uint8_t* data, int expected, int timeOutInMs)
 	{
-		int index = 0;
-		auto start = std::chrono::high_resolution_clock::now();
-		while ((std::chrono::high_resolution_clock::now() - start) < std::chrono::milliseconds(timeOutInMs))
+		if (m_capturing)
 		{
-			int ret = ftdi_read_data(m_ftdi, data + index, expected - index);
-			if (ret < 0)
+			fprintf(stderr, "FT232H: read while capturing commands\n");
+			return -1;
+		}
+
+		TFT_TIMELINE_SCOPE("usb", "read", "bytes", expected);
+
+		// The split read in flight gets the first bytes back.  Finish it into
+		// its owner's buffer, so this read gets its own reply and the owner
+		// still finds the result with pollRead().
+		if (m_pendingRead != nullptr)
+		{
+			using namespace std::chrono;
+			ftdi_transfer_control* tc = m_pendingRead;
+			m_pendingRead = nullptr;
+			long long left = duration_cast<milliseconds>(m_readDeadline - steady_clock::now()).count();
+			m_finishedResult = awaitTransfer(tc, int(std::max(left, 0LL))) ? finishRead(tc) : cancelRead(tc);
+			m_readFinished = true;
+		}
+
+		// The response can't arrive before the commands asking for it are sent.
+		flush();
+		drainAsync();
+
+		m_transfers.reads++;
+		ftdi_transfer_control* tc = ftdi_read_data_submit(m_ftdi, data, expected);
+		if (tc == nullptr)
+		{
+			fprintf(stderr, "Unable to read ftdi device: %s\n", ftdi_get_error_string(m_ftdi));
+			return -1;
+		}
+
+		if (!awaitTransfer(tc, timeOutInMs))
+			return cancelRead(tc);
+		return finishRead(tc);
+	}
+
+	bool FT232H::beginRead(uint8_t* data, int expected, int timeOutInMs)
+	{
+		if (m_capturing)
+		{
+			fprintf(stderr, "FT232H: read while capturing commands\n");
+			return false;
+		}
+		if (m_pendingRead != nullptr || m_readFinished)
+		{
+			fprintf(stderr, "FT232H: a split read is already in flight\n");
+			return false;
+		}
+
+		TFT_TIMELINE_SCOPE("usb", "beginRead", "bytes", expected);
+		flush();
+		drainAsync();
+
+		m_transfers.reads++;
+		m_pendingRead = ftdi_read_data_submit(m_ftdi, data, expected);
+		if (m_pendingRead == nullptr)
+		{
+			fprintf(stderr, "Unable to read ftdi device: %s\n", ftdi_get_error_string(m_ftdi));
+			return false;
+		}
+		m_readDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeOutInMs);
+		return true;
+	}
+
+	///
+	/// Run whatever libusb has ready without waiting, then see whether our
+	/// transfer is among what completed.
+	///
+	bool FT232H::pollRead(int& result)
+	{
+		if (m_readFinished)
+		{
+			m_readFinished = false;
+			result = m_finishedResult;
+			return true;
+		}
+
+		ftdi_transfer_control* tc = m_pendingRead;
+		if (tc == nullptr)
+		{
+			result = -1;
+			return true;
+		}
+
+		if (!tc->completed)
+		{
+			timeval tv = { 0, 0 };
+			int ret = libusb_handle_events_timeout_completed(m_ftdi->usb_ctx, &tv, &tc->completed);
+			if (ret < 0 && ret != LIBUSB_ERROR_INTERRUPTED)
+				fprintf(stderr, "libusb event handling failed: %d\n", ret);
+		}
+
+		if (!tc->completed)
+		{
+			if (std::chrono::steady_clock::now() < m_readDeadline)
+				return false;
+			m_pendingRead = nullptr;
+			result = cancelRead(tc);
+			return true;
+		}
+
+		m_pendingRead = nullptr;
+		result = finishRead(tc);
+		return true;
+	}
+
+	///
+	/// Stop a read that timed out but keep whatever did arrive.
+	///
+	int FT232H::cancelRead(ftdi_transfer_control* tc)
+	{
+		libusb_cancel_transfer(tc->transfer);
+		while (!tc->completed)
+		{
+			if (libusb_handle_events_completed(m_ftdi->usb_ctx, &tc->completed) < 0)
+				break;
+		}
+		int index = tc->offset;
+		ftdi_transfer_data_cancel(tc, nullptr);
+		m_transfers.bytesRead += index;
+		return index;
+	}
+
+	int FT232H::finishRead(ftdi_transfer_control* tc)
+	{
+		int ret = ftdi_transfer_data_done(tc);
+		if (ret < 0)
+		{
+			fprintf(stderr, "Unable to read ftdi device: %d (%s)\n", ret, ftdi_get_error_string(m_ftdi));
+			return -1;
+		}
+		m_transfers.bytesRead += ret;
+		return ret;
+	}
+
+	bool FT232H::setLatencyTimer(int ms)
+	{
+		if (m_ftdi == nullptr)
+			return false;
+
+		int ret = ftdi_set_latency_timer(m_ftdi, static_cast<unsigned char>(std::min(std::max(ms, 1), 255)));
+		if (ret < 0)
+		{
+			fprintf(stderr, "Unable to set latency timer on ftdi device: %d (%s)\n", ret, ftdi_get_error_string(m_ftdi));
+			return false;
+		}
+		return true;
+	}
+
+	void FT232H::setLatencyProfile(LatencyProfile profile)
+	{
+		m_profile = profile;
+		if (m_ftdi != nullptr)
+			setLatencyTimer(profile == LatencyProfile::LowestLatency ? kLowLatencyTimerMs : kLowCpuTimerMs);
+	}
+
+	///
+	/// Sleep in libusb's event handling until 'tc' completes, waking up at
+	/// least every few milliseconds (depending on the latency profile) to
+	/// check the deadline.  A negative timeout waits for as long as the
+	/// transfer's own USB timeout allows.  Returns false on timeout.
+	///
+	bool FT232H::awaitTransfer(ftdi_transfer_control* tc, int timeOutInMs)
+	{
+		using namespace std::chrono;
+
+		int wakeMs = m_profile == LatencyProfile::LowestLatency ? kLowLatencyWakeMs : kLowCpuWakeMs;
+		auto deadline = steady_clock::now() + milliseconds(timeOutInMs);
+
+		while (!tc->completed)
+		{
+			int sliceMs = wakeMs;
+			if (timeOutInMs >= 0)
 			{
-				fprintf(stderr, "Unable to read ftdi device: %d (%s)\n", ret, ftdi_get_error_string(m_ftdi));
-				return -1;
+				auto left = duration_cast<milliseconds>(deadline - steady_clock::now()).count();
+				if (left <= 0)
+					return false;
+				sliceMs = static_cast<int>(std::min<long long>(left, wakeMs));
 			}
 
-			index += ret;
-
-			if (index >= expected)
+			timeval tv = { sliceMs / 1000, (sliceMs % 1000) * 1000 };
+			int ret = libusb_handle_events_timeout_completed(m_ftdi->usb_ctx, &tv, &tc->completed);
+			if (ret < 0 && ret != LIBUSB_ERROR_INTERRUPTED)
 			{
-				return expected;
+				fprintf(stderr, "libusb event handling failed: %d\n", ret);
+				return false;
 			}
+		}
+		return true;
+	}
+
+
+	int FT232H::flush()
+	{
+		if (m_buffer.empty())
+			return 0;
+
+		TFT_TIMELINE_SCOPE("usb", "flush", "bytes", int64_t(m_buffer.size()));
+		m_lastFlush.bytes = m_buffer.size();
+		m_lastFlush.transfers = (m_buffer.size() + kChunkSize - 1) / kChunkSize;
+		m_transfers.writes += m_lastFlush.transfers;
+		m_transfers.bytesWritten += m_lastFlush.bytes;
+
+		if (!m_ring.empty())
+			return submitAsync();
+
+		int ret = ftdi_write_data(m_ftdi, m_buffer.data(), static_cast<int>(m_buffer.size()));
+		m_buffer.clear();
+		if (ret < 0)
+			fprintf(stderr, "Unable to write ftdi device: %d (%s)\n", ret, ftdi_get_error_string(m_ftdi));
+		return ret;
+	}
+
+	void FT232H::setBuffered(bool buffered)
+	{
+		if (!buffered)
+			flush();
+		else
+			m_buffer.reserve(kChunkSize);
+		m_buffered = buffered;
+	}
+
+	void FT232H::beginCapture()
+	{
+		// Whatever was queued before belongs to the live stream.
+		flush();
+		m_capture.clear();
+		m_capturing = true;
+	}
+
+	void FT232H::endCapture(std::vector<uint8_t>& stream)
+	{
+		m_capturing = false;
+		stream.swap(m_capture);
+		m_capture.clear();
+	}
+
+	void FT232H::setAsyncTransfers(int count)
+	{
+		flush();
+		drainAsync();
 
-			std::this_thread::yield();
+		m_ring.clear();
+		m_ringNext = 0;
+		if (count < 2)
+			return;
+
+		m_ring.resize(count);
+		for (auto& slot : m_ring)
+		{
+			slot.data.reserve(kChunkSize);
+			slot.transfer = nullptr;
 		}
+	}
 
-		return index;
+	///
+	/// Hand the command buffer to the next ring slot and submit it without
+	/// waiting.  Only blocks when that slot's previous transfer is still in
+	/// flight, i.e. when all transfers in the ring are busy.
+	///
+	int FT232H::submitAsync()
+	{
+		AsyncSlot& slot = m_ring[m_ringNext];
+		m_ringNext = (m_ringNext + 1) % m_ring.size();
+
+		waitSlot(slot);
+
+		// Swap rather than copy; both vectors keep their chunk-sized capacity.
+		slot.data.swap(m_buffer);
+		m_buffer.clear();
+
+		int size = static_cast<int>(slot.data.size());
+		slot.transfer = ftdi_write_data_submit(m_ftdi, slot.data.data(), size);
+		if (slot.transfer == nullptr)
+		{
+			fprintf(stderr, "Unable to submit ftdi write: %s\n", ftdi_get_error_string(m_ftdi));
+			return -1;
+		}
+		return size;
+	}
+
+	int FT232H::waitSlot(AsyncSlot& slot)
+	{
+		if (slot.transfer == nullptr)
+			return 0;
+
+		// Block instead of letting ftdi_transfer_data_done() poll; the write
+		// ends by itself at the latest after the USB write timeout.
+		awaitTransfer(slot.transfer, -1);
+		int ret = ftdi_transfer_data_done(slot.transfer);
+		slot.transfer = nullptr;
+		if (ret < 0)
+			fprintf(stderr, "Async ftdi write failed: %d\n", ret);
+		return ret;
+	}
+
+	///
+	/// Wait for every in-flight transfer, oldest first.
+	///
+	int FT232H::drainAsync()
+	{
+		int ret = 0;
+		for (size_t i = 0; i < m_ring.size(); ++i)
+		{
+			if (waitSlot(m_ring[(m_ringNext + i) % m_ring.size()]) < 0)
+				ret = -1;
+		}
+		return ret;
 	}
 
 
@@ -280,4 +702,13 @@ namespace hw
 	{
 		return uint16_t(1 << static_cast<int>(pin));
 	}
+
+	int FT232H::clockDivisor(int clock_hz)
+	{
+		// Compute divisor for requested clock.
+		// Use equation from section 3.8.1 of:
+		//  http://www.ftdichip.com/Support/Documents/AppNotes/AN_108_Command_Processor_for_MPSSE_and_MCU_Host_Bus_Emulation_Modes.pdf
+		// Note equation is using 60mhz master clock instead of 12mhz.
+		return int(ceil((30000000.0 - float(clock_hz)) / float(clock_hz))) & 0xFFFF;
+	}
 }
\ No newline at end of file
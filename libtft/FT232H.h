@@ -2,15 +2,25 @@
 
 #include "IDevice.h"
 #include <stdint.h>
+#include <chrono>
 #include <initializer_list>
+#include <vector>
 
 struct ftdi_context;
+struct ftdi_transfer_control;
 
 namespace hw
 {
 	class FT232H : public IDevice
 	{
 	public:
+		// What a single flush() handed to libftdi.
+		struct FlushStats
+		{
+			size_t bytes;
+			size_t transfers;
+		};
+
 		FT232H();
 		FT232H(FT232H&& lhs);
 		~FT232H();
@@ -29,11 +39,57 @@ namespace hw
 		void      setPinValue(Pin pin, bool value) override;
 		bool      getPinValue(Pin pin) override;
 		uint16_t  readPins() override;
+		size_t    encodePinValue(Pin pin, bool value, uint8_t* out) override;
+		bool      waitForPin(Pin pin, bool value) override;
+		bool      canWaitForPin(Pin pin) const override;
 
 		// MPSSE access.
 		void      setClock(int clock_hz, bool adaptive = false, bool three_phase = false) override;
+		size_t    encodeClock(int clock_hz, uint8_t* out) override;
 		int       write(const uint8_t* data, size_t length) override;
 		int       read(uint8_t* data, int expected, int timeOutInMs = 500) override;
+		bool      beginRead(uint8_t* data, int expected, int timeOutInMs = 500) override;
+		bool      pollRead(int& result) override;
+		bool      setLatencyTimer(int ms) override;
+		void      setLatencyProfile(LatencyProfile profile) override;
+		int       flush() override;
+		void      beginCapture() override;
+		void      endCapture(std::vector<uint8_t>& stream) override;
+		size_t    captured() const override { return m_capture.size(); }
+		TransferStats transferStats() const override { return m_transfers; }
+		void      resetTransferStats() override { m_transfers = TransferStats(); }
+
+		// Buffered mode: write(), setPinValue() and setPinDirection() only
+		// append to a command buffer, which goes out on flush(), before a
+		// read(), or when it would exceed one write chunk.
+		void      setBuffered(bool buffered);
+		bool      isBuffered() const { return m_buffered; }
+		const FlushStats& lastFlush() const { return m_lastFlush; }
+
+		// Asynchronous flushes (buffered mode only).  With 2 or more transfers
+		// the buffer is handed to libusb and flush() returns immediately, so
+		// the next chunk can be built while the previous ones are on the wire.
+		// 0 restores synchronous flushes.
+		void      setAsyncTransfers(int count);
+		int       asyncTransfers() const { return static_cast<int>(m_ring.size()); }
+
+		// TCK_DIVISOR value for the fastest clock not above clock_hz.
+		static int clockDivisor(int clock_hz);
+
+	private:
+		// A preallocated chunk buffer and the transfer currently using it.
+		struct AsyncSlot
+		{
+			std::vector<uint8_t>   data;
+			ftdi_transfer_control* transfer;
+		};
+
+		bool      awaitTransfer(ftdi_transfer_control* tc, int timeOutInMs);
+		int       cancelRead(ftdi_transfer_control* tc);
+		int       finishRead(ftdi_transfer_control* tc);
+		int       submitAsync();
+		int       waitSlot(AsyncSlot& slot);
+		int       drainAsync();
 
 	private:
 		void      mpsse_enable();
@@ -48,5 +104,22 @@ namespace hw
 		ftdi_context* m_ftdi;
 		uint16_t      m_gpio_direction;
 		uint16_t      m_gpio_values;
+		bool          m_buffered;
+		std::vector<uint8_t> m_buffer;
+		FlushStats    m_lastFlush;
+		TransferStats m_transfers;
+		std::vector<AsyncSlot> m_ring;
+		size_t        m_ringNext;
+		bool          m_capturing;
+		std::vector<uint8_t> m_capture;
+		LatencyProfile m_profile;
+
+		// The read started by beginRead(), if any, and when it gives up.
+		ftdi_transfer_control* m_pendingRead;
+		std::chrono::steady_clock::time_point m_readDeadline;
+		// A split read read() had to finish first, until pollRead() hands
+		// over its result.
+		bool          m_readFinished;
+		int           m_finishedResult;
 	};
 }
\ No newline at end of file
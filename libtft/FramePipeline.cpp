@@ -0,0 +1,350 @@
+#include "FramePipeline.h"
+#include "RA8875.h"
+#include "RA8875Registers.h"
+#include "Timeline.h"
+#include <algorithm>
+#include <chrono>
+#include <string.h>
+
+// Command/Data prefixes for SPI
+#define RA8875_DATAWRITE        0x00
+#define RA8875_CMDWRITE         0x80
+
+namespace hw
+{
+	namespace
+	{
+		// Spin briefly for a busy pipeline, then sleep so an idle one
+		// costs no CPU.
+		void backoff(unsigned& spins)
+		{
+			if (spins < 64)
+			{
+				++spins;
+				std::this_thread::yield();
+			}
+			else
+			{
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+			}
+		}
+	}
+
+	/*
+	 * Everything that needs the RA8875 itself is done here, on the calling
+	 * thread: graphics mode, the framing bytes and the active window that
+	 * each frame restores.
+	 */
+	FramePipeline::FramePipeline(RA8875& tft, int workers, size_t depth)
+		: m_tft(tft)
+		, m_width(tft.width())
+		, m_height(tft.height())
+		, m_bpp(tft.colorDepth())
+		, m_dither(tft.m_dither)
+		, m_pool(workers)
+		, m_free(depth)
+		, m_toDiff(depth)
+		, m_toConvert(depth)
+		, m_toEncode(depth)
+		, m_toTransmit(depth)
+		, m_stop(false)
+		, m_framesPushed(0)
+		, m_framesSent(0)
+		, m_regionsSent(0)
+		, m_bytesSent(0)
+	{
+		m_tft.sync();
+		m_tft.graphicsMode();
+		m_framing = m_tft.m_spi.writeFraming();
+		m_window[0] = m_tft.m_activeWindowXL;
+		m_window[1] = m_tft.m_activeWindowXR;
+		m_window[2] = m_tft.m_activeWindowYT;
+		m_window[3] = m_tft.m_activeWindowYB;
+
+		// What a region costs besides its pixels: the window, the cursor,
+		// MRWC and the header of its first data frame.
+		std::vector<uint8_t> probe;
+		for (int i = 0; i < 6; ++i)
+			putRegister16(probe, 0, 0);
+		const uint8_t mrwc[] = { RA8875_CMDWRITE, TFT_Register::MRWC };
+		putFrame(probe, mrwc, 2);
+		m_regionCost = probe.size() + m_framing.beginSize + 3 + m_framing.endSize;
+
+		m_tiles.reset(m_width, m_height);
+		m_diffusion.resize(size_t(m_pool.size()));
+
+		const size_t frameBytes = size_t(m_width) * m_height * (m_bpp / 8);
+		for (size_t i = 0; i < depth; ++i)
+		{
+			std::unique_ptr<Slot> slot(new Slot);
+			slot->pixels.resize(size_t(m_width) * m_height);
+			slot->converted.reserve(frameBytes);
+			slot->stream.reserve(frameBytes + frameBytes / 8);
+			m_free.tryPush(slot.get());
+			m_slots.push_back(std::move(slot));
+		}
+
+		m_threads.emplace_back(&FramePipeline::diffStage, this);
+		m_threads.emplace_back(&FramePipeline::convertStage, this);
+		m_threads.emplace_back(&FramePipeline::encodeStage, this);
+		m_threads.emplace_back(&FramePipeline::transmitStage, this);
+	}
+
+	/*
+	 * Frames already pushed are still sent.  The chip's registers and clock
+	 * were changed behind the RA8875's back, so its caches are dropped.
+	 */
+	FramePipeline::~FramePipeline()
+	{
+		drain();
+		m_stop = true;
+		for (std::thread& t : m_threads)
+			t.join();
+
+		m_tft.m_spi.invalidateClock();
+		m_tft.invalidateShadow();
+		m_tft.invalidateFrame();
+	}
+
+	void FramePipeline::push(const uint16_t* pixels, size_t stride)
+	{
+		TFT_TIMELINE_SCOPE("pipeline", "push");
+		if (stride == 0)
+			stride = size_t(m_width);
+
+		Slot* slot = take(m_free);
+		for (int y = 0; y < m_height; ++y)
+			memcpy(&slot->pixels[size_t(y) * m_width], pixels + size_t(y) * stride, size_t(m_width) * 2);
+
+		++m_framesPushed;
+		pass(m_toDiff, slot);
+	}
+
+	void FramePipeline::drain()
+	{
+		unsigned spins = 0;
+		while (m_framesSent.load() != m_framesPushed)
+			backoff(spins);
+	}
+
+	FramePipeline::Slot* FramePipeline::take(Queue& queue)
+	{
+		Slot* slot = nullptr;
+		unsigned spins = 0;
+		while (!queue.tryPop(slot))
+		{
+			if (m_stop.load())
+				return nullptr;
+			backoff(spins);
+		}
+		return slot;
+	}
+
+	// Every queue holds all the slots, so this only waits if it is full of
+	// slots the next stage has not taken yet, which cannot happen.
+	void FramePipeline::pass(Queue& queue, Slot* slot)
+	{
+		unsigned spins = 0;
+		while (!queue.tryPush(slot))
+			backoff(spins);
+	}
+
+	void FramePipeline::diffStage()
+	{
+		while (Slot* slot = take(m_toDiff))
+		{
+			diff(*slot);
+			pass(m_toConvert, slot);
+		}
+	}
+
+	/*
+	 * One job per band of tile rows converted; Floyd-Steinberg carries
+	 * errors down a region, so there a job is a whole region.
+	 */
+	void FramePipeline::convertStage()
+	{
+		const size_t outSize = m_bpp / 8;
+		const bool wholeRegions = m_dither == DitherFloydSteinberg && m_bpp == 8;
+		while (Slot* slot = take(m_toConvert))
+		{
+			TFT_TIMELINE_SCOPE("pipeline", "convert", "regions", int64_t(slot->regions.size()));
+			slot->offsets.clear();
+			slot->jobs.clear();
+
+			size_t bytes = 0;
+			for (size_t i = 0; i < slot->regions.size(); ++i)
+			{
+				const Framebuffer::Rect& r = slot->regions[i];
+				const int h = r.y1 - r.y0 + 1;
+				slot->offsets.push_back(bytes);
+				bytes += size_t(r.x1 - r.x0 + 1) * h * outSize;
+
+				const int band = wholeRegions ? h : TileDiff::kTileHeight;
+				for (int first = 0; first < h; first += band)
+				{
+					Job job = { uint32_t(i), uint16_t(first), uint16_t(std::min(band, h - first)) };
+					slot->jobs.push_back(job);
+				}
+			}
+			slot->converted.resize(bytes);
+
+			m_pool.run(slot->jobs.size(), [&](size_t job, int worker) {
+				convert(*slot, slot->jobs[job], worker);
+			});
+			pass(m_toEncode, slot);
+		}
+	}
+
+	void FramePipeline::encodeStage()
+	{
+		while (Slot* slot = take(m_toEncode))
+		{
+			encode(*slot);
+			pass(m_toTransmit, slot);
+		}
+	}
+
+	void FramePipeline::transmitStage()
+	{
+		while (Slot* slot = take(m_toTransmit))
+		{
+			if (!slot->stream.empty())
+				m_tft.submitStream(slot->stream.data(), slot->stream.size());
+
+			m_regionsSent += slot->regions.size();
+			m_bytesSent += slot->stream.size();
+			pass(m_free, slot);
+			++m_framesSent;
+		}
+	}
+
+	/*
+	 * Hash the frame one tile row per job and join the changed tiles into
+	 * regions, merged as long as that saves bytes on the wire.
+	 */
+	void FramePipeline::diff(Slot& slot)
+	{
+		TFT_TIMELINE_SCOPE("pipeline", "diff");
+		const uint16_t* pixels = slot.pixels.data();
+		const size_t strideBytes = size_t(m_width) * 2;
+		m_pool.run(size_t(m_tiles.tileRows()), [&](size_t row, int) {
+			m_tiles.hashRows(pixels, strideBytes, int(row), int(row) + 1);
+		});
+		m_tiles.collect(slot.regions);
+		Framebuffer::coalesce(slot.regions, m_bpp / 8, m_regionCost);
+	}
+
+	void FramePipeline::convert(Slot& slot, const Job& job, int worker)
+	{
+		const Framebuffer::Rect& r = slot.regions[job.region];
+		const size_t w = size_t(r.x1 - r.x0 + 1);
+		const size_t outSize = m_bpp / 8;
+		// RGB565 sources lose nothing at 16bpp.
+		const TFT_Dither dither = m_bpp == 16 ? DitherNone : m_dither;
+
+		uint8_t* out = slot.converted.data() + slot.offsets[job.region] + size_t(job.first) * w * outSize;
+		if (dither == DitherFloydSteinberg)
+			m_diffusion[worker].start(uint16_t(w), m_bpp);
+
+		for (int row = job.first; row < job.first + job.rows; ++row, out += w * outSize)
+		{
+			const int y = r.y0 + row;
+			const uint8_t* src = reinterpret_cast<const uint8_t*>(&slot.pixels[size_t(y) * m_width + r.x0]);
+			switch (dither)
+			{
+			case DitherOrdered:
+				if (m_bpp == 8)
+					ditherToRGB332(PixelRGB565LE, src, w, r.x0, y, out);
+				else
+					ditherToRGB565BE(PixelRGB565LE, src, w, r.x0, y, out);
+				break;
+			case DitherFloydSteinberg:
+				m_diffusion[worker].convert(PixelRGB565LE, src, w, out);
+				break;
+			default:
+				if (m_bpp == 8)
+					convertToRGB332(PixelRGB565LE, src, w, out);
+				else
+					convertToRGB565BE(PixelRGB565LE, src, w, out);
+				break;
+			}
+		}
+	}
+
+	/*
+	 * The command stream of a frame: per region the memory write window,
+	 * the cursor, MRWC and the pixels in frames of up to SPI::kMaxFrame
+	 * bytes, then the caller's active window back.  The same bytes
+	 * RA8875::presentFrame() sends, without the register shadow.
+	 */
+	void FramePipeline::encode(Slot& slot) const
+	{
+		TFT_TIMELINE_SCOPE("pipeline", "encode");
+		std::vector<uint8_t>& out = slot.stream;
+		out.clear();
+		if (slot.regions.empty())
+			return;
+
+		out.insert(out.end(), m_framing.clock, m_framing.clock + m_framing.clockSize);
+
+		const size_t outSize = m_bpp / 8;
+		const size_t frameBytes = (SPI::kMaxFrame - 1) / outSize * outSize;
+		for (size_t i = 0; i < slot.regions.size(); ++i)
+		{
+			const Framebuffer::Rect& r = slot.regions[i];
+			putRegister16(out, TFT_Register::HSAW0, uint16_t(r.x0));
+			putRegister16(out, TFT_Register::HEAW0, uint16_t(r.x1));
+			putRegister16(out, TFT_Register::VSAW0, uint16_t(r.y0));
+			putRegister16(out, TFT_Register::VEAW0, uint16_t(r.y1));
+			putRegister16(out, TFT_Register::CURH0, uint16_t(r.x0));
+			putRegister16(out, TFT_Register::CURV0, uint16_t(r.y0));
+			const uint8_t mrwc[] = { RA8875_CMDWRITE, TFT_Register::MRWC };
+			putFrame(out, mrwc, 2);
+
+			const uint8_t* data = slot.converted.data() + slot.offsets[i];
+			size_t left = size_t(r.x1 - r.x0 + 1) * (r.y1 - r.y0 + 1) * outSize;
+			while (left > 0)
+			{
+				const size_t n = std::min(left, frameBytes);
+				const size_t length = n + 1;
+				out.insert(out.end(), m_framing.begin, m_framing.begin + m_framing.beginSize);
+				out.push_back(uint8_t((length - 1) & 0xff));
+				out.push_back(uint8_t((length - 1) >> 8));
+				out.push_back(RA8875_DATAWRITE);
+				out.insert(out.end(), data, data + n);
+				out.insert(out.end(), m_framing.end, m_framing.end + m_framing.endSize);
+				data += n;
+				left -= n;
+			}
+		}
+
+		putRegister16(out, TFT_Register::HSAW0, uint16_t(m_window[0]));
+		putRegister16(out, TFT_Register::HEAW0, uint16_t(m_window[1]));
+		putRegister16(out, TFT_Register::VSAW0, uint16_t(m_window[2]));
+		putRegister16(out, TFT_Register::VEAW0, uint16_t(m_window[3]));
+	}
+
+	void FramePipeline::putFrame(std::vector<uint8_t>& out, const uint8_t* payload, size_t length) const
+	{
+		out.insert(out.end(), m_framing.begin, m_framing.begin + m_framing.beginSize);
+		out.push_back(uint8_t((length - 1) & 0xff));
+		out.push_back(uint8_t((length - 1) >> 8));
+		out.insert(out.end(), payload, payload + length);
+		out.insert(out.end(), m_framing.end, m_framing.end + m_framing.endSize);
+	}
+
+	void FramePipeline::putRegister(std::vector<uint8_t>& out, uint8_t reg, uint8_t value) const
+	{
+		const uint8_t command[] = { RA8875_CMDWRITE, reg };
+		const uint8_t data[] = { RA8875_DATAWRITE, value };
+		putFrame(out, command, 2);
+		putFrame(out, data, 2);
+	}
+
+	void FramePipeline::putRegister16(std::vector<uint8_t>& out, uint8_t reg, uint16_t value) const
+	{
+		putRegister(out, reg, uint8_t(value & 0xFF));
+		putRegister(out, uint8_t(reg + 1), uint8_t(value >> 8));
+	}
+}
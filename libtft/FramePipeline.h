@@ -0,0 +1,126 @@
+#pragma once
+
+#include "Framebuffer.h"
+#include "PixelFormat.h"
+#include "SPI.h"
+#include "SpscQueue.h"
+#include "TileDiff.h"
+#include "WorkerPool.h"
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+namespace hw
+{
+	class RA8875;
+
+	///
+	/// RA8875::presentFrame() split into stages on threads of their own,
+	/// so frame N+1 is diffed, converted and encoded while frame N is on
+	/// the wire:
+	///
+	///   push() -> diff -> convert -> encode -> transmit
+	///
+	/// Frames move between stages through lock-free single producer queues
+	/// as preallocated slots, each holding the pixels, the changed regions
+	/// and the converted and encoded bytes of one frame.  Diff and convert
+	/// hand bands of tile rows to a worker pool.  The encode stage builds
+	/// the MPSSE command stream of a frame itself, and the transmit stage,
+	/// the only one to touch the device, sends it with one write.
+	///
+	/// The pipeline owns the RA8875 and its device while it exists: do not
+	/// use either from any other thread, nor from the one calling push().
+	///
+	class FramePipeline
+	{
+	public:
+		// 'workers' 0 picks one per core; 'depth' frames may be in flight.
+		FramePipeline(RA8875& tft, int workers = 0, size_t depth = 3);
+		~FramePipeline();
+
+		FramePipeline(const FramePipeline&) = delete;
+		FramePipeline& operator=(const FramePipeline&) = delete;
+
+		///
+		/// Queue a host order RGB565 frame of the display's size, 'stride'
+		/// pixels between rows (0 for packed rows).  The pixels are copied,
+		/// so the caller may reuse them at once.  Blocks while 'depth'
+		/// frames are in flight.  Call from one thread only.
+		///
+		void      push(const uint16_t* pixels, size_t stride = 0);
+
+		// Wait until every pushed frame has been sent.
+		void      drain();
+
+		/* Counters */
+		uint64_t  framesSent() const { return m_framesSent.load(); }
+		uint64_t  regionsSent() const { return m_regionsSent.load(); }
+		uint64_t  bytesSent() const { return m_bytesSent.load(); }
+
+	private:
+		// Rows of one region converted by a single worker call.
+		struct Job
+		{
+			uint32_t region;
+			uint16_t first;
+			uint16_t rows;
+		};
+
+		struct Slot
+		{
+			std::vector<uint16_t>          pixels;
+			std::vector<Framebuffer::Rect> regions;
+			std::vector<size_t>            offsets;     // of each region in 'converted'
+			std::vector<Job>               jobs;
+			std::vector<uint8_t>           converted;
+			std::vector<uint8_t>           stream;
+		};
+
+		typedef SpscQueue<Slot*> Queue;
+
+		void      diffStage();
+		void      convertStage();
+		void      encodeStage();
+		void      transmitStage();
+
+		Slot*     take(Queue& queue);
+		void      pass(Queue& queue, Slot* slot);
+
+		void      diff(Slot& slot);
+		void      convert(Slot& slot, const Job& job, int worker);
+		void      encode(Slot& slot) const;
+		void      putFrame(std::vector<uint8_t>& out, const uint8_t* payload, size_t length) const;
+		void      putRegister(std::vector<uint8_t>& out, uint8_t reg, uint8_t value) const;
+		void      putRegister16(std::vector<uint8_t>& out, uint8_t reg, uint16_t value) const;
+
+	private:
+		RA8875&   m_tft;
+		int       m_width;
+		int       m_height;
+		uint8_t   m_bpp;
+		TFT_Dither m_dither;
+		int16_t   m_window[4];            // to restore after each frame
+		SPI::WriteFraming m_framing;
+		size_t    m_regionCost;
+
+		TileDiff  m_tiles;
+		WorkerPool m_pool;
+		std::vector<ErrorDiffusion> m_diffusion;    // one per worker
+
+		std::vector<std::unique_ptr<Slot>> m_slots;
+		Queue     m_free;
+		Queue     m_toDiff;
+		Queue     m_toConvert;
+		Queue     m_toEncode;
+		Queue     m_toTransmit;
+
+		std::atomic<bool>     m_stop;
+		uint64_t              m_framesPushed;
+		std::atomic<uint64_t> m_framesSent;
+		std::atomic<uint64_t> m_regionsSent;
+		std::atomic<uint64_t> m_bytesSent;
+		std::vector<std::thread> m_threads;
+	};
+}
@@ -0,0 +1,182 @@
+#include "Framebuffer.h"
+
+#include <algorithm>
+
+namespace hw
+{
+	Framebuffer::Framebuffer(int width, int height)
+		: m_canvas(width, height)
+	{
+	}
+
+	Framebuffer::Rect Framebuffer::bounds(const Rect& a, const Rect& b)
+	{
+		Rect r = { std::min(a.x0, b.x0), std::min(a.y0, b.y0), std::max(a.x1, b.x1), std::max(a.y1, b.y1) };
+		return r;
+	}
+
+	size_t Framebuffer::area(const Rect& r)
+	{
+		return size_t(r.x1 - r.x0 + 1) * size_t(r.y1 - r.y0 + 1);
+	}
+
+	/*
+	 * Regions inside another one are dropped and regions inside the new
+	 * one replaced.  Past kMaxRegions the pair whose bounding box grows
+	 * least is merged, so marking stays cheap however much is drawn.
+	 */
+	void Framebuffer::markDirty(int x0, int y0, int x1, int y1)
+	{
+		if (x0 > x1)
+			std::swap(x0, x1);
+		if (y0 > y1)
+			std::swap(y0, y1);
+		x0 = std::max(x0, 0);
+		y0 = std::max(y0, 0);
+		x1 = std::min(x1, width() - 1);
+		y1 = std::min(y1, height() - 1);
+		if (x0 > x1 || y0 > y1)
+			return;
+
+		Rect r = { x0, y0, x1, y1 };
+		for (size_t i = 0; i < m_dirty.size(); )
+		{
+			const Rect& d = m_dirty[i];
+			if (d.x0 <= r.x0 && d.y0 <= r.y0 && d.x1 >= r.x1 && d.y1 >= r.y1)
+				return;
+			if (r.x0 <= d.x0 && r.y0 <= d.y0 && r.x1 >= d.x1 && r.y1 >= d.y1)
+			{
+				m_dirty[i] = m_dirty.back();
+				m_dirty.pop_back();
+				continue;
+			}
+			++i;
+		}
+
+		m_dirty.push_back(r);
+		if (m_dirty.size() > kMaxRegions)
+			mergeCheapest(m_dirty, 1, 0, true);
+	}
+
+	void Framebuffer::markAllDirty()
+	{
+		m_dirty.clear();
+		markDirty(0, 0, width() - 1, height() - 1);
+	}
+
+	/*
+	 * Merge the pair that saves the most bytes, or with 'always' the one
+	 * that costs the fewest extra; false if no pair was merged.
+	 */
+	bool Framebuffer::mergeCheapest(std::vector<Rect>& regions, size_t pixelBytes, size_t regionCost, bool always)
+	{
+		size_t bestI = 0, bestJ = 0;
+		long long bestSaving = 0;
+		bool found = false;
+
+		for (size_t i = 0; i < regions.size(); ++i)
+		{
+			long long costI = (long long)(regionCost + area(regions[i]) * pixelBytes);
+			for (size_t j = i + 1; j < regions.size(); ++j)
+			{
+				long long costJ = (long long)(regionCost + area(regions[j]) * pixelBytes);
+				long long merged = (long long)(regionCost + area(bounds(regions[i], regions[j])) * pixelBytes);
+				long long saving = costI + costJ - merged;
+				if ((saving >= 0 || always) && (!found || saving > bestSaving))
+				{
+					bestI = i;
+					bestJ = j;
+					bestSaving = saving;
+					found = true;
+				}
+			}
+		}
+
+		if (!found)
+			return false;
+
+		regions[bestI] = bounds(regions[bestI], regions[bestJ]);
+		regions[bestJ] = regions.back();
+		regions.pop_back();
+		return true;
+	}
+
+	void Framebuffer::takeDirty(std::vector<Rect>& regions, size_t pixelBytes, size_t regionCost)
+	{
+		regions.swap(m_dirty);
+		m_dirty.clear();
+		coalesce(regions, pixelBytes, regionCost);
+	}
+
+	void Framebuffer::coalesce(std::vector<Rect>& regions, size_t pixelBytes, size_t regionCost)
+	{
+		while (mergeCheapest(regions, pixelBytes, regionCost, false))
+		{
+		}
+
+		// Top to bottom, then left to right, for a predictable upload order.
+		std::sort(regions.begin(), regions.end(), [](const Rect& a, const Rect& b) {
+			return a.y0 != b.y0 ? a.y0 < b.y0 : a.x0 < b.x0;
+		});
+	}
+
+	void Framebuffer::fill(uint16_t color)
+	{
+		m_canvas.fill(color);
+		markAllDirty();
+	}
+
+	void Framebuffer::drawPixel(int x, int y, uint16_t color)
+	{
+		m_canvas.drawPixel(x, y, color);
+		markDirty(x, y, x, y);
+	}
+
+	void Framebuffer::drawLine(int x0, int y0, int x1, int y1, uint16_t color)
+	{
+		m_canvas.drawLine(x0, y0, x1, y1, color);
+		markDirty(x0, y0, x1, y1);
+	}
+
+	void Framebuffer::drawRect(int x0, int y0, int x1, int y1, uint16_t color)
+	{
+		m_canvas.drawRect(x0, y0, x1, y1, color);
+		// Four edges, so a large outline does not dirty its inside.
+		markDirty(x0, y0, x1, y0);
+		markDirty(x0, y1, x1, y1);
+		markDirty(x0, y0, x0, y1);
+		markDirty(x1, y0, x1, y1);
+	}
+
+	void Framebuffer::fillRect(int x0, int y0, int x1, int y1, uint16_t color)
+	{
+		m_canvas.fillRect(x0, y0, x1, y1, color);
+		markDirty(x0, y0, x1, y1);
+	}
+
+	void Framebuffer::drawTriangle(int x0, int y0, int x1, int y1, int x2, int y2, uint16_t color)
+	{
+		m_canvas.drawTriangle(x0, y0, x1, y1, x2, y2, color);
+		markDirty(std::min(x0, std::min(x1, x2)), std::min(y0, std::min(y1, y2)),
+		          std::max(x0, std::max(x1, x2)), std::max(y0, std::max(y1, y2)));
+	}
+
+	void Framebuffer::fillTriangle(int x0, int y0, int x1, int y1, int x2, int y2, uint16_t color)
+	{
+		m_canvas.fillTriangle(x0, y0, x1, y1, x2, y2, color);
+		markDirty(std::min(x0, std::min(x1, x2)), std::min(y0, std::min(y1, y2)),
+		          std::max(x0, std::max(x1, x2)), std::max(y0, std::max(y1, y2)));
+	}
+
+	void Framebuffer::drawEllipse(int cx, int cy, int a, int b, uint16_t color, uint8_t quadrants)
+	{
+		m_canvas.drawEllipse(cx, cy, a, b, color, quadrants);
+		markDirty(cx - a, cy - b, cx + a, cy + b);
+	}
+
+	void Framebuffer::fillEllipse(int cx, int cy, int a, int b, uint16_t color, uint8_t quadrants)
+	{
+		m_canvas.fillEllipse(cx, cy, a, b, color, quadrants);
+		markDirty(cx - a, cy - b, cx + a, cy + b);
+	}
+}
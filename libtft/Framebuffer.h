@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Canvas.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace hw
+{
+	///
+	/// A host copy of display memory plus the regions changed since they
+	/// were last taken.  With RA8875::setFramebuffer() on, drawing calls
+	/// land here and RA8875::flushFramebuffer() uploads only the dirty
+	/// regions.
+	///
+	class Framebuffer
+	{
+	public:
+		// Inclusive corners, as in the RA8875 registers.
+		struct Rect
+		{
+			int x0, y0, x1, y1;
+		};
+
+		Framebuffer(int width, int height);
+
+		int       width() const { return m_canvas.width(); }
+		int       height() const { return m_canvas.height(); }
+		Canvas&   canvas() { return m_canvas; }
+		const Canvas& canvas() const { return m_canvas; }
+
+		// Clipped to the screen; drawing through canvas() needs this too.
+		void      markDirty(int x0, int y0, int x1, int y1);
+		void      markAllDirty();
+		bool      dirty() const { return !m_dirty.empty(); }
+		const std::vector<Rect>& dirtyRegions() const { return m_dirty; }
+
+		///
+		/// Move the dirty regions to 'regions' and start clean.  Regions
+		/// are merged wherever their bounding box costs fewer bytes to
+		/// upload than they do separately, each upload costing
+		/// 'regionCost' bytes of setup plus 'pixelBytes' per pixel.
+		///
+		void      takeDirty(std::vector<Rect>& regions, size_t pixelBytes, size_t regionCost);
+
+		// The merging of takeDirty(), for regions from elsewhere.
+		static void coalesce(std::vector<Rect>& regions, size_t pixelBytes, size_t regionCost);
+
+		/* Drawing, marking what it touches */
+		void      fill(uint16_t color);
+		void      drawPixel(int x, int y, uint16_t color);
+		void      drawLine(int x0, int y0, int x1, int y1, uint16_t color);
+		void      drawRect(int x0, int y0, int x1, int y1, uint16_t color);
+		void      fillRect(int x0, int y0, int x1, int y1, uint16_t color);
+		void      drawTriangle(int x0, int y0, int x1, int y1, int x2, int y2, uint16_t color);
+		void      fillTriangle(int x0, int y0, int x1, int y1, int x2, int y2, uint16_t color);
+		void      drawEllipse(int cx, int cy, int a, int b, uint16_t color, uint8_t quadrants = Canvas::AllQuadrants);
+		void      fillEllipse(int cx, int cy, int a, int b, uint16_t color, uint8_t quadrants = Canvas::AllQuadrants);
+
+	private:
+		static const size_t kMaxRegions = 64;
+
+		static Rect     bounds(const Rect& a, const Rect& b);
+		static size_t   area(const Rect& r);
+		static bool     mergeCheapest(std::vector<Rect>& regions, size_t pixelBytes, size_t regionCost, bool always);
+
+	private:
+		Canvas            m_canvas;
+		std::vector<Rect> m_dirty;
+	};
+}
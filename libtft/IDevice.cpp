@@ -16,4 +16,17 @@ namespace hw
 	{
 		return write(list.begin(), list.size());
 	}
+
+	bool IDevice::beginRead(uint8_t* data, int expected, int timeOutInMs)
+	{
+		m_splitRead = read(data, expected, timeOutInMs);
+		return m_splitRead >= 0;
+	}
+
+	bool IDevice::pollRead(int& result)
+	{
+		result = m_splitRead;
+		m_splitRead = -1;
+		return true;
+	}
 }
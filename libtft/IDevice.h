@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <stdlib.h>
 #include <initializer_list>
+#include <vector>
 
 namespace hw
 {
@@ -17,6 +18,22 @@ namespace hw
 		In, Out,
 	};
 
+	// Trade-off used when waiting for reads: answer as soon as possible, or
+	// let the adapter batch replies and sleep for longer between wakeups.
+	enum class LatencyProfile
+	{
+		LowestLatency, LowestCpu,
+	};
+
+	// USB traffic since the device was opened or the counters were reset.
+	struct TransferStats
+	{
+		size_t writes;          // bulk writes handed to the USB stack
+		size_t reads;
+		size_t bytesWritten;
+		size_t bytesRead;
+	};
+
 	class IDevice
 	{
 	public:
@@ -38,14 +55,65 @@ namespace hw
 		inline bool       isHigh(Pin pin)  { return getPinValue(pin); }
 		inline bool       isLow(Pin pin)   { return !getPinValue(pin); }
 
+		// Update the cached pin state and store the MPSSE command that applies it
+		// in 'out' instead of sending it.  Returns the number of bytes stored
+		// (at most kMaxPinCommand).
+		static const size_t kMaxPinCommand = 3;
+		virtual size_t    encodePinValue(Pin pin, bool value, uint8_t* out) = 0;
+
+		// Queue a command that stalls the command stream until the input pin
+		// reads 'value'.  Returns false if the device can't wait on that pin.
+		virtual bool      waitForPin(Pin pin, bool value) = 0;
+		// Whether waitForPin() works on 'pin'.  Queues nothing.
+		virtual bool      canWaitForPin(Pin pin) const = 0;
+
 		// MPSSE access.
 		virtual void      setClock(int clock_hz, bool adaptive = false, bool three_phase = false) = 0;
 		virtual int       write(const uint8_t* data, size_t length) = 0;
+
+		// Store the command that changes only the clock divisor (keeping the
+		// mode set by setClock()) in 'out'.  Returns the number of bytes
+		// stored, at most kMaxClockCommand.
+		static const size_t kMaxClockCommand = 3;
+		virtual size_t    encodeClock(int clock_hz, uint8_t* out) = 0;
 		virtual int       read(uint8_t* data, int expected, int timeOutInMs = 500) = 0;
 
+		// read() in two steps, for callers waiting on several devices from
+		// one thread.  beginRead() sends what is buffered and starts reading
+		// 'expected' bytes into 'data', which must stay valid until the read
+		// is over.  pollRead() doesn't block: it returns false while the
+		// read is in flight, then true with the byte count (or a negative
+		// error) in 'result'.  One split read at a time per device.  A
+		// read() meanwhile finishes the split read first, since its reply
+		// comes back first; pollRead() still returns its result.  The
+		// defaults do the whole read() in beginRead().
+		virtual bool      beginRead(uint8_t* data, int expected, int timeOutInMs = 500);
+		virtual bool      pollRead(int& result);
+
+		// How long the adapter holds back a partial reply before sending it.
+		virtual bool      setLatencyTimer(int ms) = 0;
+		virtual void      setLatencyProfile(LatencyProfile profile) = 0;
+
+		// Push any buffered commands to the device.  Returns the number of
+		// bytes sent, or a negative value on error.
+		virtual int       flush() = 0;
+
+		// Command capture.  Between beginCapture() and endCapture() everything
+		// written is collected instead of sent, and endCapture() hands the
+		// byte stream over.  read() is not available while capturing.
+		virtual void      beginCapture() = 0;
+		virtual void      endCapture(std::vector<uint8_t>& stream) = 0;
+		virtual size_t    captured() const = 0;
+
+		virtual TransferStats transferStats() const = 0;
+		virtual void      resetTransferStats() = 0;
+
 		int               writeByte(uint8_t data);
 		int               writeUInt16(uint16_t data);
 		int               writeList(const std::initializer_list<uint8_t>& list);
+
+	private:
+		int               m_splitRead = -1;
 	};
 }
 
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+
+namespace hw
+{
+	///
+	/// Bounded lock-free queue for any number of producer threads and one
+	/// consumer thread (D. Vyukov's bounded queue).  Each cell carries a
+	/// sequence number telling producers and the consumer whose turn it
+	/// is, so a push is one compare-and-swap on the tail and a pop takes
+	/// no atomic read-modify-write at all.  Storage is allocated once; the
+	/// capacity is rounded up to a power of two.
+	///
+	template <class T>
+	class MpscQueue
+	{
+	public:
+		explicit MpscQueue(size_t capacity)
+			: m_head(0)
+			, m_tail(0)
+		{
+			size_t size = 1;
+			while (size < capacity)
+				size <<= 1;
+			m_cells.reset(new Cell[size]);
+			m_mask = size - 1;
+			for (size_t i = 0; i < size; ++i)
+				m_cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+
+		MpscQueue(const MpscQueue&) = delete;
+		MpscQueue& operator=(const MpscQueue&) = delete;
+
+		// Any thread; false if the queue is full.
+		bool tryPush(T&& item)
+		{
+			size_t pos = m_tail.load(std::memory_order_relaxed);
+			Cell* cell;
+			for (;;)
+			{
+				cell = &m_cells[pos & m_mask];
+				size_t seq = cell->sequence.load(std::memory_order_acquire);
+				intptr_t diff = intptr_t(seq) - intptr_t(pos);
+				if (diff == 0)
+				{
+					if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (diff < 0)
+				{
+					return false;
+				}
+				else
+				{
+					pos = m_tail.load(std::memory_order_relaxed);
+				}
+			}
+
+			cell->item = std::move(item);
+			cell->sequence.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer only; false if the queue is empty.
+		bool tryPop(T& item)
+		{
+			Cell& cell = m_cells[m_head & m_mask];
+			if (cell.sequence.load(std::memory_order_acquire) != m_head + 1)
+				return false;
+
+			item = std::move(cell.item);
+			cell.sequence.store(m_head + m_mask + 1, std::memory_order_release);
+			++m_head;
+			return true;
+		}
+
+		// Consumer only.
+		bool empty() const
+		{
+			return m_cells[m_head & m_mask].sequence.load(std::memory_order_acquire) != m_head + 1;
+		}
+
+	private:
+		struct Cell
+		{
+			std::atomic<size_t> sequence;
+			T                   item;
+		};
+
+		std::unique_ptr<Cell[]> m_cells;
+		size_t                  m_mask;
+
+		// Apart, so the consumer doesn't share a cache line with producers.
+		alignas(64) size_t              m_head;
+		alignas(64) std::atomic<size_t> m_tail;
+	};
+}
@@ -0,0 +1,198 @@
+#include "MpsseDecoder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <ftdi.h>
+
+namespace hw
+{
+	// Marks opcodes the MPSSE engine rejects with a bad command reply.
+	static const size_t kBadCommand = ~size_t(0);
+
+	MpsseDecoder::MpsseDecoder(Listener& listener)
+		: m_listener(&listener)
+	{
+		reset();
+	}
+
+	void MpsseDecoder::reset()
+	{
+		m_state = State::Opcode;
+		m_opcode = 0;
+		m_args[0] = 0;
+		m_args[1] = 0;
+		m_argCount = 0;
+		m_argNeeded = 0;
+		m_remaining = 0;
+	}
+
+	void MpsseDecoder::feed(const uint8_t* data, size_t length, std::vector<uint8_t>& response)
+	{
+		for (size_t i = 0; i < length; ++i)
+		{
+			uint8_t b = data[i];
+			switch (m_state)
+			{
+			case State::Opcode:
+				m_opcode = b;
+				m_argCount = 0;
+				m_argNeeded = argumentCount(b);
+				if (m_argNeeded == 0 || m_argNeeded == kBadCommand)
+					execute(response);
+				else
+					m_state = State::Arguments;
+				break;
+
+			case State::Arguments:
+				m_args[m_argCount++] = b;
+				if (m_argCount == m_argNeeded)
+					execute(response);
+				break;
+
+			case State::Payload:
+			{
+				uint8_t in = m_listener->onShiftByte(m_opcode, b);
+				if (m_opcode & MPSSE_DO_READ)
+					response.push_back(in);
+				if (--m_remaining == 0)
+				{
+					m_listener->onShiftEnd(m_opcode);
+					m_state = State::Opcode;
+				}
+				break;
+			}
+			}
+		}
+	}
+
+	size_t MpsseDecoder::argumentCount(uint8_t opcode)
+	{
+		if (isShift(opcode))
+		{
+			if (opcode & MPSSE_WRITE_TMS)
+				return 2;
+			if (opcode & MPSSE_BITMODE)
+				return (opcode & MPSSE_DO_WRITE) ? 2 : 1;
+			return 2;
+		}
+
+		switch (opcode)
+		{
+		case SET_BITS_LOW:
+		case SET_BITS_HIGH:
+		case TCK_DIVISOR:
+		case CLK_BYTES:
+		case CLK_BYTES_OR_HIGH:
+		case CLK_BYTES_OR_LOW:
+		case DRIVE_OPEN_COLLECTOR:
+			return 2;
+		case CLK_BITS:
+			return 1;
+		case GET_BITS_LOW:
+		case GET_BITS_HIGH:
+		case LOOPBACK_START:
+		case LOOPBACK_END:
+		case SEND_IMMEDIATE:
+		case WAIT_ON_HIGH:
+		case WAIT_ON_LOW:
+		case DIS_DIV_5:
+		case EN_DIV_5:
+		case EN_3_PHASE:
+		case DIS_3_PHASE:
+		case CLK_WAIT_HIGH:
+		case CLK_WAIT_LOW:
+		case EN_ADAPTIVE:
+		case DIS_ADAPTIVE:
+			return 0;
+		default:
+			return kBadCommand;
+		}
+	}
+
+	void MpsseDecoder::execute(std::vector<uint8_t>& response)
+	{
+		m_state = State::Opcode;
+
+		if (isShift(m_opcode))
+		{
+			bool reads = (m_opcode & MPSSE_DO_READ) != 0;
+			bool writes = (m_opcode & MPSSE_DO_WRITE) != 0;
+
+			if (m_opcode & (MPSSE_BITMODE | MPSSE_WRITE_TMS))
+			{
+				// Bit mode: a single byte with up to 8 bits in it.
+				m_listener->onShiftBegin(m_opcode, size_t(m_args[0]) + 1);
+				uint8_t in = m_listener->onShiftByte(m_opcode, writes || (m_opcode & MPSSE_WRITE_TMS) ? m_args[1] : 0);
+				if (reads)
+					response.push_back(in);
+				m_listener->onShiftEnd(m_opcode);
+				return;
+			}
+
+			size_t length = (size_t(m_args[0]) | size_t(m_args[1]) << 8) + 1;
+			m_listener->onShiftBegin(m_opcode, length);
+			if (writes)
+			{
+				// The data follows the command.
+				m_remaining = length;
+				m_state = State::Payload;
+				return;
+			}
+
+			for (size_t i = 0; i < length; ++i)
+			{
+				uint8_t in = m_listener->onShiftByte(m_opcode, 0);
+				if (reads)
+					response.push_back(in);
+			}
+			m_listener->onShiftEnd(m_opcode);
+			return;
+		}
+
+		switch (m_opcode)
+		{
+		case SET_BITS_LOW:
+		case SET_BITS_HIGH:
+			m_listener->onSetBits(m_opcode == SET_BITS_LOW ? 0 : 1, m_args[0], m_args[1]);
+			break;
+		case GET_BITS_LOW:
+		case GET_BITS_HIGH:
+			response.push_back(m_listener->onGetBits(m_opcode == GET_BITS_LOW ? 0 : 1));
+			break;
+		case TCK_DIVISOR:
+			m_listener->onClockDivisor(uint16_t(m_args[0] | m_args[1] << 8));
+			break;
+		case SEND_IMMEDIATE:
+			m_listener->onSendImmediate();
+			break;
+		case WAIT_ON_HIGH:
+		case WAIT_ON_LOW:
+			m_listener->onWaitPin(m_opcode == WAIT_ON_HIGH);
+			break;
+		case LOOPBACK_START:
+		case LOOPBACK_END:
+		case DIS_DIV_5:
+		case EN_DIV_5:
+		case EN_3_PHASE:
+		case DIS_3_PHASE:
+		case EN_ADAPTIVE:
+		case DIS_ADAPTIVE:
+			m_listener->onClockMode(m_opcode);
+			break;
+		case CLK_BITS:
+		case CLK_BYTES:
+		case CLK_WAIT_HIGH:
+		case CLK_WAIT_LOW:
+		case CLK_BYTES_OR_HIGH:
+		case CLK_BYTES_OR_LOW:
+		case DRIVE_OPEN_COLLECTOR:
+			// Clocking without data and pin drive modes, nothing to report.
+			break;
+		default:
+			// The chip answers an unknown opcode with 0xFA and the opcode.
+			response.push_back(0xFA);
+			response.push_back(m_opcode);
+			m_listener->onBadCommand(m_opcode);
+			break;
+		}
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace hw
+{
+	///
+	/// Splits an FT232H MPSSE command stream into commands and reports them
+	/// to a Listener.  Commands may be split across any number of feed()
+	/// calls.  Bytes the chip would send back (GPIO reads, data clocked in,
+	/// bad command replies) are appended to the response vector.
+	///
+	class MpsseDecoder
+	{
+	public:
+		class Listener
+		{
+		public:
+			virtual ~Listener() {}
+
+			// GPIO bank 0 (D0-D7) or 1 (C0-C7).
+			virtual void    onSetBits(int /*bank*/, uint8_t /*value*/, uint8_t /*direction*/) {}
+			virtual uint8_t onGetBits(int /*bank*/) { return 0; }
+
+			// Clock setup: TCK_DIVISOR, and the mode opcodes without arguments
+			// (divide by 5, three phase, adaptive clocking, loopback).
+			virtual void    onClockDivisor(uint16_t /*divisor*/) {}
+			virtual void    onClockMode(uint8_t /*opcode*/) {}
+
+			// A data shift command: onShiftBegin(), one onShiftByte() per byte
+			// clocked (returning the byte read, if the command reads), then
+			// onShiftEnd().  Bit mode commands report their bit count instead
+			// of a byte count and a single onShiftByte().
+			virtual void    onShiftBegin(uint8_t /*opcode*/, size_t /*length*/) {}
+			virtual uint8_t onShiftByte(uint8_t /*opcode*/, uint8_t /*out*/) { return 0; }
+			virtual void    onShiftEnd(uint8_t /*opcode*/) {}
+
+			virtual void    onWaitPin(bool /*high*/) {}
+			virtual void    onSendImmediate() {}
+			virtual void    onBadCommand(uint8_t /*opcode*/) {}
+		};
+
+		explicit MpsseDecoder(Listener& listener);
+
+		void    feed(const uint8_t* data, size_t length, std::vector<uint8_t>& response);
+		void    reset();
+		bool    idle() const { return m_state == State::Opcode; }
+
+		static bool isShift(uint8_t opcode) { return (opcode & 0x80) == 0; }
+
+	private:
+		enum class State
+		{
+			Opcode,
+			Arguments,
+			Payload,
+		};
+
+		static size_t argumentCount(uint8_t opcode);
+		void    execute(std::vector<uint8_t>& response);
+
+	private:
+		Listener* m_listener;
+		State     m_state;
+		uint8_t   m_opcode;
+		uint8_t   m_args[2];
+		size_t    m_argCount;
+		size_t    m_argNeeded;
+		size_t    m_remaining;
+	};
+}
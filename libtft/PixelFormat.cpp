@@ -0,0 +1,814 @@
+#include "PixelFormat.h"
+#include <string.h>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__)) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TFT_PIXEL_SSE2 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// AVX2 kernels are compiled for AVX2 whatever the build flags, and only
+// called once the CPU reported it.
+#if defined(TFT_PIXEL_SSE2) && (defined(__GNUC__) || defined(_MSC_VER))
+#define TFT_PIXEL_AVX2 1
+#if defined(__GNUC__)
+#define TFT_AVX2 __attribute__((target("avx2")))
+#else
+#define TFT_AVX2
+#endif
+#endif
+
+namespace hw
+{
+	namespace
+	{
+		// 'bias' is only read by the ordered dithering kernels.
+		typedef void (*Kernel)(const uint8_t* src, size_t count, uint8_t* out, const uint8_t* bias);
+		typedef uint64_t (*HashKernel)(const uint8_t* src, size_t rowBytes, size_t rows, size_t strideBytes);
+
+		struct Kernels
+		{
+			const char* name;
+			Kernel      rgb565[PixelFormatCount];
+			Kernel      rgb332[PixelFormatCount];
+			Kernel      ordered565[PixelFormatCount];
+			Kernel      ordered332[PixelFormatCount];
+			HashKernel  hash;
+		};
+
+		/*
+		 * Portable kernels, for any CPU and for the tails of the vector
+		 * ones.  R, G and B are byte offsets in a pixel of Size bytes.
+		 *
+		 * Ordered dithering scales each channel so that the output levels
+		 * land on multiples of the truncation step (255 maps to 31 * 8 for
+		 * 5 bits) and adds a bias of less than one step before truncating.
+		 * 'bias' holds 8 pixels of 4 bytes, with each channel at its offset
+		 * in the source pixel, and starts at the phase of the first pixel;
+		 * kernels keep the phase by working in multiples of 8 pixels.
+		 */
+		enum : unsigned
+		{
+			kScale5 = 249,  // 256 * 31 * 8 / 255
+			kScale6 = 253,  // 256 * 63 * 4 / 255
+			kScale3 = 225,  // 256 * 7 * 32 / 255
+			kScale2 = 193,  // 256 * 3 * 64 / 255
+		};
+		template <int R, int G, int B, int Size, bool Ordered>
+		void scalar565(const uint8_t* src, size_t count, uint8_t* out, const uint8_t* bias)
+		{
+			for (size_t i = 0; i < count; ++i, src += Size, out += 2)
+			{
+				unsigned r = src[R], g = src[G], b = src[B];
+				if (Ordered)
+				{
+					const uint8_t* d = bias + (i & 7) * 4;
+					r = ((r * kScale5) >> 8) + d[R];
+					g = ((g * kScale6) >> 8) + d[G];
+					b = ((b * kScale5) >> 8) + d[B];
+				}
+				out[0] = uint8_t((r & 0xF8) | (g >> 5));
+				out[1] = uint8_t(((g << 3) & 0xE0) | (b >> 3));
+			}
+		}
+
+		template <int R, int G, int B, int Size, bool Ordered>
+		void scalar332(const uint8_t* src, size_t count, uint8_t* out, const uint8_t* bias)
+		{
+			for (size_t i = 0; i < count; ++i, src += Size)
+			{
+				unsigned r = src[R], g = src[G], b = src[B];
+				if (Ordered)
+				{
+					const uint8_t* d = bias + (i & 7) * 4;
+					r = ((r * kScale3) >> 8) + d[R];
+					g = ((g * kScale3) >> 8) + d[G];
+					b = ((b * kScale2) >> 8) + d[B];
+				}
+				out[i] = uint8_t((r & 0xE0) | ((g >> 3) & 0x1C) | (b >> 6));
+			}
+		}
+
+		// Dithering RGB565 to RGB565 would only add noise, so this one
+		// serves both tables.
+		void scalarSwap565(const uint8_t* src, size_t count, uint8_t* out, const uint8_t*)
+		{
+			for (size_t i = 0; i < count; ++i, src += 2, out += 2)
+			{
+				out[0] = src[1];
+				out[1] = src[0];
+			}
+		}
+
+		// RGB565 channels widened to 8 bits, with the bias in R, G, B order.
+		template <bool Ordered>
+		void scalar565To332(const uint8_t* src, size_t count, uint8_t* out, const uint8_t* bias)
+		{
+			for (size_t i = 0; i < count; ++i, src += 2)
+			{
+				unsigned c = src[0] | (src[1] << 8);
+				unsigned r = ((c >> 8) & 0xF8) | (c >> 13);
+				unsigned g = ((c >> 3) & 0xFC) | ((c >> 9) & 0x03);
+				unsigned b = ((c << 3) & 0xF8) | ((c >> 2) & 0x07);
+				if (Ordered)
+				{
+					const uint8_t* d = bias + (i & 7) * 4;
+					r = ((r * kScale3) >> 8) + d[0];
+					g = ((g * kScale3) >> 8) + d[1];
+					b = ((b * kScale2) >> 8) + d[2];
+				}
+				out[i] = uint8_t((r & 0xE0) | ((g >> 3) & 0x1C) | (b >> 6));
+			}
+		}
+
+		/*
+		 * Block hash, after XXH3: four 64-bit lanes take 32 bytes at a
+		 * time, each adding the product of the low and high halves of its
+		 * word xor a key and its neighbour's plain word.  Keys move with the
+		 * stripe's place in the row and every row ends with a scramble, so
+		 * pixels that trade places change the hash.  A short stripe at the
+		 * end of a row is zero padded.  Every kernel gives the same result.
+		 */
+		const uint64_t kHashKeys[11] = {
+			0xa6c97ba8c1d91123ULL, 0x523b8a7f2192d72eULL, 0xddcdedcf9eaa2d75ULL, 0x5b249138f8746854ULL,
+			0xf81e128066fbf69dULL, 0xa9de772bbcefaa79ULL, 0xb687d1ab835890abULL, 0x4e7d418b9d18917cULL,
+			0xc5f8d04f8c8edf00ULL, 0x08fb76061b72370bULL, 0x2e88e6f907ae4a17ULL,
+		};
+		const uint64_t kHashScramble[4] = {
+			0x719045d1de75212cULL, 0xc360cd692a677396ULL, 0x0f72e54d527fd8b7ULL, 0xe63cc838b444db93ULL,
+		};
+		const uint64_t kHashInit[4] = {
+			0x0ff9596e87c87f35ULL, 0x42574434a9dd1933ULL, 0x711264c32008b9daULL, 0xa20b7a996026c7c5ULL,
+		};
+		const uint32_t kHashPrime = 0x9E3779B1u;
+
+		inline uint64_t hashMix(uint64_t h)
+		{
+			h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+			return h ^ (h >> 31);
+		}
+
+		uint64_t hashFinish(const uint64_t acc[4], size_t rowBytes, size_t rows)
+		{
+			uint64_t h = hashMix((uint64_t(rowBytes) << 32) ^ uint64_t(rows));
+			for (int i = 0; i < 4; ++i)
+				h = hashMix(h ^ acc[i]);
+			return h;
+		}
+
+		void scalarStripe(uint64_t acc[4], const uint8_t* src, const uint64_t* key)
+		{
+			uint64_t d[4];
+			memcpy(d, src, sizeof(d));
+			for (int i = 0; i < 4; ++i)
+			{
+				uint64_t dk = d[i] ^ key[i];
+				acc[i] += d[i ^ 1] + (dk & 0xFFFFFFFFu) * (dk >> 32);
+			}
+		}
+
+		uint64_t scalarHash(const uint8_t* src, size_t rowBytes, size_t rows, size_t strideBytes)
+		{
+			uint64_t acc[4];
+			memcpy(acc, kHashInit, sizeof(acc));
+			for (size_t row = 0; row < rows; ++row, src += strideBytes)
+			{
+				size_t i = 0, stripe = 0;
+				for (; i + 32 <= rowBytes; i += 32, ++stripe)
+					scalarStripe(acc, src + i, kHashKeys + (stripe & 7));
+				if (i < rowBytes)
+				{
+					uint8_t tail[32] = {};
+					memcpy(tail, src + i, rowBytes - i);
+					scalarStripe(acc, tail, kHashKeys + (stripe & 7));
+				}
+				for (int l = 0; l < 4; ++l)
+				{
+					uint64_t a = acc[l];
+					a ^= a >> 47;
+					a ^= kHashScramble[l];
+					acc[l] = a * kHashPrime;
+				}
+			}
+			return hashFinish(acc, rowBytes, rows);
+		}
+
+		const Kernels kScalar = {
+			"scalar",
+			{ scalarSwap565, scalar565<0, 1, 2, 3, false>, scalar565<1, 2, 3, 4, false>, scalar565<2, 1, 0, 4, false> },
+			{ scalar565To332<false>, scalar332<0, 1, 2, 3, false>, scalar332<1, 2, 3, 4, false>, scalar332<2, 1, 0, 4, false> },
+			{ scalarSwap565, scalar565<0, 1, 2, 3, true>, scalar565<1, 2, 3, 4, true>, scalar565<2, 1, 0, 4, true> },
+			{ scalar565To332<true>, scalar332<0, 1, 2, 3, true>, scalar332<1, 2, 3, 4, true>, scalar332<2, 1, 0, 4, true> },
+			scalarHash,
+		};
+
+#if defined(TFT_PIXEL_SSE2)
+		/*
+		 * The vector kernels work on 32 bit lanes holding one pixel each,
+		 * with its channels RS, GS and BS bits up.  A lane becomes the two
+		 * output bytes of big endian RGB565 in its low half; packing to 16
+		 * bits is signed in SSE2, hence the 0x8000 bias around it.  The
+		 * dither bias 'd' has the lane layout of the source.
+		 */
+		template <bool Ordered>
+		inline __m128i dither(__m128i c, __m128i d, int scale)
+		{
+			if (!Ordered)
+				return c;
+			return _mm_add_epi32(_mm_srli_epi32(_mm_mullo_epi16(c, _mm_set1_epi32(scale)), 8), d);
+		}
+
+		template <int RS, int GS, int BS, bool Ordered>
+		inline __m128i lanes565(__m128i w, __m128i d)
+		{
+			const __m128i ff = _mm_set1_epi32(0xFF);
+			__m128i r = dither<Ordered>(_mm_and_si128(_mm_srli_epi32(w, RS), ff), _mm_and_si128(_mm_srli_epi32(d, RS), ff), kScale5);
+			__m128i g = dither<Ordered>(_mm_and_si128(_mm_srli_epi32(w, GS), ff), _mm_and_si128(_mm_srli_epi32(d, GS), ff), kScale6);
+			__m128i b = dither<Ordered>(_mm_and_si128(_mm_srli_epi32(w, BS), ff), _mm_and_si128(_mm_srli_epi32(d, BS), ff), kScale5);
+
+			__m128i hi = _mm_or_si128(_mm_and_si128(r, _mm_set1_epi32(0xF8)), _mm_srli_epi32(g, 5));
+			__m128i lo = _mm_or_si128(_mm_and_si128(_mm_slli_epi32(g, 11), _mm_set1_epi32(0xE000)),
+			                          _mm_and_si128(_mm_slli_epi32(b, 5), _mm_set1_epi32(0x1F00)));
+			return _mm_sub_epi32(_mm_or_si128(hi, lo), _mm_set1_epi32(0x8000));
+		}
+
+		template <int RS, int GS, int BS, bool Ordered>
+		inline __m128i lanes332(__m128i w, __m128i d)
+		{
+			const __m128i ff = _mm_set1_epi32(0xFF);
+			__m128i r = dither<Ordered>(_mm_and_si128(_mm_srli_epi32(w, RS), ff), _mm_and_si128(_mm_srli_epi32(d, RS), ff), kScale3);
+			__m128i g = dither<Ordered>(_mm_and_si128(_mm_srli_epi32(w, GS), ff), _mm_and_si128(_mm_srli_epi32(d, GS), ff), kScale3);
+			__m128i b = dither<Ordered>(_mm_and_si128(_mm_srli_epi32(w, BS), ff), _mm_and_si128(_mm_srli_epi32(d, BS), ff), kScale2);
+			return _mm_or_si128(_mm_and_si128(r, _mm_set1_epi32(0xE0)),
+			       _mm_or_si128(_mm_and_si128(_mm_srli_epi32(g, 3), _mm_set1_epi32(0x1C)), _mm_srli_epi32(b, 6)));
+		}
+
+		inline __m128i pack565(__m128i a, __m128i b)
+		{
+			return _mm_xor_si128(_mm_packs_epi32(a, b), _mm_set1_epi16(short(0x8000)));
+		}
+
+		// The two halves of the 8 pixel bias.
+		template <bool Ordered>
+		inline void loadBias(const uint8_t* bias, __m128i& d0, __m128i& d1)
+		{
+			d0 = d1 = _mm_setzero_si128();
+			if (Ordered)
+			{
+				d0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bias));
+				d1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bias + 16));
+			}
+		}
+
+		// Four RGB888 pixels as lanes of R, G, B and a stray byte.
+		inline __m128i loadRgb888(const uint8_t* src)
+		{
+			uint32_t w[4];
+			memcpy(&w[0], src + 0, 4);
+			memcpy(&w[1], src + 3, 4);
+			memcpy(&w[2], src + 6, 4);
+			memcpy(&w[3], src + 9, 4);
+			return _mm_loadu_si128(reinterpret_cast<const __m128i*>(w));
+		}
+
+		template <int RS, int GS, int BS, bool Ordered>
+		void sse2Word565(const uint8_t* src, size_t count, uint8_t* out, const uint8_t* bias)
+		{
+			__m128i d0, d1;
+			loadBias<Ordered>(bias, d0, d1);
+
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8, src += 32, out += 16)
+			{
+				const __m128i* p = reinterpret_cast<const __m128i*>(src);
+				__m128i a = lanes565<RS, GS, BS, Ordered>(_mm_loadu_si128(p + 0), d0);
+				__m128i b = lanes565<RS, GS, BS, Ordered>(_mm_loadu_si128(p + 1), d1);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out), pack565(a, b));
+			}
+			scalar565<RS / 8, GS / 8, BS / 8, 4, Ordered>(src, count - i, out, bias);
+		}
+
+		template <int RS, int GS, int BS, bool Ordered>
+		void sse2Word332(const uint8_t* src, size_t count, uint8_t* out, const uint8_t* bias)
+		{
+			__m128i d0, d1;
+			loadBias<Ordered>(bias, d0, d1);
+
+			size_t i = 0;
+			for (; i + 16 <= count; i += 16, src += 64, out += 16)
+			{
+				const __m128i* p = reinterpret_cast<const __m128i*>(src);
+				__m128i lo = _mm_packs_epi32(lanes332<RS, GS, BS, Ordered>(_mm_loadu_si128(p + 0), d0),
+				                             lanes332<RS, GS, BS, Ordered>(_mm_loadu_si128(p + 1), d1));
+				__m128i hi = _mm_packs_epi32(lanes332<RS, GS, BS, Ordered>(_mm_loadu_si128(p + 2), d0),
+				                             lanes332<RS, GS, BS, Ordered>(_mm_loadu_si128(p + 3), d1));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(lo, hi));
+			}
+			scalar332<RS / 8, GS / 8, BS / 8, 4, Ordered>(src, count - i, out, bias);
+		}
+
+		// Each group of four reads one byte past its last pixel, so the
+		// loops stop a pixel early.
+		template <bool Ordered>
+		void sse2Rgb888To565(const uint8_t* src, size_t count, uint8_t* out, const uint8_t* bias)
+		{
+			__m128i d0, d1;
+			loadBias<Ordered>(bias, d0, d1);
+
+			size_t i = 0;
+			for (; i + 9 <= count; i += 8, src += 24, out += 16)
+			{
+				__m128i a = lanes565<0, 8, 16, Ordered>(loadRgb888(src), d0);
+				__m128i b = lanes565<0, 8, 16, Ordered>(loadRgb888(src + 12), d1);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out), pack565(a, b));
+			}
+			scalar565<0, 1, 2, 3, Ordered>(src, count - i, out, bias);
+		}
+
+		template <bool Ordered>
+		void sse2Rgb888To332(const uint8_t* src, size_t count, uint8_t* out, const uint8_t* bias)
+		{
+			__m128i d0, d1;
+			loadBias<Ordered>(bias, d0, d1);
+
+			size_t i = 0;
+			for (; i + 17 <= count; i += 16, src += 48, out += 16)
+			{
+				__m128i lo = _mm_packs_epi32(lanes332<0, 8, 16, Ordered>(loadRgb888(src), d0),
+				                             lanes332<0, 8, 16, Ordered>(loadRgb888(src + 12), d1));
+				__m128i hi = _mm_packs_epi32(lanes332<0, 8, 16, Ordered>(loadRgb888(src + 24), d0),
+				                             lanes332<0, 8, 16, Ordered>(loadRgb888(src + 36), d1));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(lo, hi));
+			}
+			scalar332<0, 1, 2, 3, Ordered>(src, count - i, out, bias);
+		}
+
+		void sse2Swap565(const uint8_t* src, size_t count, uint8_t* out, const uint8_t* bias)
+		{
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8, src += 16, out += 16)
+			{
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)));
+			}
+			scalarSwap565(src, count - i, out, bias);
+		}
+
+		inline __m128i lanes565To332(__m128i v)
+		{
+			return _mm_or_si128(_mm_and_si128(_mm_srli_epi16(v, 8), _mm_set1_epi16(0xE0)),
+			       _mm_or_si128(_mm_and_si128(_mm_srli_epi16(v, 6), _mm_set1_epi16(0x1C)),
+			                    _mm_and_si128(_mm_srli_epi16(v, 3), _mm_set1_epi16(0x03))));
+		}
+
+		// Dithered RGB565 sources take the scalar kernel.
+		void sse2565To332(const uint8_t* src, size_t count, uint8_t* out, const uint8_t* bias)
+		{
+			size_t i = 0;
+			for (; i + 16 <= count; i += 16, src += 32, out += 16)
+			{
+				__m128i a = lanes565To332(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+				__m128i b = lanes565To332(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16)));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(a, b));
+			}
+			scalar565To332<false>(src, count - i, out, bias);
+		}
+
+		// Two lanes of the block hash; see scalarStripe().
+		inline __m128i sse2HashLanes(__m128i acc, __m128i d, __m128i key)
+		{
+			__m128i dk = _mm_xor_si128(d, key);
+			__m128i product = _mm_mul_epu32(dk, _mm_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1)));
+			return _mm_add_epi64(acc, _mm_add_epi64(product, _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2))));
+		}
+
+		inline __m128i sse2HashScramble(__m128i acc, __m128i key)
+		{
+			const __m128i prime = _mm_set1_epi32(int(kHashPrime));
+			acc = _mm_xor_si128(_mm_xor_si128(acc, _mm_srli_epi64(acc, 47)), key);
+			__m128i lo = _mm_mul_epu32(acc, prime);
+			__m128i hi = _mm_mul_epu32(_mm_srli_epi64(acc, 32), prime);
+			return _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+		}
+
+		uint64_t sse2Hash(const uint8_t* src, size_t rowBytes, size_t rows, size_t strideBytes)
+		{
+			__m128i acc0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kHashInit));
+			__m128i acc1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kHashInit + 2));
+			for (size_t row = 0; row < rows; ++row, src += strideBytes)
+			{
+				size_t i = 0, stripe = 0;
+				for (; i < rowBytes; i += 32, ++stripe)
+				{
+					const uint8_t* p = src + i;
+					uint8_t tail[32];
+					if (i + 32 > rowBytes)
+					{
+						memset(tail, 0, sizeof(tail));
+						memcpy(tail, p, rowBytes - i);
+						p = tail;
+					}
+					const uint64_t* key = kHashKeys + (stripe & 7);
+					acc0 = sse2HashLanes(acc0, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)),
+					                     _mm_loadu_si128(reinterpret_cast<const __m128i*>(key)));
+					acc1 = sse2HashLanes(acc1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16)),
+					                     _mm_loadu_si128(reinterpret_cast<const __m128i*>(key + 2)));
+				}
+				acc0 = sse2HashScramble(acc0, _mm_loadu_si128(reinterpret_cast<const __m128i*>(kHashScramble)));
+				acc1 = sse2HashScramble(acc1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(kHashScramble + 2)));
+			}
+
+			uint64_t acc[4];
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(acc), acc0);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(acc + 2), acc1);
+			return hashFinish(acc, rowBytes, rows);
+		}
+
+		const Kernels kSse2 = {
+			"sse2",
+			{ sse2Swap565, sse2Rgb888To565<false>, sse2Word565<8, 16, 24, false>, sse2Word565<16, 8, 0, false> },
+			{ sse2565To332, sse2Rgb888To332<false>, sse2Word332<8, 16, 24, false>, sse2Word332<16, 8, 0, false> },
+			{ sse2Swap565, sse2Rgb888To565<true>, sse2Word565<8, 16, 24, true>, sse2Word565<16, 8, 0, true> },
+			{ scalar565To332<true>, sse2Rgb888To332<true>, sse2Word332<8, 16, 24, true>, sse2Word332<16, 8, 0, true> },
+			sse2Hash,
+		};
+#endif
+
+#if defined(TFT_PIXEL_AVX2)
+		/*
+		 * AVX2 doubles the lanes and gets a byte shuffle, which spreads
+		 * RGB888 into lanes without scalar loads.  RGB332 output is half
+		 * the bytes and stays on the SSE2 kernels.
+		 */
+		template <bool Ordered>
+		TFT_AVX2 inline __m256i avx2Dither(__m256i c, __m256i d, int scale)
+		{
+			if (!Ordered)
+				return c;
+			return _mm256_add_epi32(_mm256_srli_epi32(_mm256_mullo_epi16(c, _mm256_set1_epi32(scale)), 8), d);
+		}
+
+		template <int RS, int GS, int BS, bool Ordered>
+		TFT_AVX2 inline __m128i avx2Lanes565(__m256i w, __m256i d)
+		{
+			const __m256i ff = _mm256_set1_epi32(0xFF);
+			__m256i r = avx2Dither<Ordered>(_mm256_and_si256(_mm256_srli_epi32(w, RS), ff), _mm256_and_si256(_mm256_srli_epi32(d, RS), ff), kScale5);
+			__m256i g = avx2Dither<Ordered>(_mm256_and_si256(_mm256_srli_epi32(w, GS), ff), _mm256_and_si256(_mm256_srli_epi32(d, GS), ff), kScale6);
+			__m256i b = avx2Dither<Ordered>(_mm256_and_si256(_mm256_srli_epi32(w, BS), ff), _mm256_and_si256(_mm256_srli_epi32(d, BS), ff), kScale5);
+
+			__m256i hi = _mm256_or_si256(_mm256_and_si256(r, _mm256_set1_epi32(0xF8)), _mm256_srli_epi32(g, 5));
+			__m256i lo = _mm256_or_si256(_mm256_and_si256(_mm256_slli_epi32(g, 11), _mm256_set1_epi32(0xE000)),
+			                             _mm256_and_si256(_mm256_slli_epi32(b, 5), _mm256_set1_epi32(0x1F00)));
+			__m256i v = _mm256_sub_epi32(_mm256_or_si256(hi, lo), _mm256_set1_epi32(0x8000));
+			__m128i p = _mm_packs_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+			return _mm_xor_si128(p, _mm_set1_epi16(short(0x8000)));
+		}
+
+		template <bool Ordered>
+		TFT_AVX2 inline __m256i avx2Bias(const uint8_t* bias)
+		{
+			return Ordered ? _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bias)) : _mm256_setzero_si256();
+		}
+
+		template <int RS, int GS, int BS, bool Ordered>
+		TFT_AVX2 void avx2Word565(const uint8_t* src, size_t count, uint8_t* out, const uint8_t* bias)
+		{
+			__m256i d = avx2Bias<Ordered>(bias);
+
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8, src += 32, out += 16)
+			{
+				__m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out), avx2Lanes565<RS, GS, BS, Ordered>(w, d));
+			}
+			scalar565<RS / 8, GS / 8, BS / 8, 4, Ordered>(src, count - i, out, bias);
+		}
+
+		// Each half loads 16 bytes for its 12, so the loop stops while two
+		// pixels are still left.
+		template <bool Ordered>
+		TFT_AVX2 void avx2Rgb888To565(const uint8_t* src, size_t count, uint8_t* out, const uint8_t* bias)
+		{
+			const __m256i spread = _mm256_setr_epi8(
+				0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+				0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+			__m256i d = avx2Bias<Ordered>(bias);
+
+			size_t i = 0;
+			for (; i + 10 <= count; i += 8, src += 24, out += 16)
+			{
+				__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+				__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 12));
+				__m256i w = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(a), b, 1), spread);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out), avx2Lanes565<0, 8, 16, Ordered>(w, d));
+			}
+			scalar565<0, 1, 2, 3, Ordered>(src, count - i, out, bias);
+		}
+
+		TFT_AVX2 void avx2Swap565(const uint8_t* src, size_t count, uint8_t* out, const uint8_t* bias)
+		{
+			size_t i = 0;
+			for (; i + 16 <= count; i += 16, src += 32, out += 32)
+			{
+				__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_or_si256(_mm256_slli_epi16(v, 8), _mm256_srli_epi16(v, 8)));
+			}
+			scalarSwap565(src, count - i, out, bias);
+		}
+
+		// The block hash with all four lanes in one register.
+		TFT_AVX2 uint64_t avx2Hash(const uint8_t* src, size_t rowBytes, size_t rows, size_t strideBytes)
+		{
+			const __m256i prime = _mm256_set1_epi32(int(kHashPrime));
+			const __m256i scramble = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kHashScramble));
+			__m256i acc = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kHashInit));
+			for (size_t row = 0; row < rows; ++row, src += strideBytes)
+			{
+				size_t i = 0, stripe = 0;
+				for (; i < rowBytes; i += 32, ++stripe)
+				{
+					const uint8_t* p = src + i;
+					uint8_t tail[32];
+					if (i + 32 > rowBytes)
+					{
+						memset(tail, 0, sizeof(tail));
+						memcpy(tail, p, rowBytes - i);
+						p = tail;
+					}
+					__m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+					__m256i dk = _mm256_xor_si256(d, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kHashKeys + (stripe & 7))));
+					__m256i product = _mm256_mul_epu32(dk, _mm256_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1)));
+					acc = _mm256_add_epi64(acc, _mm256_add_epi64(product, _mm256_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2))));
+				}
+				acc = _mm256_xor_si256(_mm256_xor_si256(acc, _mm256_srli_epi64(acc, 47)), scramble);
+				__m256i lo = _mm256_mul_epu32(acc, prime);
+				__m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(acc, 32), prime);
+				acc = _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32));
+			}
+
+			uint64_t lanes[4];
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+			return hashFinish(lanes, rowBytes, rows);
+		}
+
+		const Kernels kAvx2 = {
+			"avx2",
+			{ avx2Swap565, avx2Rgb888To565<false>, avx2Word565<8, 16, 24, false>, avx2Word565<16, 8, 0, false> },
+			{ sse2565To332, sse2Rgb888To332<false>, sse2Word332<8, 16, 24, false>, sse2Word332<16, 8, 0, false> },
+			{ avx2Swap565, avx2Rgb888To565<true>, avx2Word565<8, 16, 24, true>, avx2Word565<16, 8, 0, true> },
+			{ scalar565To332<true>, sse2Rgb888To332<true>, sse2Word332<8, 16, 24, true>, sse2Word332<16, 8, 0, true> },
+			avx2Hash,
+		};
+
+		bool hasAvx2()
+		{
+#if defined(__GNUC__)
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2");
+#else
+			int info[4];
+			__cpuid(info, 1);
+			bool osxsave = (info[2] & (1 << 27)) != 0;
+			bool avx = (info[2] & (1 << 28)) != 0;
+			if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+				return false;
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#endif
+		}
+#endif
+
+		const Kernels& selectKernels()
+		{
+#if defined(TFT_PIXEL_AVX2)
+			if (hasAvx2())
+				return kAvx2;
+#endif
+#if defined(TFT_PIXEL_SSE2)
+			return kSse2;
+#else
+			return kScalar;
+#endif
+		}
+
+		const Kernels& kernels()
+		{
+			static const Kernels& k = selectKernels();
+			return k;
+		}
+
+		const uint8_t kBayer[8][8] = {
+			{  0, 32,  8, 40,  2, 34, 10, 42 },
+			{ 48, 16, 56, 24, 50, 18, 58, 26 },
+			{ 12, 44,  4, 36, 14, 46,  6, 38 },
+			{ 60, 28, 52, 20, 62, 30, 54, 22 },
+			{  3, 35, 11, 43,  1, 33,  9, 41 },
+			{ 51, 19, 59, 27, 49, 17, 57, 25 },
+			{ 15, 47,  7, 39, 13, 45,  5, 37 },
+			{ 63, 31, 55, 23, 61, 29, 53, 21 },
+		};
+
+		// Channel offsets in a source pixel, and in the bias for RGB565.
+		void channelOffsets(TFT_PixelFormat format, int& r, int& g, int& b)
+		{
+			switch (format)
+			{
+			case PixelXRGB8888: r = 1; g = 2; b = 3; break;
+			case PixelBGRA8888: r = 2; g = 1; b = 0; break;
+			default:            r = 0; g = 1; b = 2; break;
+			}
+		}
+
+		/*
+		 * The 8 pixel bias for row 'y' from column 'x': threshold t of the
+		 * 8x8 Bayer matrix scaled to (t + 1/2) / 64 of the channel's output
+		 * step, so that truncation rounds up with the right probability.
+		 */
+		void orderedBias(TFT_PixelFormat format, bool rgb332, int x, int y, uint8_t bias[32])
+		{
+			int r, g, b;
+			channelOffsets(format, r, g, b);
+			const int stepR = rgb332 ? 32 : 8;
+			const int stepG = rgb332 ? 32 : 4;
+			const int stepB = rgb332 ? 64 : 8;
+
+			memset(bias, 0, 32);
+			for (int i = 0; i < 8; ++i)
+			{
+				int t = kBayer[y & 7][(x + i) & 7];
+				bias[i * 4 + r] = uint8_t((t * stepR + stepR / 2) / 64);
+				bias[i * 4 + g] = uint8_t((t * stepG + stepG / 2) / 64);
+				bias[i * 4 + b] = uint8_t((t * stepB + stepB / 2) / 64);
+			}
+		}
+	}
+
+	size_t pixelSize(TFT_PixelFormat format)
+	{
+		switch (format)
+		{
+		case PixelRGB565LE: return 2;
+		case PixelRGB888:   return 3;
+		default:            return 4;
+		}
+	}
+
+	void colorRegisters(uint16_t color, uint8_t bpp, uint8_t* rgb)
+	{
+		rgb[0] = uint8_t((color & 0xf800) >> 11);
+		rgb[1] = uint8_t((color & 0x07e0) >> 5);
+		rgb[2] = uint8_t(color & 0x001f);
+		if (bpp == 8)
+		{
+			rgb[0] >>= 2;
+			rgb[1] >>= 3;
+			rgb[2] >>= 3;
+		}
+	}
+
+	void convertToRGB565BE(TFT_PixelFormat format, const uint8_t* src, size_t count, uint8_t* out)
+	{
+		kernels().rgb565[format](src, count, out, nullptr);
+	}
+
+	void convertToRGB332(TFT_PixelFormat format, const uint8_t* src, size_t count, uint8_t* out)
+	{
+		kernels().rgb332[format](src, count, out, nullptr);
+	}
+
+	void ditherToRGB565BE(TFT_PixelFormat format, const uint8_t* src, size_t count, int x, int y, uint8_t* out)
+	{
+		uint8_t bias[32];
+		orderedBias(format, false, x, y, bias);
+		kernels().ordered565[format](src, count, out, bias);
+	}
+
+	void ditherToRGB332(TFT_PixelFormat format, const uint8_t* src, size_t count, int x, int y, uint8_t* out)
+	{
+		uint8_t bias[32];
+		orderedBias(format, true, x, y, bias);
+		kernels().ordered332[format](src, count, out, bias);
+	}
+
+	namespace
+	{
+		// Readers of 8 bit R, G, B for error diffusion.
+		template <int R, int G, int B, int Size>
+		struct BytesSource
+		{
+			static const size_t kSize = Size;
+			static void read(const uint8_t* p, int* c)
+			{
+				c[0] = p[R];
+				c[1] = p[G];
+				c[2] = p[B];
+			}
+		};
+
+		struct Rgb565Source
+		{
+			static const size_t kSize = 2;
+			static void read(const uint8_t* p, int* c)
+			{
+				unsigned v = p[0] | (p[1] << 8);
+				c[0] = ((v >> 8) & 0xF8) | (v >> 13);
+				c[1] = ((v >> 3) & 0xFC) | ((v >> 9) & 0x03);
+				c[2] = ((v << 3) & 0xF8) | ((v >> 2) & 0x07);
+			}
+		};
+	}
+
+	ErrorDiffusion::ErrorDiffusion()
+		: m_width(0)
+		, m_col(0)
+		, m_bpp(16)
+	{
+	}
+
+	void ErrorDiffusion::start(uint16_t width, uint8_t bpp)
+	{
+		m_width = width;
+		m_col = 0;
+		m_bpp = bpp;
+		m_errors.assign(size_t(width + 2) * 3 * 2, 0);
+	}
+
+	void ErrorDiffusion::convert(TFT_PixelFormat format, const uint8_t* src, size_t count, uint8_t* out)
+	{
+		switch (format)
+		{
+		case PixelRGB565LE: diffuse<Rgb565Source>(src, count, out); break;
+		case PixelRGB888:   diffuse<BytesSource<0, 1, 2, 3> >(src, count, out); break;
+		case PixelXRGB8888: diffuse<BytesSource<1, 2, 3, 4> >(src, count, out); break;
+		case PixelBGRA8888: diffuse<BytesSource<2, 1, 0, 4> >(src, count, out); break;
+		default: break;
+		}
+	}
+
+	/*
+	 * Each channel is rounded to the nearest output level and the error
+	 * spread 7/16 right, and 3/16, 5/16 and 1/16 below left, below and
+	 * below right.  Rows are scanned left to right only, since pixels go
+	 * to the display in that order.
+	 */
+	template <class Source>
+	void ErrorDiffusion::diffuse(const uint8_t* src, size_t count, uint8_t* out)
+	{
+		static const int kLevels565[3] = { 31, 63, 31 };
+		static const int kLevels332[3] = { 7, 7, 3 };
+		const int* levels = m_bpp == 8 ? kLevels332 : kLevels565;
+		const size_t rowLength = size_t(m_width + 2) * 3;
+
+		for (size_t i = 0; i < count; ++i, src += Source::kSize)
+		{
+			int* cur = &m_errors[size_t(m_col + 1) * 3];
+			int* next = cur + rowLength;
+
+			int c[3], q[3];
+			Source::read(src, c);
+			for (int k = 0; k < 3; ++k)
+			{
+				int v = c[k] + ((cur[k] + 8) >> 4);
+				v = v < 0 ? 0 : v > 255 ? 255 : v;
+				q[k] = (v * levels[k] + 127) / 255;
+				int err = v - (q[k] * 255 + levels[k] / 2) / levels[k];
+				cur[k + 3] += err * 7;
+				next[k - 3] += err * 3;
+				next[k] += err * 5;
+				next[k + 3] += err;
+			}
+
+			if (m_bpp == 8)
+			{
+				*out++ = uint8_t((q[0] << 5) | (q[1] << 2) | q[2]);
+			}
+			else
+			{
+				*out++ = uint8_t((q[0] << 3) | (q[1] >> 3));
+				*out++ = uint8_t(((q[1] & 0x07) << 5) | q[2]);
+			}
+
+			if (++m_col == m_width)
+			{
+				m_col = 0;
+				std::copy(m_errors.begin() + rowLength, m_errors.end(), m_errors.begin());
+				std::fill(m_errors.begin() + rowLength, m_errors.end(), 0);
+			}
+		}
+	}
+
+	uint64_t hashPixels(const uint8_t* src, size_t rowBytes, size_t rows, size_t strideBytes)
+	{
+		return kernels().hash(src, rowBytes, rows, strideBytes);
+	}
+
+	const char* pixelKernels()
+	{
+		return kernels().name;
+	}
+}
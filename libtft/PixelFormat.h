@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Source pixel layouts accepted by pushRect(), named by their byte order
+// in memory.
+enum TFT_PixelFormat
+{
+	PixelRGB565LE = 0,  // uint16_t RGB565, least significant byte first
+	PixelRGB888,        // R, G, B
+	PixelXRGB8888,      // X, R, G, B
+	PixelBGRA8888,      // B, G, R, A (a little endian 0xAARRGGBB word)
+	PixelFormatCount
+};
+
+// Dithering applied when uploads are reduced to the display's depth.
+enum TFT_Dither
+{
+	DitherNone = 0,
+	DitherOrdered,          // 8x8 Bayer matrix, vectorised with the conversion
+	DitherFloydSteinberg,   // error diffusion, one row of state
+};
+
+namespace hw
+{
+	size_t pixelSize(TFT_PixelFormat format);
+
+	// The R, G and B colour register values (BGCR, FGCR, BGTR) for an RGB565
+	// colour: 5/6/5 bits in 16bpp mode, 3/3/2 bits in 8bpp mode.
+	void colorRegisters(uint16_t color, uint8_t bpp, uint8_t* rgb);
+
+	///
+	/// Convert 'count' pixels to what the RA8875 takes as memory write data:
+	/// big endian RGB565 (2 bytes per pixel) in 16bpp mode, RGB332 (1 byte)
+	/// in 8bpp mode.  'out' may be unaligned, e.g. straight after a frame
+	/// header in the SPI buffer.
+	///
+	/// The kernels are picked once, from the CPU: AVX2, SSE2 or portable C.
+	///
+	void convertToRGB565BE(TFT_PixelFormat format, const uint8_t* src, size_t count, uint8_t* out);
+	void convertToRGB332(TFT_PixelFormat format, const uint8_t* src, size_t count, uint8_t* out);
+
+	// The same with ordered dithering; (x, y) is the display position of
+	// the first pixel, which picks its place in the Bayer matrix.
+	void ditherToRGB565BE(TFT_PixelFormat format, const uint8_t* src, size_t count, int x, int y, uint8_t* out);
+	void ditherToRGB332(TFT_PixelFormat format, const uint8_t* src, size_t count, int x, int y, uint8_t* out);
+
+	///
+	/// Floyd-Steinberg dithering of a block 'width' pixels wide, fed left
+	/// to right and top to bottom in runs of any length.  Only the errors
+	/// carried to the next row are kept, so state is O(width) and is
+	/// reused from one block to the next.
+	///
+	class ErrorDiffusion
+	{
+	public:
+		ErrorDiffusion();
+
+		// Start a block, with output of 16 (RGB565) or 8 (RGB332) bits.
+		void      start(uint16_t width, uint8_t bpp);
+		void      convert(TFT_PixelFormat format, const uint8_t* src, size_t count, uint8_t* out);
+
+	private:
+		template <class Source>
+		void      diffuse(const uint8_t* src, size_t count, uint8_t* out);
+
+	private:
+		// The current row, then the next, as R, G, B per pixel in 1/16
+		// units, with a pixel of margin at each end.
+		std::vector<int> m_errors;
+		uint16_t  m_width;
+		uint16_t  m_col;
+		uint8_t   m_bpp;
+	};
+
+	///
+	/// A fast, non-cryptographic 64-bit hash of 'rows' rows of 'rowBytes'
+	/// bytes, 'strideBytes' apart.  Every kernel gives the same value.
+	///
+	uint64_t hashPixels(const uint8_t* src, size_t rowBytes, size_t rows, size_t strideBytes);
+
+	// "avx2", "sse2" or "scalar".
+	const char* pixelKernels();
+}
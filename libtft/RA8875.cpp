@@ -3,7 +3,13 @@
 // https://github.com/adafruit/Adafruit_RA8875
 //
 #include "RA8875.h"
+#include "CommandStream.h"
+#include "RA8875Registers.h"
+#include "Timeline.h"
+#include <algorithm>
+#include <chrono>
 #include <thread>
+#include <stdio.h>
 #include <string.h>
 
 #include "Calibri20.c"
@@ -26,6 +32,21 @@
 #define RA8875_CMDWRITE         0x80
 #define RA8875_CMDREAD          0xC0
 
+// SPI clocks: reset and PLL setup run slow, afterwards writes may go up to
+// a third of the system clock and reads up to a sixth.
+#define RA8875_SPI_INIT_HZ      3000000
+#define RA8875_SPI_LIMIT_HZ     20000000
+
+// How long waitPoll() waits for the draw engine before giving up.
+#define RA8875_WAIT_TIMEOUT_MS  1000
+
+// Bytes on the wire to set up one flushFramebuffer() region: the memory
+// write window, the cursor, MRWC and restoring the window, as measured on
+// the emulator.
+#define RA8875_FLUSH_REGION_COST 400
+
+#define RA8875_XTAL_HZ          20000000
+
 // Registers & bits
 #define RA8875_PWRR             0x01
 #define RA8875_PWRR_DISPON      0x80
@@ -195,193 +216,137 @@
 #define RA8875_INTC2_TP         0x04
 #define RA8875_INTC2_BTE        0x02
 
-enum TFT_Register : uint8_t {
-	STSR = 0x00, // Status Register
-	PWRR = 0x01, // Power and Display Control Register (PWRR)
-	MRWC = 0x02, // Memory Read/Write Command (MRWC)
-	PCSR = 0x04, // Pixel Clock Setting Register (PCSR)
-	SROC = 0x05, // Serial Flash/ROM Configuration Register (SROC)
-	SFCLR = 0x06, // Serial Flash/ROM CLK Setting Register(SFCLR)
-	SYSR = 0x10, // System Configuration Register (SYSR)
-	GPI = 0x12, // GPI
-	GPO = 0x13, // GPO
-	HDWR = 0x14, // LCD Horizontal Display Width Register (HDWR)
-	HNDFTR = 0x15, // Horizontal Non-Display Period Fine Tuning Option Register (HNDFTR)
-	HNDR = 0x16, // LCD Horizontal Non-Display Period Register (HNDR)
-	HSTR = 0x17, // HSYNC Start Position Register (HSTR)
-	HPWR = 0x18, // HSYNC Pulse Width Register (HPWR)
-	VDHR0 = 0x19, // LCD Vertical Display Height Register (VDHR0)
-	VDHR1 = 0x1A, // LCD Vertical Display Height Register0 (VDHR1)
-	VNDR0 = 0x1B, // LCD Vertical Non-Display Period Register (VNDR0)
-	VNDR1 = 0x1C, // LCD Vertical Non-Display Period Register (VNDR1)
-	VSTR0 = 0x1D, // VSYNC Start Position Register (VSTR0)
-	VSTR1 = 0x1E, // VSYNC Start Position Register (VSTR1)
-	VPWR = 0x1F, // VSYNC Pulse Width Register (VPWR)
-	DPCR = 0x20, // Display Configuration Register (DPCR)
-	FNCR0 = 0x21, // Font Control Register 0 (FNCR0)
-	FNCR1 = 0x22, // Font Control Register 1 (FNCR1)
-	CGSR = 0x23, // CGRAM Select Register (CGSR)
-	HOFS0 = 0x24, // Horizontal Scroll Offset Register 0 (HOFS0)
-	HOFS1 = 0x25, // Horizontal Scroll Offset Register 1 (HOFS1)
-	VOFS0 = 0x26, // Vertical Scroll Offset Register 0 (VOFS0)
-	VOFS1 = 0x27, // Vertical Scroll Offset Register 1 (VOFS1)
-	FLDR = 0x29, // Font Line Distance Setting Register (FLDR)
-	F_CURXL = 0x2A, // Font Write Cursor Horizontal Position Register 0 (F_CURXL)
-	F_CURXH = 0x2B, // Font Write Cursor Horizontal Position Register 1 (F_CURXH)
-	F_CURYL = 0x2C, // Font Write Cursor Vertical Position Register 0 (F_CURYL)
-	F_CURYH = 0x2D, // Font Write Cursor Vertical Position Register 1 (F_CURYH)
-	F_TSET = 0x2E, // Font Write Type Setting Register
-	F_RSET = 0x2F, // Serial Font ROM Setting
-	HSAW0 = 0x30, // Horizontal Start Point 0 of Active Window (HSAW0)
-	HSAW1 = 0x31, // Horizontal Start Point 1 of Active Window (HSAW1)
-	VSAW0 = 0x32, // Vertical Start Point 0 of Active Window (VSAW0)
-	VSAW1 = 0x33, // Vertical Start Point 1 of Active Window (VSAW1)
-	HEAW0 = 0x34, // Horizontal End Point 0 of Active Window (HEAW0)
-	HEAW1 = 0x35, // Horizontal End Point 1 of Active Window (HEAW1)
-	VEAW0 = 0x36, // Vertical End Point of Active Window 0 (VEAW0)
-	VEAW1 = 0x37, // Vertical End Point of Active Window 1 (VEAW1)
-	HSSW0 = 0x38, // Horizontal Start Point 0 of Scroll Window (HSSW0)
-	HSSW1 = 0x39, // Horizontal Start Point 1 of Scroll Window (HSSW1)
-	VSSW0 = 0x3A, // Vertical Start Point 0 of Scroll Window (VSSW0)
-	VSSW1 = 0x3B, // Vertical Start Point 1 of Scroll Window (VSSW1)
-	HESW0 = 0x3C, // Horizontal End Point 0 of Scroll Window (HESW0)
-	HESW1 = 0x3D, // Horizontal End Point 1 of Scroll Window (HESW1)
-	VESW0 = 0x3E, // Vertical End Point 0 of Scroll Window (VESW0)
-	VESW1 = 0x3F, // Vertical End Point 1 of Scroll Window (VESW1)
-	MWCR0 = 0x40, // Memory Write Control Register 0 (MWCR0)
-	MWCR1 = 0x41, // Memory Write Control Register1 (MWCR1)
-	BTCR = 0x44, // Blink Time Control Register (BTCR)
-	MRCD = 0x45, // Memory Read Cursor Direction (MRCD)
-	CURH0 = 0x46, // Memory Write Cursor Horizontal Position Register 0 (CURH0)
-	CURH1 = 0x47, // Memory Write Cursor Horizontal Position Register 1 (CURH1)
-	CURV0 = 0x48, // Memory Write Cursor Vertical Position Register 0 (CURV0)
-	CURV1 = 0x49, // Memory Write Cursor Vertical Position Register 1 (CURV1)
-	RCURH0 = 0x4A, // Memory Read Cursor Horizontal Position Register 0 (RCURH0)
-	RCURH1 = 0x4B, // Memory Read Cursor Horizontal Position Register 1 (RCURH1)
-	RCURV0 = 0x4C, // Memory Read Cursor Vertical Position Register 0 (RCURV0)
-	RCURV1 = 0x4D, // Memory Read Cursor Vertical Position Register 1 (RCURV1)
-	CURHS = 0x4E, // Font Write Cursor and Memory Write Cursor Horizontal Size Register (CURHS)
-	CURVS = 0x4F, // Font Write Cursor Vertical Size Register (CURVS)
-	BECR0 = 0x50, // BTE Function Control Register 0 (BECR0)
-	BECR1 = 0x51, // BTE Function Control Register1 (BECR1)
-	LTPR0 = 0x52, // Layer Transparency Register0 (LTPR0)
-	LTPR1 = 0x53, // Layer Transparency Register1 (LTPR1)
-	HSBE0 = 0x54, // Horizontal Source Point 0 of BTE (HSBE0)
-	HSBE1 = 0x55, // Horizontal Source Point 1 of BTE (HSBE1)
-	VSBE0 = 0x56, // Vertical Source Point 0 of BTE (VSBE0)
-	VSBE1 = 0x57, // Vertical Source Point 1 of BTE (VSBE1)
-	HDBE0 = 0x58, // Horizontal Destination Point 0 of BTE (HDBE0)
-	HDBE1 = 0x59, // Horizontal Destination Point 1 of BTE (HDBE1)
-	VDBE0 = 0x5A, // Vertical Destination Point 0 of BTE (VDBE0)
-	VDBE1 = 0x5B, // Vertical Destination Point 1 of BTE (VDBE1)
-	BEWR0 = 0x5C, // BTE Width Register 0 (BEWR0)
-	BEWR1 = 0x5D, // BTE Width Register 1 (BEWR1)
-	BEHR0 = 0x5E, // BTE Height Register 0 (BEHR0)
-	BEHR1 = 0x5F, // BTE Height Register 1 (BEHR1)
-	BGCR0 = 0x60, // Background Color Register 0 (BGCR0)
-	BGCR1 = 0x61, // Background Color Register 1 (BGCR1)
-	BGCR2 = 0x62, // Background Color Register 2 (BGCR2)
-	FGCR0 = 0x63, // Foreground Color Register 0 (FGCR0)
-	FGCR1 = 0x64, // Foreground Color Register 1 (FGCR1)
-	FGCR2 = 0x65, // Foreground Color Register 2 (FGCR2)
-	PTNO = 0x66, // Pattern Set No for BTE (PTNO)
-	BGTR0 = 0x67, // Background Color Register for Transparent 0 (BGTR0)
-	BGTR1 = 0x68, // Background Color Register for Transparent 1 (BGTR1)
-	BGTR2 = 0x69, // Background Color Register for Transparent 2 (BGTR2)
-	TPCR0 = 0x70, // Touch Panel Control Register 0 (TPCR0)
-	TPCR1 = 0x71, // Touch Panel Control Register 1 (TPCR1)
-	TPXH = 0x72, // Touch Panel X High Byte Data Register (TPXH)
-	TPYH = 0x73, // Touch Panel Y High Byte Data Register (TPYH)
-	TPXYL = 0x74, // Touch Panel X/Y Low Byte Data Register (TPXYL)
-	GCHP0 = 0x80, // Graphic Cursor Horizontal Position Register 0 (GCHP0)
-	GCHP1 = 0x81, // Graphic Cursor Horizontal Position Register 1 (GCHP1)
-	GCVP0 = 0x82, // Graphic Cursor Vertical Position Register 0 (GCVP0)
-	GCVP1 = 0x83, // Graphic Cursor Vertical Position Register 1 (GCVP1)
-	GCC0 = 0x84, // Graphic Cursor Color 0 (GCC0)
-	GCC1 = 0x85, // Graphic Cursor Color 1 (GCC1)
-	PLLC1 = 0x88, // PLL Control Register 1 (PLLC1)
-	PLLC2 = 0x89, // PLL Control Register 2 (PLLC2)
-	P1CR = 0x8A, // PWM1 Control Register (P1CR)
-	P1DCR = 0x8B, // PWM1 Duty Cycle Register (P1DCR)
-	P2CR = 0x8C, // PWM2 Control Register (P2CR)
-	P2DCR = 0x8D, // PWM2 Control Register (P2DCR)
-	MCLR = 0x8E, // Memory Clear Control Register (MCLR)
-	DCR = 0x90, // Draw Line/Circle/Square Control Register (DCR)
-	DLHSR0 = 0x91, // Draw Line/Square Horizontal Start Address Register0 (DLHSR0)
-	DLHSR1 = 0x92, // Draw Line/Square Horizontal Start Address Register1 (DLHSR1)
-	DLVSR0 = 0x93, // Draw Line/Square Vertical Start Address Register0 (DLVSR0)
-	DLVSR1 = 0x94, // Draw Line/Square Vertical Start Address Register1 (DLVSR1)
-	DLHER0 = 0x95, // Draw Line/Square Horizontal End Address Register0 (DLHER0)
-	DLHER1 = 0x96, // Draw Line/Square Horizontal End Address Register1 (DLHER1)
-	DLVER0 = 0x97, // Draw Line/Square Vertical End Address Register0 (DLVER0)
-	DLVER1 = 0x98, // Draw Line/Square Vertical End Address Register1 (DLVER1)
-	DCHR0 = 0x99, // Draw Circle Center Horizontal Address Register0 (DCHR0)
-	DCHR1 = 0x9A, // Draw Circle Center Horizontal Address Register1 (DCHR1)
-	DCVR0 = 0x9B, // Draw Circle Center Vertical Address Register0 (DCVR0)
-	DCVR1 = 0x9C, // Draw Circle Center Vertical Address Register1 (DCVR1)
-	DCRR = 0x9D, // Draw Circle Radius Register (DCRR)
-	ELLIPSE = 0xA0, // Draw Ellipse/Ellipse Curve/Circle Square Control Register
-	ELL_A0 = 0xA1, // Draw Ellipse/Circle Square Long axis Setting Register (ELL_A0)
-	ELL_A1 = 0xA2, // Draw Ellipse/Circle Square Long axis Setting Register (ELL_A1)
-	ELL_B0 = 0xA3, // Draw Ellipse/Circle Square Short axis Setting Register (ELL_B0)
-	ELL_B1 = 0xA4, // Draw Ellipse/Circle Square Short axis Setting Register (ELL_B1)
-	DEHR0 = 0xA5, // Draw Ellipse/Circle Square Center Horizontal Address Register0 (DEHR0)
-	DEHR1 = 0xA6, // Draw Ellipse/Circle Square Center Horizontal Address Register1 (DEHR1)
-	DEVR0 = 0xA7, // Draw Ellipse/Circle Square Center Vertical Address Register0 (DEVR0)
-	DEVR1 = 0xA8, // Draw Ellipse/Circle Square Center Vertical Address Register1 (DEVR1)
-	DTPH0 = 0xA9, // Draw Triangle Point 2 Horizontal Address Register0 (DTPH0)
-	DTPH1 = 0xAA, // Draw Triangle Point 2 Horizontal Address Register1 (DTPH1)
-	DTPV0 = 0xAB, // Draw Triangle Point 2 Vertical Address Register0 (DTPV0)
-	DTPV1 = 0xAC, // Draw Triangle Point 2 Vertical Address Register1 (DTPV1)
-	SSAR0 = 0xB0, // Source Starting Address REG0 (SSAR0)
-	SSAR1 = 0xB1, // Source Starting Address REG 1 (SSAR1)
-	SSAR2 = 0xB2, // Source Starting Address REG 2 (SSAR2)
-	BWR0 = 0xB4, // Block Width REG 0(BWR0) / DMA Transfer Number REG 0 (DTNR0)
-	BWR1 = 0xB5, // Block Width REG 1 (BWR1)
-	BHR0 = 0xB6, // Block Height REG 0(BHR0) /DMA Transfer Number REG 1 (DTNR1)
-	BHR1 = 0xB7, // Block Height REG 1 (BHR1)
-	SPWR0 = 0xB8, // Source Picture Width REG 0(SPWR0) / DMA Transfer Number REG 2(DTNR2)
-	SPWR1 = 0xB9, // Source Picture Width REG 1 (SPWR1)
-	DMACR = 0xBF, // DMA Configuration REG (DMACR)
-	KSCR1 = 0xC0, // Key-Scan Control Register 1 (KSCR1)
-	KSCR2 = 0xC1, // Key-Scan Controller Register 2 (KSCR2)
-	KSDR0 = 0xC2, // Key-Scan Data Register (KSDR0)
-	KSDR1 = 0xC3, // Key-Scan Data Register (KSDR1)
-	KSDR2 = 0xC4, // Key-Scan Data Register (KSDR2)
-	GPIOX = 0xC7, // Extra General Purpose IO Register (GPIOX)
-	FWSAXA0 = 0xD0, // Floating Windows Start Address XA 0 (FWSAXA0)
-	FWSAXA1 = 0xD1, // Floating Windows Start Address XA 1 (FWSAXA1)
-	FWSAYA0 = 0xD2, // Floating Windows Start Address YA 0 (FWSAYA0)
-	FWSAYA1 = 0xD3, // Floating Windows Start Address YA 1 (FWSAYA1)
-	FWW0 = 0xD4, // Floating Windows Width 0 (FWW0)
-	FWW1 = 0xD5, // Floating Windows Width 1 (FWW1)
-	FWH0 = 0xD6, // Floating Windows Height 0 (FWH0)
-	FWH1 = 0xD7, // Floating Windows Height 1 (FWH1)
-	FWDXA0_ = 0xD8, // Floating Windows Display X Address 0 (FWDXA0)
-	FWDXA1_ = 0xD9, // Floating Windows Display X Address 1 (FWDXA1)
-	FWDYA0_ = 0xDA, // Floating Windows Display Y Address 0 (FWDYA0)
-	FWDYA1_ = 0xDB, // Floating Windows Display Y Address 1 (FWDYA1)
-	SACS_MODE = 0xE0, // Serial Flash/ROM Direct Access Mode
-	SACS_ADDR = 0xE1, // Serial Flash/ROM Direct Access Mode Address
-	SACS_DATA = 0xE2, // Serial Flash/ROM Direct Access Data Read
-	INTC1 = 0xF0, // Interrupt Control Register1 (INTC1)
-	INTC2 = 0xF1, // Interrupt Control Register2 (INTC2)
-};
 
 
 namespace hw
 {
 	// All Registers.
 	
+	/*
+	 * Registers that only describe the next draw operation and can be
+	 * programmed while the engine is still busy with the previous one.
+	 */
+	static bool isDrawSetup(uint8_t reg)
+	{
+		return (reg >= TFT_Register::DLHSR0 && reg <= TFT_Register::DCRR)
+			|| (reg >= TFT_Register::ELL_A0 && reg <= TFT_Register::DTPV1);
+	}
+
+	/*
+	 * Registers whose value can't be cached: read-only, self-clearing,
+	 * write-one-to-clear, or advanced by the chip itself.
+	 */
+	static bool isShadowable(uint8_t reg)
+	{
+		switch (reg)
+		{
+		case TFT_Register::STSR:
+		case TFT_Register::MRWC:
+		case TFT_Register::GPI:
+		case TFT_Register::F_CURXL:
+		case TFT_Register::F_CURXH:
+		case TFT_Register::F_CURYL:
+		case TFT_Register::F_CURYH:
+		case TFT_Register::CURH0:
+		case TFT_Register::CURH1:
+		case TFT_Register::CURV0:
+		case TFT_Register::CURV1:
+		case TFT_Register::RCURH0:
+		case TFT_Register::RCURH1:
+		case TFT_Register::RCURV0:
+		case TFT_Register::RCURV1:
+		case TFT_Register::BECR0:
+		case TFT_Register::TPXH:
+		case TFT_Register::TPYH:
+		case TFT_Register::TPXYL:
+		case TFT_Register::MCLR:
+		case TFT_Register::DCR:
+		case TFT_Register::ELLIPSE:
+		case TFT_Register::DMACR:
+		case TFT_Register::KSDR0:
+		case TFT_Register::KSDR1:
+		case TFT_Register::KSDR2:
+		case TFT_Register::SACS_MODE:
+		case TFT_Register::SACS_ADDR:
+		case TFT_Register::SACS_DATA:
+		case TFT_Register::INTC2:
+			return false;
+		default:
+			return true;
+		}
+	}
+
+
+	static const char* kPrimitiveNames[TFT_PRIM_COUNT] = {
+		"drawPixel", "drawPixels", "drawLine", "drawRect", "fillRect",
+		"drawCircle", "fillCircle", "drawTriangle", "fillTriangle",
+		"drawEllipse", "fillEllipse", "drawCurve", "fillCurve", "textWrite",
+		"pushRect", "presentFrame",
+	};
+
+	/*
+	 * Adds the time until it goes out of scope to a primitive's latency
+	 * histogram, and a span to the active timeline.  Only the outermost
+	 * primitive is counted, and nothing while capturing.
+	 */
+	class PrimitiveTimer
+	{
+	public:
+		PrimitiveTimer(const RA8875* tft, TFT_Primitive prim)
+			: m_tft(tft)
+			, m_prim(prim)
+			, m_counted(!tft->m_capturing && tft->m_primitiveDepth == 0)
+			, m_start(std::chrono::steady_clock::now())
+			, m_scope("api", kPrimitiveNames[prim])
+		{
+			tft->m_primitiveDepth++;
+		}
+
+		~PrimitiveTimer()
+		{
+			m_tft->m_primitiveDepth--;
+			if (!m_counted)
+				return;
+
+			using namespace std::chrono;
+			uint64_t us = duration_cast<microseconds>(steady_clock::now() - m_start).count();
+
+			size_t bucket = 0;
+			while (bucket + 1 < TFT_LATENCY_BUCKETS && us >= (uint64_t(1) << bucket))
+				++bucket;
+
+			TFT_Stats& stats = m_tft->m_stats;
+			stats.primitiveCalls[m_prim]++;
+			stats.primitiveMicros[m_prim] += us;
+			stats.latency[m_prim][bucket]++;
+		}
+
+	private:
+		const RA8875* m_tft;
+		TFT_Primitive m_prim;
+		bool          m_counted;
+		std::chrono::steady_clock::time_point m_start;
+		TimelineScope m_scope;
+	};
 
 	RA8875::RA8875(IDevice& device, Pin cs, Pin rst, Pin wait, Pin interrupt)
 		: m_device(&device)
-		, m_spi(device, cs, 3000000, 0, false)
+		, m_spi(device, cs, RA8875_SPI_INIT_HZ, 0, false)
 		, m_rst(rst)
 		, m_wait(wait)
 		, m_interrupt(interrupt)
+		, m_hardwareWait(false)
+		, m_pipelined(false)
+		, m_spiClockLimit(RA8875_SPI_LIMIT_HZ)
+		, m_capturing(false)
+		, m_recording(nullptr)
+		, m_enginePending(false)
+		, m_pendingReg(TFT_Register::DCR)
+		, m_pendingFlag(0)
 		, m_width(0)
 		, m_height(0)
+		, m_colorDepth(16)
+		, m_dither(DitherNone)
 		, m_brightness(255)
 		, m_cursorX(0)
 		, m_cursorY(0)
@@ -396,7 +361,17 @@ namespace hw
 		, m_FNTbaselineLow(0)
 		, m_FNTbaselineTop(0)
 		, m_size(_800x480)
-	{
+		, m_selected(0)
+		, m_shadowWrites(0)
+		, m_shadowVerify(0)
+		, m_captureSelected(0)
+		, m_primitiveDepth(0)
+		, m_splitCount(0)
+		, m_syncReading(false)
+	{
+		memset(m_shadow, 0, sizeof(m_shadow));
+		memset(m_captureShadow, 0, sizeof(m_captureShadow));
+		memset(&m_stats, 0, sizeof(m_stats));
 		m_device->setPinDirection(m_rst, Direction::Out);
 		m_device->setPinDirection(m_wait, Direction::In);
 		m_device->setPinDirection(m_interrupt, Direction::In);
@@ -408,6 +383,7 @@ namespace hw
 
 	bool RA8875::begin(TFT_DisplaySize s)
 	{
+		TFT_TIMELINE_SCOPE("api", "begin");
 		m_size = s;
 		if (m_size == _480x272)
 		{
@@ -424,10 +400,20 @@ namespace hw
 			return false;
 		}
 
+		m_colorDepth = 16;
+		m_tiles.reset(m_width, m_height);
+		// A framebuffer turned on before begin() is sized now.
+		if (m_framebuffer && (m_framebuffer->width() != m_width || m_framebuffer->height() != m_height))
+		{
+			m_framebuffer.reset(new Framebuffer(m_width, m_height));
+			m_framebuffer->fill(RA8875_BLACK);
+		}
+		m_spi.setClock(RA8875_SPI_INIT_HZ);
 		m_device->setLow(m_rst);
 		delay(100);
 		m_device->setHigh(m_rst);
 		delay(100);
+		invalidateShadow();
 
 		uint8_t x = readRegister8(TFT_Register::STSR);
 		printf("RA8875: 0x%02x\n", x);
@@ -443,6 +429,7 @@ namespace hw
 		_setFNTdimensions(0);
 		
 		initialize();
+		_boostSpiClock();
 		return true;
 	}
 
@@ -452,6 +439,7 @@ namespace hw
 		writeData(RA8875_PWRR_SOFTRESET);
 		writeData(RA8875_PWRR_NORMAL);
 		delay(1);
+		invalidateShadow();
 	}
 
 	void RA8875::displayOn(bool on) const
@@ -523,16 +511,14 @@ namespace hw
 	void RA8875::textMode() const
 	{
 		/* Set text mode */
-		writeCommand(RA8875_MWCR0);
-		uint8_t temp = readData();
+		uint8_t temp = readCached(TFT_Register::MWCR0);
 		temp |= RA8875_MWCR0_TXTMODE; // Set bit 7
-		writeData(temp);
+		setRegister8(TFT_Register::MWCR0, temp);
 
 		/* Select the internal (ROM) font */
-		writeCommand(0x21);
-		temp = readData();
+		temp = readCached(TFT_Register::FNCR0);
 		temp &= ~((1 << 7) | (1 << 5)); // Clear bits 7 and 5
-		writeData(temp);
+		setRegister8(TFT_Register::FNCR0, temp);
 	}
 
 	void RA8875::textSetCursor(uint16_t x, uint16_t y)
@@ -553,9 +539,9 @@ namespace hw
 		setColorRegister(TFT_Register::BGCR0, bgColor);
 
 		/* Clear transparency flag */
-		uint8_t temp = readRegister8(TFT_Register::FNCR1);
+		uint8_t temp = readCached(TFT_Register::FNCR1);
 		temp &= ~(1 << 6); // Clear bit 6
-		writeData(temp);
+		setRegister8(TFT_Register::FNCR1, temp);
 	}
 
 	void RA8875::textTransparent(uint16_t foreColor)
@@ -564,9 +550,9 @@ namespace hw
 		setColorRegister(TFT_Register::FGCR0, foreColor);
 
 		/* Set transparency flag */
-		uint8_t temp = readRegister8(TFT_Register::FNCR1);
+		uint8_t temp = readCached(TFT_Register::FNCR1);
 		temp |= (1 << 6); // Set bit 6
-		writeData(temp);
+		setRegister8(TFT_Register::FNCR1, temp);
 	}
 
 	void RA8875::textEnlarge(uint8_t scale)
@@ -590,11 +576,11 @@ namespace hw
 		if (!m_renderFonts){
 			xscale = xscale % 4; //limit to the range 0-3
 			yscale = yscale % 4; //limit to the range 0-3
-			uint8_t _FNCR1_Reg = readRegister8(TFT_Register::FNCR1);
+			uint8_t _FNCR1_Reg = readCached(TFT_Register::FNCR1);
 			_FNCR1_Reg &= ~(0xF); // clear bits from 0 to 3
 			_FNCR1_Reg |= xscale << 2;
 			_FNCR1_Reg |= yscale;
-			writeData(_FNCR1_Reg);
+			setRegister8(TFT_Register::FNCR1, _FNCR1_Reg);
 			//_writeRegister(RA8875_FNCR1,_FNCR1_Reg);
 		}
 		m_scaleX = xscale + 1;
@@ -605,6 +591,7 @@ namespace hw
 	
 	void RA8875::textWrite(const char* buffer)
 	{
+		PrimitiveTimer timer(this, TFT_PRIM_TEXT);
 		if (buffer != nullptr)
 		{
 			_textWrite(buffer, 0);
@@ -794,6 +781,7 @@ namespace hw
 	/**************************************************************************/
 	void RA8875::_charWrite(const char c,uint8_t offset)
 	{
+		TFT_TIMELINE_SCOPE("text", "_charWrite", "char", c);
 		bool dtacmd = false;
 		if (c == 13){//'\r'
 			//Ignore carriage-return
@@ -811,7 +799,7 @@ namespace hw
 				writeCommand(RA8875_MRWC);
 			}
 			writeData(c);
-			waitBusy(0x80);
+			if (!gateOnWaitPin()) waitBusy(0x80);
 			//update cursor
 			m_cursorX += m_FNTwidth;
 		}
@@ -865,6 +853,7 @@ namespace hw
 	/**************************************************************************/
 	void RA8875::_drawChar_unc(int16_t x,int16_t y,int charW,int index,uint16_t fcolor)
 	{
+		TFT_TIMELINE_SCOPE("text", "_drawChar_unc", "index", index);
 		//start by getting some glyph data...
 		const uint8_t * charGlyp = m_currentFont->chars[index].image->data;
 		int			  totalBytes = m_currentFont->chars[index].image->image_datalen;
@@ -915,6 +904,7 @@ namespace hw
 	/**************************************************************************/
 	void RA8875::_charLineRender(bool lineBuffer[],int charW,int16_t x,int16_t y,int16_t currentYposition,uint16_t fcolor)
 	{
+		TFT_TIMELINE_SCOPE("text", "_charLineRender", "line", currentYposition);
 		int xlinePos = 0;
 		int px;
 		uint8_t endPix = 0;
@@ -942,10 +932,9 @@ namespace hw
 	
 	void RA8875::graphicsMode() const
 	{
-		writeCommand(RA8875_MWCR0);
-		uint8_t temp = readData();
+		uint8_t temp = readCached(TFT_Register::MWCR0);
 		temp &= ~RA8875_MWCR0_TXTMODE; // bit #7
-		writeData(temp);
+		setRegister8(TFT_Register::MWCR0, temp);
 	}
 
 	void RA8875::setXY(uint16_t x, uint16_t y) const
@@ -954,6 +943,23 @@ namespace hw
 		setRegister16(TFT_Register::CURV0, y);
 	}
 
+	/*
+	 * 16 (RGB565, the default) or 8 (RGB332) bits per pixel.  8bpp halves
+	 * the bytes of every memory write; pixel uploads and the color
+	 * registers follow the mode, callers keep passing RGB565 colors.
+	 */
+	void RA8875::setColorDepth(uint8_t bpp)
+	{
+		if (bpp != 8 && bpp != 16)
+		{
+			fprintf(stderr, "Unsupported color depth %d\n", bpp);
+			return;
+		}
+		m_colorDepth = bpp;
+		m_tiles.invalidate();
+		setRegister8(TFT_Register::SYSR, uint8_t((bpp == 8 ? RA8875_SYSR_8BPP : RA8875_SYSR_16BPP) | RA8875_SYSR_MCU8));
+	}
+
 	/*
 	void RA8875::fillRect() const
 	{
@@ -965,43 +971,332 @@ namespace hw
 
 	void RA8875::fillScreen(uint16_t color) const
 	{
+		TFT_TIMELINE_SCOPE("api", "fillScreen");
 		rectHelper(0, 0, m_width - 1, m_height - 1, color, true);
 	}
 
 	void RA8875::drawPixel(int16_t x, int16_t y, uint16_t color) const
 	{
+		PrimitiveTimer timer(this, TFT_PRIM_PIXEL);
+		if (m_framebuffer)
+		{
+			m_framebuffer->drawPixel(x, y, color);
+			return;
+		}
 		graphicsMode();
 		setXY(x,y);
 		writeCommand(RA8875_MRWC);
 		uint8_t data[] = { RA8875_DATAWRITE, uint8_t(color >> 8), uint8_t(color & 0xFF) };
-		m_spi.write(data, 3);
+		if (m_colorDepth == 8)
+			data[1] = uint8_t(((color >> 8) & 0xE0) | ((color >> 6) & 0x1C) | ((color >> 3) & 0x03));
+		size_t bytes = m_colorDepth / 8;
+		m_spi.write(data, uint16_t(1 + bytes));
+		if (!m_capturing)
+			m_stats.memoryBytes += bytes;
 	}
 	
 	void RA8875::drawPixels(uint16_t p[], uint16_t count, int16_t x, int16_t y) const
 	{
-		uint16_t temp = 0;
-		uint16_t i;
+		PrimitiveTimer timer(this, TFT_PRIM_PIXELS);
+		if (m_framebuffer)
+		{
+			// Rows wrap at the screen edge, as memory writes do.
+			for (uint16_t i = 0; i < count && y < m_height; y++)
+			{
+				uint16_t n = uint16_t(std::min<int>(count - i, m_width - x));
+				blitRect(x, y, n, 1, PixelRGB565LE, reinterpret_cast<const uint8_t*>(p + i), size_t(n) * 2);
+				i = uint16_t(i + n);
+				x = 0;
+			}
+			return;
+		}
 		graphicsMode();
 		setXY(x,y);
 		writeCommand(RA8875_MRWC);
+		streamPixels(PixelRGB565LE, reinterpret_cast<const uint8_t*>(p), x, y, count, 1, size_t(count) * 2);
+	}
 
-		uint8_t* data = new uint8_t[(count * 2) + 1];
-		
-		data[0] = RA8875_DATAWRITE;
-		
-		for (i=0;i<count;i++){
-			temp = p[i];
-			data[(i * 2) + 1] = uint8_t(temp >> 8);
-			data[(i * 2) + 2] = uint8_t(temp & 0xFF);
+	/*
+	 * Upload a w x h block of pixels to (x, y), clipped to the screen.  The
+	 * active window is narrowed to the block so memory writes wrap at its
+	 * right edge, and restored afterwards.  'stride' is the distance between
+	 * source rows in pixels, 0 for w.  Any size works in a single call.
+	 */
+	void RA8875::pushRect(int16_t x, int16_t y, uint16_t w, uint16_t h, const uint16_t* pixels, size_t stride)
+	{
+		pushRect(x, y, w, h, PixelRGB565LE, pixels, stride * 2);
+	}
+
+	/*
+	 * pushRect() from a renderer's own pixel format, converted on the way
+	 * into the SPI buffer.  'strideBytes' is the distance between source
+	 * rows in bytes, 0 for packed rows.
+	 */
+	void RA8875::pushRect(int16_t x, int16_t y, uint16_t w, uint16_t h, TFT_PixelFormat format, const void* data, size_t strideBytes)
+	{
+		// The format indexes the conversion kernels; it may come unchecked
+		// from the C API.
+		if (unsigned(format) >= unsigned(PixelFormatCount))
+		{
+			fprintf(stderr, "RA8875: unknown pixel format %d\n", int(format));
+			return;
+		}
+
+		PrimitiveTimer timer(this, TFT_PRIM_PUSH_RECT);
+		const uint8_t* pixels = static_cast<const uint8_t*>(data);
+		if (strideBytes == 0)
+			strideBytes = w * pixelSize(format);
+
+		if (m_framebuffer)
+			blitRect(x, y, w, h, format, pixels, strideBytes);
+		else
+			uploadRect(x, y, w, h, format, pixels, strideBytes);
+	}
+
+	void RA8875::uploadRect(int16_t x, int16_t y, uint16_t w, uint16_t h, TFT_PixelFormat format, const uint8_t* pixels, size_t strideBytes) const
+	{
+		const size_t size = pixelSize(format);
+		int x0 = x, y0 = y;
+		int x1 = x + int(w) - 1, y1 = y + int(h) - 1;
+		if (x0 < 0)
+		{
+			pixels += size_t(-x0) * size;
+			x0 = 0;
+		}
+		if (y0 < 0)
+		{
+			pixels += size_t(-y0) * strideBytes;
+			y0 = 0;
+		}
+		if (x1 >= m_width)
+			x1 = m_width - 1;
+		if (y1 >= m_height)
+			y1 = m_height - 1;
+		if (x0 > x1 || y0 > y1)
+			return;
+
+		graphicsMode();
+		setRegister16(TFT_Register::HSAW0, uint16_t(x0));
+		setRegister16(TFT_Register::HEAW0, uint16_t(x1));
+		setRegister16(TFT_Register::VSAW0, uint16_t(y0));
+		setRegister16(TFT_Register::VEAW0, uint16_t(y1));
+		setXY(uint16_t(x0), uint16_t(y0));
+		writeCommand(RA8875_MRWC);
+
+		streamPixels(format, pixels, int16_t(x0), int16_t(y0), uint16_t(x1 - x0 + 1), uint16_t(y1 - y0 + 1), strideBytes);
+
+		bool full = m_activeWindowXL == 0 && m_activeWindowYT == 0
+			&& m_activeWindowXR >= m_width - 1 && m_activeWindowYB >= m_height - 1;
+		_updateActiveWindow(full);
+	}
+
+	/*
+	 * pushRect() into the framebuffer.  Pixels are converted to RGB565 and
+	 * stored in host order.  They are dithered only at 16bpp: at 8bpp
+	 * flushFramebuffer() dithers them down to RGB332, and dithering twice
+	 * adds the noise of both passes.
+	 */
+	void RA8875::blitRect(int16_t x, int16_t y, uint16_t w, uint16_t h, TFT_PixelFormat format, const uint8_t* pixels, size_t strideBytes) const
+	{
+		const size_t size = pixelSize(format);
+		int x0 = std::max<int>(x, 0);
+		int x1 = std::min<int>(x + int(w), m_width) - 1;
+		if (x0 > x1)
+			return;
+		pixels += size_t(x0 - x) * size;
+
+		const int count = x1 - x0 + 1;
+		TFT_Dither dither = format == PixelRGB565LE || m_colorDepth == 8 ? DitherNone : m_dither;
+		if (dither == DitherFloydSteinberg)
+			m_diffusion.start(uint16_t(count), 16);
+
+		for (int row = y; row < y + int(h); ++row, pixels += strideBytes)
+		{
+			if (row < 0 || row >= m_height)
+				continue;
+
+			uint16_t* dst = m_framebuffer->canvas().data() + size_t(row) * m_width + x0;
+			uint8_t* out = reinterpret_cast<uint8_t*>(dst);
+			convertPixels(dither, format, pixels, count, x0, row, 16, out);
+
+			// Big endian from the converters; the canvas is host order.
+			for (int i = 0; i < count; ++i)
+				dst[i] = uint16_t((out[i * 2] << 8) | out[i * 2 + 1]);
+		}
+
+		m_framebuffer->markDirty(x0, y, x1, y + int(h) - 1);
+	}
+
+	/*
+	 * Keep a host copy of display memory.  While on, drawing calls change
+	 * only that copy and flushFramebuffer() uploads what changed.  Text
+	 * still goes straight to the controller's font engine, so draw it
+	 * after a flush.
+	 * The copy starts black and fully dirty.  Turned on before begin(), it
+	 * is sized once begin() knows the display.
+	 */
+	void RA8875::setFramebuffer(bool on)
+	{
+		if (!on)
+		{
+			m_framebuffer.reset();
+			return;
+		}
+		if (!m_framebuffer)
+			m_framebuffer.reset(new Framebuffer(m_width, m_height));
+		m_framebuffer->fill(RA8875_BLACK);
+	}
+
+	/*
+	 * Upload the regions drawn since the last flush, each through a memory
+	 * write window of its own.  Returns the number of regions.
+	 */
+	size_t RA8875::flushFramebuffer()
+	{
+		if (!m_framebuffer)
+			return 0;
+
+		TFT_TIMELINE_SCOPE("api", "flushFramebuffer");
+		m_framebuffer->takeDirty(m_flushRegions, m_colorDepth / 8, RA8875_FLUSH_REGION_COST);
+
+		const Canvas& canvas = m_framebuffer->canvas();
+		const size_t stride = size_t(canvas.width()) * 2;
+		for (size_t i = 0; i < m_flushRegions.size(); ++i)
+		{
+			const Framebuffer::Rect& r = m_flushRegions[i];
+			const uint16_t* first = canvas.data() + size_t(r.y0) * canvas.width() + r.x0;
+			uploadRect(int16_t(r.x0), int16_t(r.y0), uint16_t(r.x1 - r.x0 + 1), uint16_t(r.y1 - r.y0 + 1),
+				PixelRGB565LE, reinterpret_cast<const uint8_t*>(first), stride);
+		}
+		return m_flushRegions.size();
+	}
+
+	/*
+	 * Show a complete frame from a producer that redraws everything, e.g.
+	 * an offscreen renderer or a mirrored desktop.  The frame is hashed in
+	 * tiles of 32x16 and only the tiles whose hash changed since the last
+	 * frame are uploaded, joined into as few windowed writes as pays.
+	 * 'stride' is in pixels, 0 for packed rows.  Anything drawn by other
+	 * means is not seen, so call invalidateFrame() after it.  With the
+	 * framebuffer on, changed tiles go through it and are flushed along
+	 * with whatever else is dirty.  Returns the number of regions uploaded.
+	 */
+	size_t RA8875::presentFrame(const uint16_t* pixels, size_t stride)
+	{
+		PrimitiveTimer timer(this, TFT_PRIM_PRESENT_FRAME);
+		const size_t strideBytes = (stride ? stride : m_width) * 2;
+
+		size_t tiles = m_tiles.diff(pixels, strideBytes, m_frameRegions);
+		if (tiles == 0)
+			return m_framebuffer ? flushFramebuffer() : 0;
+		Framebuffer::coalesce(m_frameRegions, m_colorDepth / 8, RA8875_FLUSH_REGION_COST);
+
+		const uint8_t* base = reinterpret_cast<const uint8_t*>(pixels);
+		for (size_t i = 0; i < m_frameRegions.size(); ++i)
+		{
+			const Framebuffer::Rect& r = m_frameRegions[i];
+			const uint8_t* first = base + size_t(r.y0) * strideBytes + size_t(r.x0) * 2;
+			const uint16_t w = uint16_t(r.x1 - r.x0 + 1), h = uint16_t(r.y1 - r.y0 + 1);
+			if (m_framebuffer)
+				blitRect(int16_t(r.x0), int16_t(r.y0), w, h, PixelRGB565LE, first, strideBytes);
+			else
+				uploadRect(int16_t(r.x0), int16_t(r.y0), w, h, PixelRGB565LE, first, strideBytes);
+		}
+		if (m_framebuffer)
+			return flushFramebuffer();
+		return m_frameRegions.size();
+	}
+
+	/*
+	 * Write pixels to the selected MRWC, row by row with 'strideBytes'
+	 * between source rows; (x, y) is where the block starts on screen.
+	 * Frames are built in place in the SPI scratch buffer, each as large
+	 * as one SPI frame allows, and the pixels are converted (and dithered,
+	 * see setDither()) to the display's format straight into them, so
+	 * nothing is allocated and nothing is copied twice.
+	 */
+	void RA8875::streamPixels(TFT_PixelFormat format, const uint8_t* pixels, int16_t x, int16_t y, uint16_t w, uint16_t h, size_t strideBytes) const
+	{
+		const size_t inSize = pixelSize(format);
+		const size_t outSize = m_colorDepth / 8;
+		// A data write prefix and whole pixels.
+		const size_t framePixels = (SPI::kMaxFrame - 1) / outSize;
+
+		// RGB565 sources lose nothing at 16bpp.
+		TFT_Dither dither = m_dither;
+		if (format == PixelRGB565LE && outSize == 2)
+			dither = DitherNone;
+		if (dither == DitherFloydSteinberg)
+			m_diffusion.start(w, m_colorDepth);
+
+		size_t left = size_t(w) * h;
+		const uint8_t* row = pixels;
+		uint16_t col = 0;
+		int line = y;
+
+		while (left > 0)
+		{
+			size_t n = left < framePixels ? left : framePixels;
+			uint8_t* out = m_spi.queueWriteInPlace(uint16_t(1 + n * outSize));
+			*out++ = RA8875_DATAWRITE;
+
+			for (size_t done = 0; done < n; )
+			{
+				size_t run = w - col;
+				if (run > n - done)
+					run = n - done;
+
+				convertPixels(dither, format, row + col * inSize, run, x + col, line, m_colorDepth, out);
+
+				out += run * outSize;
+				done += run;
+				col = uint16_t(col + run);
+				if (col == w)
+				{
+					col = 0;
+					row += strideBytes;
+					line++;
+				}
+			}
+
+			m_spi.submit();
+			if (!m_capturing)
+				m_stats.memoryBytes += n * outSize;
+			left -= n;
 		}
-		
-		m_spi.write(data, (count * 2) + 1);
-		delete[] data;
 	}
 	
 	
+	void RA8875::convertPixels(TFT_Dither dither, TFT_PixelFormat format, const uint8_t* src, size_t count, int x, int y, uint8_t bpp, uint8_t* out) const
+	{
+		switch (dither)
+		{
+		case DitherOrdered:
+			if (bpp == 8)
+				ditherToRGB332(format, src, count, x, y, out);
+			else
+				ditherToRGB565BE(format, src, count, x, y, out);
+			break;
+		case DitherFloydSteinberg:
+			m_diffusion.convert(format, src, count, out);
+			break;
+		default:
+			if (bpp == 8)
+				convertToRGB332(format, src, count, out);
+			else
+				convertToRGB565BE(format, src, count, out);
+			break;
+		}
+	}
+
 	void RA8875::drawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t color) const
 	{
+		PrimitiveTimer timer(this, TFT_PRIM_LINE);
+		if (m_framebuffer)
+		{
+			m_framebuffer->drawLine(x0, y0, x1, y1, color);
+			return;
+		}
 		setRegister16(TFT_Register::DLHSR0, x0);
 		setRegister16(TFT_Register::DLVSR0, y0);
 		setRegister16(TFT_Register::DLHER0, x1);
@@ -1009,7 +1304,7 @@ namespace hw
 		setColorRegister(TFT_Register::FGCR0, color);
 
 		setRegister8(TFT_Register::DCR, 0x80);
-		waitPoll(TFT_Register::DCR, RA8875_DCR_LINESQUTRI_STATUS);
+		waitEngine(TFT_Register::DCR, RA8875_DCR_LINESQUTRI_STATUS);
 	}
 
 	void RA8875::drawRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color) const
@@ -1138,12 +1433,12 @@ namespace hw
 			/* Set Auto Mode      (Reg 0x71) */
 			setRegister8(TFT_Register::TPCR1, RA8875_TPCR1_AUTO | RA8875_TPCR1_DEBOUNCE);
 			/* Enable TP INT */
-			setRegister8(TFT_Register::INTC1, readRegister8(TFT_Register::INTC1) | RA8875_INTC1_TP);
+			setRegister8(TFT_Register::INTC1, readCached(TFT_Register::INTC1) | RA8875_INTC1_TP);
 		}
 		else
 		{
 			/* Disable TP INT */
-			setRegister8(TFT_Register::INTC1, readRegister8(TFT_Register::INTC1) & ~RA8875_INTC1_TP);
+			setRegister8(TFT_Register::INTC1, readCached(TFT_Register::INTC1) & ~RA8875_INTC1_TP);
 			/* Disable Touch Panel (Reg 0x70) */
 			setRegister8(TFT_Register::TPCR0, RA8875_TPCR0_DISABLE);
 		}
@@ -1156,12 +1451,36 @@ namespace hw
 
 	bool RA8875::touchRead(uint16_t *x, uint16_t *y) const
 	{
-		uint16_t tx, ty;
-		uint8_t temp;
+		uint8_t regs[3];
+		readRegisters({ TFT_Register::TPXH, TFT_Register::TPYH, TFT_Register::TPXYL }, regs);
+		decodeTouch(regs, x, y);
 
-		tx = readRegister8(TFT_Register::TPXH);
-		ty = readRegister8(TFT_Register::TPYH);
-		temp = readRegister8(TFT_Register::TPXYL);
+		/* Clear TP INT Status */
+		setRegister8(TFT_Register::INTC2, RA8875_INTC2_TP);
+		return true;
+	}
+
+	/*
+	 * touched() and touchRead() in a single USB round trip.  Coordinates are
+	 * only stored, and the interrupt cleared, when a touch is pending.
+	 */
+	bool RA8875::touchPoll(uint16_t *x, uint16_t *y) const
+	{
+		uint8_t regs[4];
+		readRegisters({ TFT_Register::INTC2, TFT_Register::TPXH, TFT_Register::TPYH, TFT_Register::TPXYL }, regs);
+		if ((regs[0] & RA8875_INTC2_TP) == 0)
+			return false;
+
+		decodeTouch(regs + 1, x, y);
+		setRegister8(TFT_Register::INTC2, RA8875_INTC2_TP);
+		return true;
+	}
+
+	void RA8875::decodeTouch(const uint8_t* regs, uint16_t *x, uint16_t *y)
+	{
+		uint16_t tx = regs[0];
+		uint16_t ty = regs[1];
+		uint8_t temp = regs[2];
 		tx <<= 2;
 		ty <<= 2;
 		tx |= temp & 0x03;        // get the bottom x bits
@@ -1169,46 +1488,205 @@ namespace hw
 
 		*x = tx;
 		*y = ty;
-
-		/* Clear TP INT Status */
-		setRegister8(TFT_Register::INTC2, RA8875_INTC2_TP);
-		return true;
 	}
 
 	void RA8875::setRegister8(TFT_Register reg, uint8_t val) const
 	{
+		TFT_TIMELINE_SCOPE("register", "setRegister8", "reg", reg);
+		if (m_shadowVerify != 0 && !m_capturing && ++m_shadowWrites >= m_shadowVerify)
+		{
+			m_shadowWrites = 0;
+			reconcileShadow();
+		}
+
+		// Writing the value the register already holds is a no-op.  Recordings
+		// keep every write, since they replay against unknown register state.
+		if (m_recording == nullptr && m_shadowValid[reg] && m_shadow[reg] == val)
+		{
+			if (!m_capturing)
+				m_stats.redundantWrites++;
+			return;
+		}
+
 		writeCommand(uint8_t(reg));
 		writeData(val);
 	}
 
 	void RA8875::setRegister16(TFT_Register reg, uint16_t val) const
 	{
-		writeCommand(uint8_t(reg) + 0);
-		writeData(uint8_t(val & 0xFF));
-		writeCommand(uint8_t(reg) + 1);
-		writeData(uint8_t(val >> 8));
+		setRegister8(TFT_Register(reg + 0), uint8_t(val & 0xFF));
+		setRegister8(TFT_Register(reg + 1), uint8_t(val >> 8));
 	}
 
+	/*
+	 * Color registers take 5/6/5 bits per channel in 16bpp mode and the top
+	 * 3/3/2 of them in 8bpp mode.
+	 */
 	void RA8875::setColorRegister(TFT_Register reg, uint16_t color) const
 	{
-		writeCommand(uint8_t(reg) + 0);
-		writeData(uint8_t((color & 0xf800) >> 11));
-		writeCommand(uint8_t(reg) + 1);
-		writeData(uint8_t((color & 0x07e0) >> 5));
-		writeCommand(uint8_t(reg) + 2);
-		writeData(uint8_t(color & 0x001f));
+		uint8_t rgb[3];
+		colorRegisters(color, m_colorDepth, rgb);
+		setRegister8(TFT_Register(reg + 0), rgb[0]);
+		setRegister8(TFT_Register(reg + 1), rgb[1]);
+		setRegister8(TFT_Register(reg + 2), rgb[2]);
 	}
 
 	uint8_t RA8875::readRegister8(TFT_Register reg) const
 	{
+		TFT_TIMELINE_SCOPE("register", "readRegister8", "reg", reg);
 		writeCommand(uint8_t(reg));
 		return readData();
 	}
+
+	/*
+	 * Read several registers with one USB round trip: the command and data
+	 * read frames of every register are queued and sent together, and all
+	 * responses come back in a single read.
+	 */
+	void RA8875::readRegisters(const TFT_Register* regs, uint8_t* values, size_t count) const
+	{
+		TFT_TIMELINE_SCOPE("register", "readRegisters", "count", int64_t(count));
+		// Bounded so the response fits on the stack.
+		static const size_t kBatch = 32;
+
+		sync();
+		while (count > 0)
+		{
+			size_t n = count < kBatch ? count : kBatch;
+			uint8_t response[kBatch * 2];
+
+			for (size_t i = 0; i < n; ++i)
+			{
+				uint8_t command[] = { RA8875_CMDWRITE, uint8_t(regs[i]) };
+				uint8_t read[] = { RA8875_DATAREAD, 0 };
+				m_spi.queueWrite(command, 2);
+				m_spi.queueTransfer(read, 2);
+			}
+			int got = m_spi.submit(response);
+			if (got < int(n * 2))
+			{
+				fprintf(stderr, "RA8875: register read returned %d of %d bytes\n", got, int(n * 2));
+				memset(values, 0, count);
+				return;
+			}
+
+			for (size_t i = 0; i < n; ++i)
+			{
+				values[i] = response[i * 2 + 1];
+				m_stats.registerReads[regs[i]]++;
+				if (isShadowable(regs[i]))
+				{
+					m_shadow[regs[i]] = values[i];
+					m_shadowValid.set(regs[i]);
+				}
+			}
+			m_selected = regs[n - 1];
+
+			regs += n;
+			values += n;
+			count -= n;
+		}
+	}
+
+	void RA8875::readRegisters(std::initializer_list<TFT_Register> regs, uint8_t* values) const
+	{
+		readRegisters(regs.begin(), values, regs.size());
+	}
+
+	/*
+	 * Queue the reads like readRegisters() does, but only start the USB
+	 * read.  Unlike readRegisters() this doesn't wait for a deferred draw;
+	 * callers poll pollSync() first.
+	 */
+	bool RA8875::beginReadRegisters(const TFT_Register* regs, size_t count) const
+	{
+		if (m_splitCount != 0)
+		{
+			fprintf(stderr, "RA8875: a split read is already in flight\n");
+			return false;
+		}
+		if (count == 0 || count > kMaxSplitRead)
+		{
+			fprintf(stderr, "RA8875: split reads take 1 to %d registers\n", int(kMaxSplitRead));
+			return false;
+		}
+
+		TFT_TIMELINE_SCOPE("register", "beginReadRegisters", "count", int64_t(count));
+		for (size_t i = 0; i < count; ++i)
+		{
+			uint8_t command[] = { RA8875_CMDWRITE, uint8_t(regs[i]) };
+			uint8_t read[] = { RA8875_DATAREAD, 0 };
+			m_spi.queueWrite(command, 2);
+			m_spi.queueTransfer(read, 2);
+			m_splitRegs[i] = regs[i];
+		}
+
+		if (!m_spi.beginSubmit(m_splitResponse))
+			return false;
+		m_splitCount = count;
+		return true;
+	}
+
+	bool RA8875::pollReadRegisters(uint8_t* values) const
+	{
+		if (m_splitCount == 0)
+			return true;
+
+		int result;
+		if (!m_spi.pollSubmit(result))
+			return false;
+
+		size_t count = m_splitCount;
+		m_splitCount = 0;
+		if (result < int(count * 2))
+		{
+			fprintf(stderr, "RA8875: split read returned %d of %d bytes\n", result, int(count * 2));
+			memset(values, 0, count);
+			return true;
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			values[i] = m_splitResponse[i * 2 + 1];
+			m_stats.registerReads[m_splitRegs[i]]++;
+			if (isShadowable(m_splitRegs[i]))
+			{
+				m_shadow[m_splitRegs[i]] = values[i];
+				m_shadowValid.set(m_splitRegs[i]);
+			}
+		}
+		m_selected = m_splitRegs[count - 1];
+		return true;
+	}
+
+	/*
+	 * Register value for read-modify-write: the shadow when we have one,
+	 * otherwise a real read (which fills the shadow).
+	 */
+	uint8_t RA8875::readCached(TFT_Register reg) const
+	{
+		if (m_shadowValid[reg])
+			return m_shadow[reg];
+		return readRegister8(reg);
+	}
 	
 	void RA8875::writeData(uint8_t d) const
 	{
+		size_t at = m_recording != nullptr ? m_device->captured() : 0;
+
 		uint8_t data[] = { RA8875_DATAWRITE, d };
 		m_spi.write(data, 2);
+
+		if (m_recording != nullptr)
+			m_recording->addPatch(at + m_spi.lastPayloadOffset() + 1, m_selected);
+		if (!m_capturing)
+			m_stats.registerWrites[m_selected]++;
+
+		if (isShadowable(m_selected))
+		{
+			m_shadow[m_selected] = d;
+			m_shadowValid.set(m_selected);
+		}
 	}
 
 	//void RA8875::writeDataArray(uint8_t d[]) const
@@ -1218,49 +1696,439 @@ namespace hw
 	//}
 
 	uint8_t RA8875::readData() const
+	{
+		uint8_t value = 0;
+		readSelected(value);
+		return value;
+	}
+
+	/*
+	 * Data read of the register writeCommand() selected.  False if the
+	 * reply didn't arrive; the shadow is left alone then.
+	 */
+	bool RA8875::readSelected(uint8_t& value) const
 	{
 		uint8_t data[] = { RA8875_DATAREAD, 0 };
 		uint8_t response[2];
-		m_spi.transfer(data, response, 2);
-		return response[1];
+		int got = m_spi.transfer(data, response, 2);
+		if (got < 2)
+		{
+			fprintf(stderr, "RA8875: read of register 0x%02x returned %d of 2 bytes\n", m_selected, got);
+			return false;
+		}
+		m_stats.registerReads[m_selected]++;
+
+		value = response[1];
+		if (isShadowable(m_selected))
+		{
+			m_shadow[m_selected] = value;
+			m_shadowValid.set(m_selected);
+		}
+		return true;
 	}
 
 	void RA8875::writeCommand(uint8_t d) const
 	{
+		// A deferred draw must finish before anything but the next
+		// primitive's coordinates is touched.
+		if (m_enginePending && !isDrawSetup(d))
+			sync();
+
 		uint8_t data[] = { RA8875_CMDWRITE, d };
 		m_spi.write(data, 2);
+		m_selected = d;
 	}
 
 	uint8_t RA8875::readStatus() const
 	{
 		uint8_t data[] = { RA8875_CMDREAD, 0 };
 		uint8_t response[2];
-		m_spi.transfer(data, response, 2);
+		int got = m_spi.transfer(data, response, 2);
+		if (got < 2)
+		{
+			fprintf(stderr, "RA8875: status read returned %d of 2 bytes\n", got);
+			return 0;
+		}
+		m_stats.statusReads++;
 		return response[1];
 	}
 
+	/*
+	 * Read 'reg' until the bits in 'f' clear.  False if a read fails or
+	 * they are still set after RA8875_WAIT_TIMEOUT_MS.
+	 */
 	bool RA8875::waitPoll(TFT_Register reg, uint8_t f) const
 	{
-		while (1)
+		using namespace std::chrono;
+		TFT_TIMELINE_SCOPE("engine", "waitPoll", "reg", reg);
+		steady_clock::time_point deadline = steady_clock::now() + milliseconds(RA8875_WAIT_TIMEOUT_MS);
+		for (;;)
 		{
-			uint8_t temp = readRegister8(reg);
+			uint8_t temp;
+			writeCommand(uint8_t(reg));
+			if (!readSelected(temp))
+				return false;
+			m_stats.pollIterations++;
 			if ((temp & f) == 0)
 				return true;
+			if (steady_clock::now() >= deadline)
+			{
+				fprintf(stderr, "RA8875: register 0x%02x still busy after %d ms\n", reg, RA8875_WAIT_TIMEOUT_MS);
+				return false;
+			}
 		}
-		// MEMEFIX: yeah i know, unreached! - add timeout?
 	}
 
 	void RA8875::waitBusy(uint8_t res) 
 	{
+		TFT_TIMELINE_SCOPE("engine", "waitBusy");
 		uint8_t temp; 	
 		//unsigned long start = millis();//M.Sandercock
 		do {
 			if (res == 0x01) writeCommand(TFT_Register::DMACR);//dma
 			temp = readStatus();
+			m_stats.busyIterations++;
 			//if ((millis() - start) > 10) return;
 		} while ((temp & res) == res);
 	}
+
+	/*
+	 * Let the device stall on the RA8875 WAIT# pin instead of polling the
+	 * status registers.  Requires WAIT# to be wired to a pin the device can
+	 * wait on (D5 on the FT232H).
+	 */
+	bool RA8875::setHardwareWait(bool on)
+	{
+		m_hardwareWait = false;
+		if (on)
+		{
+			// Only a capability check: the wiring can't be detected, and with
+			// WAIT# not connected the first gated draw stalls the device.
+			m_hardwareWait = m_device->canWaitForPin(m_wait);
+		}
+		return m_hardwareWait == on;
+	}
 	
+	/*
+	 * Upper bound for the SPI clocks chosen after PLL setup and by
+	 * calibrateSpiClock().
+	 */
+	void RA8875::setSpiClockLimit(int hz)
+	{
+		m_spiClockLimit = hz;
+		if (m_width != 0)
+			_boostSpiClock();
+	}
+
+	/*
+	 * Find the fastest write and read clocks, up to the configured limit,
+	 * at which a scratch register reads back correctly, and switch to them.
+	 * Returns the write clock, or 0 if even the startup clock fails.
+	 */
+	int RA8875::calibrateSpiClock()
+	{
+		TFT_TIMELINE_SCOPE("api", "calibrateSpiClock");
+		sync();
+		int safe = RA8875_SPI_INIT_HZ;
+		int writeHz = 0;
+		int readHz = 0;
+
+		// The MPSSE clock is 30MHz divided by (1 + divisor).
+		for (int divisor = 0; writeHz == 0; ++divisor)
+		{
+			int hz = 30000000 / (1 + divisor);
+			if (hz < safe)
+				break;
+			if (hz > m_spiClockLimit)
+				continue;
+
+			m_spi.setClocks(hz, safe);
+			if (_spiRoundTrip())
+				writeHz = hz;
+		}
+
+		for (int divisor = 0; writeHz != 0 && readHz == 0; ++divisor)
+		{
+			int hz = 30000000 / (1 + divisor);
+			if (hz < safe)
+				break;
+			if (hz > m_spiClockLimit)
+				continue;
+
+			m_spi.setClocks(writeHz, hz);
+			if (_spiRoundTrip())
+				readHz = hz;
+		}
+
+		if (writeHz == 0 || readHz == 0)
+		{
+			m_spi.setClocks(safe, safe);
+			return 0;
+		}
+
+		m_spi.setClocks(writeHz, readHz);
+		return writeHz;
+	}
+
+	/*
+	 * Write a few bit patterns to a register with no side effects (the third
+	 * triangle point) and check they read back unchanged.
+	 */
+	bool RA8875::_spiRoundTrip() const
+	{
+		static const uint8_t patterns[] = { 0x55, 0xAA, 0x0F, 0xF0 };
+		for (uint8_t pattern : patterns)
+		{
+			writeCommand(TFT_Register::DTPH0);
+			writeData(pattern);
+			if (readRegister8(TFT_Register::DTPH0) != pattern)
+				return false;
+		}
+		return true;
+	}
+
+	/*
+	 * Start recording the command stream instead of sending it.  A captured
+	 * stream can't contain reads, so the registers used for read-modify-write
+	 * are cached first and draw waits use the WAIT pin.  Fails unless
+	 * setHardwareWait(true) is in effect: only the caller knows WAIT# is
+	 * wired.
+	 */
+	bool RA8875::beginCapture()
+	{
+		if (m_capturing || !m_hardwareWait)
+			return false;
+
+		sync();
+		readCached(TFT_Register::MWCR0);
+		readCached(TFT_Register::FNCR0);
+		readCached(TFT_Register::FNCR1);
+		readCached(TFT_Register::INTC1);
+
+		memcpy(m_captureShadow, m_shadow, sizeof(m_shadow));
+		m_captureValid = m_shadowValid;
+		m_captureSelected = m_selected;
+
+		m_device->beginCapture();
+		m_capturing = true;
+		return true;
+	}
+
+	/*
+	 * The captured writes reach the chip only if the stream is submitted,
+	 * so afterwards the shadow keeps just the registers the capture left
+	 * unchanged, which are right either way.
+	 */
+	void RA8875::endCapture(std::vector<uint8_t>& stream)
+	{
+		if (!m_capturing)
+			return;
+
+		m_device->endCapture(stream);
+		m_capturing = false;
+
+		m_shadowValid &= m_captureValid;
+		for (int reg = 0; reg < 256; ++reg)
+		{
+			if (m_shadowValid[reg] && m_shadow[reg] != m_captureShadow[reg])
+				m_shadowValid.reset(reg);
+		}
+		m_selected = m_captureSelected;
+	}
+
+	/*
+	 * Send a captured command stream as one write.
+	 */
+	void RA8875::submitStream(const uint8_t* data, size_t length) const
+	{
+		TFT_TIMELINE_SCOPE("api", "submitStream", "bytes", int64_t(length));
+		m_device->write(data, length);
+		m_device->flush();
+	}
+
+	/*
+	 * Record into a replayable stream.  Unlike a plain capture, no register
+	 * write is skipped, so the recording doesn't depend on the chip state at
+	 * the time it was made.
+	 */
+	bool RA8875::beginRecording(CommandStream& stream)
+	{
+		stream.clear();
+		if (!beginCapture())
+			return false;
+
+		// Make the first frame set the clock explicitly.
+		m_spi.invalidateClock();
+		stream.m_colorDepth = m_colorDepth;
+		m_recording = &stream;
+		return true;
+	}
+
+	/*
+	 * Start a named patch group: register writes from here on can be changed
+	 * in the recording through CommandStream::patch*().
+	 */
+	void RA8875::markPatch(const char* group)
+	{
+		if (m_recording != nullptr)
+			m_recording->addGroup(group);
+	}
+
+	/*
+	 * Like endCapture(), leaves the shadow right whether or not the
+	 * recording is ever replayed.
+	 */
+	void RA8875::endRecording()
+	{
+		if (m_recording == nullptr)
+			return;
+
+		endCapture(m_recording->m_bytes);
+		m_recording = nullptr;
+	}
+
+	/*
+	 * Send a recording as one write.  The recording may have been patched,
+	 * so afterwards the register shadow can't be trusted anymore.
+	 */
+	void RA8875::replay(const CommandStream& stream) const
+	{
+		sync();
+		submitStream(stream.bytes().data(), stream.bytes().size());
+		invalidateShadow();
+		m_spi.invalidateClock();
+	}
+
+	/*
+	 * Pipelined mode: draw helpers return as soon as the primitive has been
+	 * started, and the completion wait happens lazily in front of the next
+	 * operation that needs the engine idle, or in sync().
+	 */
+	void RA8875::setPipelined(bool on)
+	{
+		if (!on)
+			sync();
+		m_pipelined = on;
+	}
+
+	/*
+	 * Wait for a deferred draw operation to finish.
+	 */
+	void RA8875::sync() const
+	{
+		if (!m_enginePending)
+			return;
+
+		// Clear first: waitPoll selects the status register itself.
+		m_enginePending = false;
+		m_stats.engineWaits++;
+		waitPoll(m_pendingReg, m_pendingFlag);
+	}
+
+	/*
+	 * One step of sync(): start a read of the status register, or see
+	 * whether the last one found the engine idle.  While another split read
+	 * is in flight on this display, wait for its owner to finish it.
+	 */
+	bool RA8875::pollSync() const
+	{
+		if (!m_enginePending)
+			return true;
+
+		if (!m_syncReading)
+		{
+			if (m_splitCount == 0 && beginReadRegisters(&m_pendingReg, 1))
+				m_syncReading = true;
+			return false;
+		}
+
+		uint8_t temp;
+		if (!pollReadRegisters(&temp))
+			return false;
+
+		m_syncReading = false;
+		m_stats.pollIterations++;
+		if ((temp & m_pendingFlag) != 0)
+			return false;
+
+		m_enginePending = false;
+		m_stats.engineWaits++;
+		return true;
+	}
+
+	/*
+	 * Forget every cached register value; the next read-modify-write reads
+	 * the chip again.
+	 */
+	void RA8875::invalidateShadow() const
+	{
+		m_shadowValid.reset();
+	}
+
+	/*
+	 * Read back every cached register and correct the shadow where it
+	 * differs from the chip.  Returns the number of mismatches found.
+	 */
+	int RA8875::reconcileShadow() const
+	{
+		TFT_Register regs[256];
+		uint8_t      cached[256];
+		size_t       count = 0;
+		for (int reg = 0; reg < 256; ++reg)
+		{
+			if (m_shadowValid[reg])
+			{
+				regs[count] = TFT_Register(reg);
+				cached[count] = m_shadow[reg];
+				++count;
+			}
+		}
+
+		uint8_t actual[256];
+		readRegisters(regs, actual, count);
+
+		int mismatches = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (actual[i] != cached[i])
+			{
+				fprintf(stderr, "RA8875: shadow of register 0x%02x was 0x%02x, chip has 0x%02x\n", regs[i], cached[i], actual[i]);
+				++mismatches;
+			}
+		}
+		return mismatches;
+	}
+
+	/*
+	 * Opt-in consistency check: reconcile the shadow with the chip after
+	 * every 'everyNWrites' register writes.  0 turns it off.
+	 */
+	void RA8875::setShadowVerify(unsigned everyNWrites)
+	{
+		m_shadowVerify = everyNWrites;
+		m_shadowWrites = 0;
+	}
+
+	/*
+	 * Snapshot of the counters, with the device's USB traffic filled in.
+	 */
+	TFT_Stats RA8875::stats() const
+	{
+		TFT_Stats s = m_stats;
+		TransferStats t = m_device->transferStats();
+		s.usbWrites = t.writes;
+		s.usbReads = t.reads;
+		s.bytesWritten = t.bytesWritten;
+		s.bytesRead = t.bytesRead;
+		return s;
+	}
+
+	void RA8875::resetStats()
+	{
+		memset(&m_stats, 0, sizeof(m_stats));
+		m_device->resetTransferStats();
+	}
+
 	uint16_t RA8875::width() const
 	{
 		return m_width;
@@ -1271,6 +2139,11 @@ namespace hw
 		return m_height;
 	}
 
+	void RA8875::flush() const
+	{
+		m_device->flush();
+	}
+
 	// -- Private methods below -------------------------
 
 	void RA8875::PLLinit() const
@@ -1301,6 +2174,21 @@ namespace hw
 		delay(1);
 	}
 
+	/*
+	 * Raise the SPI clocks once the PLL runs: writes are good up to a third
+	 * of the system clock, reads up to a sixth.
+	 */
+	void RA8875::_boostSpiClock()
+	{
+		// PLLinit() programs PLLDIVN = 10, PLLDIVM = 0, PLLDIVK = 2.
+		int sysClock = RA8875_XTAL_HZ * (10 + 1) / 4;
+		int writeHz = sysClock / 3;
+		int readHz = sysClock / 6;
+		if (writeHz > m_spiClockLimit) writeHz = m_spiClockLimit;
+		if (readHz > m_spiClockLimit) readHz = m_spiClockLimit;
+		m_spi.setClocks(writeHz, readHz);
+	}
+
 	void RA8875::initialize() const
 	{
 		PLLinit();
@@ -1365,8 +2253,48 @@ namespace hw
 		delay(500);
 	}
 
+	bool RA8875::gateOnWaitPin() const
+	{
+		// WAIT# is low while the chip is busy.
+		return m_hardwareWait && m_device->waitForPin(m_wait, true);
+	}
+
+	void RA8875::waitEngine(TFT_Register reg, uint8_t f) const
+	{
+		if (gateOnWaitPin())
+		{
+			if (!m_capturing)
+			{
+				m_stats.engineWaits++;
+				m_stats.pinWaits++;
+			}
+			return;
+		}
+
+		if (m_pipelined)
+		{
+			// Defer the wait until something needs the engine idle.
+			m_enginePending = true;
+			m_pendingReg = reg;
+			m_pendingFlag = f;
+			return;
+		}
+
+		m_stats.engineWaits++;
+		waitPoll(reg, f);
+	}
+
 	void RA8875::circleHelper(uint16_t x0, uint16_t y0, uint8_t r, uint16_t color, bool filled) const
 	{
+		PrimitiveTimer timer(this, filled ? TFT_PRIM_FILL_CIRCLE : TFT_PRIM_CIRCLE);
+		if (m_framebuffer)
+		{
+			if (filled)
+				m_framebuffer->fillEllipse(x0, y0, r, r, color);
+			else
+				m_framebuffer->drawEllipse(x0, y0, r, r, color);
+			return;
+		}
 		setRegister16(TFT_Register::DCHR0, x0);
 		setRegister16(TFT_Register::DCVR0, y0);
 		setRegister8(TFT_Register::DCRR, r);
@@ -1376,11 +2304,20 @@ namespace hw
 		setRegister8(TFT_Register::DCR, RA8875_DCR_CIRCLE_START | (filled ? RA8875_DCR_FILL : RA8875_DCR_NOFILL));
 
 		/* Wait for the command to finish */
-		waitPoll(TFT_Register::DCR, RA8875_DCR_CIRCLE_STATUS);
+		waitEngine(TFT_Register::DCR, RA8875_DCR_CIRCLE_STATUS);
 	}
 
 	void RA8875::rectHelper(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color, bool filled) const
 	{
+		PrimitiveTimer timer(this, filled ? TFT_PRIM_FILL_RECT : TFT_PRIM_RECT);
+		if (m_framebuffer)
+		{
+			if (filled)
+				m_framebuffer->fillRect(x, y, w, h, color);
+			else
+				m_framebuffer->drawRect(x, y, w, h, color);
+			return;
+		}
 		setRegister16(TFT_Register::DLHSR0, x);
 		setRegister16(TFT_Register::DLVSR0, y);
 		setRegister16(TFT_Register::DLHER0, w);
@@ -1391,11 +2328,20 @@ namespace hw
 		setRegister8(TFT_Register::DCR, filled ? 0xB0 : 0x90);
 
 		/* Wait for the command to finish */
-		waitPoll(TFT_Register::DCR, RA8875_DCR_LINESQUTRI_STATUS);
+		waitEngine(TFT_Register::DCR, RA8875_DCR_LINESQUTRI_STATUS);
 	}
 
 	void RA8875::triangleHelper(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color, bool filled) const
 	{
+		PrimitiveTimer timer(this, filled ? TFT_PRIM_FILL_TRIANGLE : TFT_PRIM_TRIANGLE);
+		if (m_framebuffer)
+		{
+			if (filled)
+				m_framebuffer->fillTriangle(x0, y0, x1, y1, x2, y2, color);
+			else
+				m_framebuffer->drawTriangle(x0, y0, x1, y1, x2, y2, color);
+			return;
+		}
 		setRegister16(TFT_Register::DLHSR0, x0);
 		setRegister16(TFT_Register::DLVSR0, y0);
 		setRegister16(TFT_Register::DLHER0, x1);
@@ -1408,11 +2354,20 @@ namespace hw
 		setRegister8(TFT_Register::DCR, filled ? 0xA1 : 0x81);
 
 		/* Wait for the command to finish */
-		waitPoll(TFT_Register::DCR, RA8875_DCR_LINESQUTRI_STATUS);
+		waitEngine(TFT_Register::DCR, RA8875_DCR_LINESQUTRI_STATUS);
 	}
 
 	void RA8875::ellipseHelper(uint16_t xCenter, uint16_t yCenter, uint16_t longAxis, uint16_t shortAxis, uint16_t color, bool filled) const
 	{
+		PrimitiveTimer timer(this, filled ? TFT_PRIM_FILL_ELLIPSE : TFT_PRIM_ELLIPSE);
+		if (m_framebuffer)
+		{
+			if (filled)
+				m_framebuffer->fillEllipse(xCenter, yCenter, longAxis, shortAxis, color);
+			else
+				m_framebuffer->drawEllipse(xCenter, yCenter, longAxis, shortAxis, color);
+			return;
+		}
 		setRegister16(TFT_Register::DEHR0, xCenter);
 		setRegister16(TFT_Register::DEVR0, yCenter);
 		setRegister16(TFT_Register::ELL_A0, longAxis);
@@ -1423,11 +2378,21 @@ namespace hw
 		setRegister8(TFT_Register::ELLIPSE, filled ? 0xC0 : 0x80);
 
 		/* Wait for the command to finish */
-		waitPoll(TFT_Register::ELLIPSE, RA8875_ELLIPSE_STATUS);
+		waitEngine(TFT_Register::ELLIPSE, RA8875_ELLIPSE_STATUS);
 	}
 
 	void RA8875::curveHelper(uint16_t xCenter, uint16_t yCenter, uint16_t longAxis, uint16_t shortAxis, uint8_t curvePart, uint16_t color, bool filled) const
 	{
+		PrimitiveTimer timer(this, filled ? TFT_PRIM_FILL_CURVE : TFT_PRIM_CURVE);
+		if (m_framebuffer)
+		{
+			uint8_t quadrant = uint8_t(1 << (curvePart & 0x03));
+			if (filled)
+				m_framebuffer->fillEllipse(xCenter, yCenter, longAxis, shortAxis, color, quadrant);
+			else
+				m_framebuffer->drawEllipse(xCenter, yCenter, longAxis, shortAxis, color, quadrant);
+			return;
+		}
 		setRegister16(TFT_Register::DEHR0, xCenter);
 		setRegister16(TFT_Register::DEVR0, yCenter);
 		setRegister16(TFT_Register::ELL_A0, longAxis);
@@ -1438,12 +2403,14 @@ namespace hw
 		setRegister8(TFT_Register::ELLIPSE, (filled ? 0xD0 : 0x90) | (curvePart & 0x03));
 
 		/* Wait for the command to finish */
-		waitPoll(TFT_Register::ELLIPSE, RA8875_ELLIPSE_STATUS);
+		waitEngine(TFT_Register::ELLIPSE, RA8875_ELLIPSE_STATUS);
 	}
 
 
-	void RA8875::delay(int ms)
+	void RA8875::delay(int ms) const
 	{
+		// Buffered commands must reach the chip before we start timing.
+		m_device->flush();
 		std::this_thread::sleep_for(std::chrono::milliseconds(ms));
 	}
 }
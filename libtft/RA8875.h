@@ -6,8 +6,14 @@
 
 #define __PRGMTAG_
 
+#include "Framebuffer.h"
 #include "IDevice.h"
+#include "PixelFormat.h"
 #include "SPI.h"
+#include "TileDiff.h"
+#include <bitset>
+#include <initializer_list>
+#include <memory>
 
 // Colors (RGB565)
 #define	RA8875_BLACK            0x0000
@@ -38,6 +44,63 @@
 
 enum TFT_Register : uint8_t;
 
+// Primitives with a latency histogram in TFT_Stats.
+enum TFT_Primitive
+{
+	TFT_PRIM_PIXEL = 0,
+	TFT_PRIM_PIXELS,
+	TFT_PRIM_LINE,
+	TFT_PRIM_RECT,
+	TFT_PRIM_FILL_RECT,
+	TFT_PRIM_CIRCLE,
+	TFT_PRIM_FILL_CIRCLE,
+	TFT_PRIM_TRIANGLE,
+	TFT_PRIM_FILL_TRIANGLE,
+	TFT_PRIM_ELLIPSE,
+	TFT_PRIM_FILL_ELLIPSE,
+	TFT_PRIM_CURVE,
+	TFT_PRIM_FILL_CURVE,
+	TFT_PRIM_TEXT,
+	TFT_PRIM_PUSH_RECT,
+	TFT_PRIM_PRESENT_FRAME,
+	TFT_PRIM_COUNT,
+};
+
+// Latency histogram buckets: bucket 0 counts calls under 1us, bucket i
+// calls of [2^(i-1), 2^i) us, the last bucket everything longer.
+#define TFT_LATENCY_BUCKETS     24
+
+// Always-on counters, see RA8875::stats().  Work captured for a DisplayList
+// or a recording is left out: it reaches the chip, if at all, as a stream.
+typedef struct
+{
+	/* USB traffic, as counted by the device */
+	uint64_t usbWrites;
+	uint64_t usbReads;
+	uint64_t bytesWritten;
+	uint64_t bytesRead;
+
+	/* Register access */
+	uint64_t registerWrites[256];
+	uint64_t registerReads[256];
+	uint64_t redundantWrites;       // dropped, the shadow already held the value
+	uint64_t statusReads;
+	uint64_t memoryBytes;           // pixel data written through MRWC
+
+	/* Draw engine */
+	uint64_t engineWaits;           // waits for the engine to go idle
+	uint64_t pinWaits;              // of those, queued on the WAIT# pin
+	uint64_t pollIterations;        // register reads in waitPoll()
+	uint64_t busyIterations;        // status reads in waitBusy()
+
+	/* Host side time per primitive call, including any engine wait; calls
+	   made by another primitive, such as textWrite()'s background fill,
+	   count as part of it */
+	uint64_t primitiveCalls[TFT_PRIM_COUNT];
+	uint64_t primitiveMicros[TFT_PRIM_COUNT];
+	uint32_t latency[TFT_PRIM_COUNT][TFT_LATENCY_BUCKETS];
+} TFT_Stats;
+
 enum TFT_DisplaySize
 {
 	_480x272 = 0,
@@ -86,6 +149,14 @@ const static uint8_t fontDimPar[4][5] = {
 
 namespace hw
 {
+	class CommandStream;
+#if defined(__cpp_impl_coroutine)
+	class ReadRegister8Awaiter;
+	class TouchedAwaiter;
+	class TouchReadAwaiter;
+	class SyncAwaiter;
+#endif
+
 	class RA8875
 	{
 	public:
@@ -128,12 +199,17 @@ namespace hw
 		/* Graphics functions */
 		void    graphicsMode() const;
 		void    setXY(uint16_t x, uint16_t y) const;
+		void    setColorDepth(uint8_t bpp);
+		uint8_t colorDepth() const { return m_colorDepth; }
+		void    setDither(TFT_Dither mode) { m_dither = mode; m_tiles.invalidate(); }
 		//void    fillRect() const;
 
 		/* HW accelerated wrapper functions (override Adafruit_GFX prototypes) */
 		void    fillScreen(uint16_t color) const;
 		void    drawPixel(int16_t x, int16_t y, uint16_t color) const;
 		void    drawPixels(uint16_t p[], uint16_t count, int16_t x, int16_t y) const;
+		void    pushRect(int16_t x, int16_t y, uint16_t w, uint16_t h, const uint16_t* pixels, size_t stride = 0);
+		void    pushRect(int16_t x, int16_t y, uint16_t w, uint16_t h, TFT_PixelFormat format, const void* pixels, size_t strideBytes = 0);
 		void    drawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t color) const;
 		void    drawRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color) const;
 		void    fillRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color) const;
@@ -155,16 +231,30 @@ namespace hw
 		void    PWM1out(uint8_t p) const;
 		void    PWM2out(uint8_t p) const;
 
+		/* Host framebuffer */
+		void    setFramebuffer(bool on);
+		Framebuffer* framebuffer() const { return m_framebuffer.get(); }
+		size_t  flushFramebuffer();
+
+		/* Whole frames, uploading the tiles that changed */
+		size_t  presentFrame(const uint16_t* pixels, size_t stride = 0);
+		void    invalidateFrame() { m_tiles.invalidate(); }
+
 		/* Touch screen */
 		void    touchEnable(bool on) const;
 		bool    touched() const;
 		bool    touchRead(uint16_t *x, uint16_t *y) const;
+		bool    touchPoll(uint16_t *x, uint16_t *y) const;
+		// TPXH, TPYH and TPXYL values to coordinates.
+		static void decodeTouch(const uint8_t* regs, uint16_t *x, uint16_t *y);
 
 		/* Low level access */
 		void     setRegister8(TFT_Register reg, uint8_t val) const;
 		void     setRegister16(TFT_Register reg, uint16_t val) const;
 		void     setColorRegister(TFT_Register reg, uint16_t color) const;
 		uint8_t  readRegister8(TFT_Register reg) const;
+		void     readRegisters(const TFT_Register* regs, uint8_t* values, size_t count) const;
+		void     readRegisters(std::initializer_list<TFT_Register> regs, uint8_t* values) const;
 
 		void     writeData(uint8_t d) const;
 		uint8_t  readData() const;
@@ -172,14 +262,72 @@ namespace hw
 		uint8_t  readStatus() const;
 		bool     waitPoll(TFT_Register reg, uint8_t f) const;
 		void     waitBusy(uint8_t res=0x80);//0x80, 0x40(BTE busy), 0x01(DMA busy)
+		bool     setHardwareWait(bool on);
+		void     setSpiClockLimit(int hz);
+		int      calibrateSpiClock();
+		void     setPipelined(bool on);
+		void     sync() const;
+
+		/* Split reads, for waiting on several displays from one thread; see
+		   RA8875Coroutines.h.  Nothing here blocks: begin starts the read,
+		   poll returns true once it is over.  One read in flight per display;
+		   a blocking read meanwhile finishes it first. */
+		static const size_t kMaxSplitRead = 4;
+		bool     beginReadRegisters(const TFT_Register* regs, size_t count) const;
+		bool     pollReadRegisters(uint8_t* values) const;
+		bool     readInFlight() const { return m_splitCount != 0; }
+		// sync() a step at a time: true once no deferred draw is running.
+		bool     pollSync() const;
+
+#if defined(__cpp_impl_coroutine)
+		/* Awaitable reads for C++20 coroutines, same meaning as the blocking
+		   methods; defined in RA8875Coroutines.h */
+		ReadRegister8Awaiter readRegister8Async(TFT_Register reg) const;
+		TouchedAwaiter       touchedAsync() const;
+		TouchReadAwaiter     touchReadAsync() const;
+		// Resumes once a deferred draw (see setPipelined()) has finished.
+		SyncAwaiter          syncAsync() const;
+#endif
+
+		/* Command capture */
+		bool     beginCapture();
+		void     endCapture(std::vector<uint8_t>& stream);
+		void     submitStream(const uint8_t* data, size_t length) const;
+
+		/* Replayable recordings */
+		bool     beginRecording(CommandStream& stream);
+		void     markPatch(const char* group);
+		void     endRecording();
+		void     replay(const CommandStream& stream) const;
+
+		/* Register shadow */
+		void     invalidateShadow() const;
+		int      reconcileShadow() const;
+		void     setShadowVerify(unsigned everyNWrites);
+
+		/* Counters, USB traffic included */
+		TFT_Stats stats() const;
+		void     resetStats();
+
 		uint16_t width() const;
 		uint16_t height() const;
+		void     flush() const;
 
 	private:
 		void _updateActiveWindow(bool full) const;
 		void _setSysClock(uint8_t pll1, uint8_t pll2, uint8_t pixclk);
 		void PLLinit() const;
 		void initialize() const;
+		void _boostSpiClock();
+		bool _spiRoundTrip() const;
+		bool gateOnWaitPin() const;
+		uint8_t readCached(TFT_Register reg) const;
+		bool    readSelected(uint8_t& value) const;
+		void waitEngine(TFT_Register reg, uint8_t f) const;
+		void uploadRect(int16_t x, int16_t y, uint16_t w, uint16_t h, TFT_PixelFormat format, const uint8_t* pixels, size_t strideBytes) const;
+		void blitRect(int16_t x, int16_t y, uint16_t w, uint16_t h, TFT_PixelFormat format, const uint8_t* pixels, size_t strideBytes) const;
+		void convertPixels(TFT_Dither dither, TFT_PixelFormat format, const uint8_t* src, size_t count, int x, int y, uint8_t bpp, uint8_t* out) const;
+		void streamPixels(TFT_PixelFormat format, const uint8_t* pixels, int16_t x, int16_t y, uint16_t w, uint16_t h, size_t strideBytes) const;
 
 		/* GFX Helper Functions */
 		void circleHelper(uint16_t x0, uint16_t y0, uint8_t r, uint16_t color, bool filled) const;
@@ -189,7 +337,10 @@ namespace hw
 		void curveHelper(uint16_t xCenter, uint16_t yCenter, uint16_t longAxis, uint16_t shortAxis, uint8_t curvePart, uint16_t color, bool filled) const;
 
 		/* timing helper */
-		static void delay(int ms);
+		void delay(int ms) const;
+
+		friend class PrimitiveTimer;
+		friend class FramePipeline;
 
 	private:
 		IDevice*    m_device;
@@ -197,8 +348,23 @@ namespace hw
 		Pin         m_rst;
 		Pin         m_wait;
 		Pin         m_interrupt;
+		bool        m_hardwareWait;
+		bool        m_pipelined;
+		int         m_spiClockLimit;
+		bool        m_capturing;
+		CommandStream* m_recording;
+		mutable bool         m_enginePending;
+		mutable TFT_Register m_pendingReg;
+		mutable uint8_t      m_pendingFlag;
 		uint16_t    m_width;
 		uint16_t    m_height;
+		uint8_t     m_colorDepth;
+		TFT_Dither  m_dither;
+		mutable ErrorDiffusion m_diffusion;
+		std::unique_ptr<Framebuffer> m_framebuffer;
+		std::vector<Framebuffer::Rect> m_flushRegions;
+		TileDiff    m_tiles;
+		std::vector<Framebuffer::Rect> m_frameRegions;
 		int16_t     m_activeWindowXL;
 		int16_t     m_activeWindowXR;
 		int16_t     m_activeWindowYT;
@@ -222,6 +388,28 @@ namespace hw
 		int         m_spaceCharWidth;
 		TFT_DisplaySize m_size;
 		const tFont * m_currentFont;
+
+		// Host-side copy of the writable registers, so read-modify-write needs
+		// no USB read and redundant writes can be dropped.
+		mutable uint8_t         m_shadow[256];
+		mutable std::bitset<256> m_shadowValid;
+		mutable uint8_t         m_selected;
+		mutable unsigned        m_shadowWrites;
+		unsigned                m_shadowVerify;
+
+		// The shadow when the capture began; see endCapture().
+		uint8_t                 m_captureShadow[256];
+		std::bitset<256>        m_captureValid;
+		uint8_t                 m_captureSelected;
+
+		mutable TFT_Stats       m_stats;
+		mutable int             m_primitiveDepth;   // PrimitiveTimers alive
+
+		// The split read in flight, its responses land in m_splitResponse.
+		mutable TFT_Register    m_splitRegs[kMaxSplitRead];
+		mutable size_t          m_splitCount;
+		mutable uint8_t         m_splitResponse[kMaxSplitRead * 2];
+		mutable bool            m_syncReading;
 	
 	};
 }
@@ -0,0 +1,361 @@
+#pragma once
+
+// C++20 only; the rest of the library stays C++11, so this header is empty
+// for older standards.
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+
+#include "RA8875.h"
+#include "RA8875Registers.h"
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace hw
+{
+	template <class T = void> class Task;
+
+	namespace detail
+	{
+		// Resumes whoever awaited the task once it finishes.
+		struct TaskPromiseBase
+		{
+			std::coroutine_handle<> continuation;
+
+			struct FinalAwaiter
+			{
+				bool await_ready() noexcept { return false; }
+				template <class Promise>
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+				{
+					std::coroutine_handle<> next = h.promise().continuation;
+					return next ? next : std::noop_coroutine();
+				}
+				void await_resume() noexcept {}
+			};
+
+			std::suspend_always initial_suspend() noexcept { return {}; }
+			FinalAwaiter        final_suspend() noexcept { return {}; }
+			void                unhandled_exception() { std::terminate(); }
+		};
+
+		template <class T>
+		struct TaskPromise : TaskPromiseBase
+		{
+			T value{};
+
+			Task<T> get_return_object();
+			void    return_value(T v) { value = std::move(v); }
+			T       result() { return std::move(value); }
+		};
+
+		template <>
+		struct TaskPromise<void> : TaskPromiseBase
+		{
+			Task<void> get_return_object();
+			void    return_void() {}
+			void    result() {}
+		};
+	}
+
+	///
+	/// A coroutine that starts when first awaited, or when handed to
+	/// IoLoop::spawn().
+	///
+	template <class T>
+	class Task
+	{
+	public:
+		typedef detail::TaskPromise<T> promise_type;
+		typedef std::coroutine_handle<promise_type> Handle;
+
+		explicit Task(Handle h) : m_handle(h) {}
+		Task(Task&& other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {}
+		Task& operator=(Task&& other) noexcept
+		{
+			if (this != &other)
+			{
+				if (m_handle)
+					m_handle.destroy();
+				m_handle = std::exchange(other.m_handle, nullptr);
+			}
+			return *this;
+		}
+		~Task()
+		{
+			if (m_handle)
+				m_handle.destroy();
+		}
+
+		Task(const Task&) = delete;
+		Task& operator=(const Task&) = delete;
+
+		bool done() const { return !m_handle || m_handle.done(); }
+
+		bool await_ready() const noexcept { return done(); }
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+		{
+			m_handle.promise().continuation = awaiting;
+			return m_handle;
+		}
+		T await_resume() { return m_handle.promise().result(); }
+
+	private:
+		friend class IoLoop;
+		Handle m_handle;
+	};
+
+	namespace detail
+	{
+		template <class T>
+		Task<T> TaskPromise<T>::get_return_object()
+		{
+			return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+		}
+
+		inline Task<void> TaskPromise<void>::get_return_object()
+		{
+			return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+		}
+	}
+
+	///
+	/// An operation a coroutine waits on.  poll() must not block: it moves
+	/// the operation along and returns true once it is over.
+	///
+	class PollAwaiter
+	{
+	public:
+		virtual ~PollAwaiter() {}
+		virtual bool poll() = 0;
+
+		bool await_ready() { return poll(); }
+		bool await_suspend(std::coroutine_handle<> h);
+	};
+
+	///
+	/// Runs coroutines on the calling thread.  A suspended coroutine is
+	/// parked with the operation it waits on; each pass of run() polls all
+	/// of them and resumes those whose operation is over, so a read on one
+	/// display doesn't hold up a wait on another.  When a pass finds nothing
+	/// ready the loop sleeps for 'idle' before the next.
+	///
+	class IoLoop
+	{
+	public:
+		explicit IoLoop(std::chrono::microseconds idle = std::chrono::microseconds(100))
+			: m_idle(idle)
+			, m_started(0)
+		{
+		}
+
+		IoLoop(const IoLoop&) = delete;
+		IoLoop& operator=(const IoLoop&) = delete;
+
+		// 'task' starts with the next pass of run(), and is kept until run()
+		// returns.  Tasks may spawn others.
+		void spawn(Task<void> task)
+		{
+			m_tasks.push_back(std::move(task));
+		}
+
+		// Until every spawned task is done.
+		void run()
+		{
+			IoLoop* outer = current();
+			current() = this;
+			for (;;)
+			{
+				// By index: a task may spawn others as it runs.
+				while (m_started < m_tasks.size())
+					m_tasks[m_started++].m_handle.resume();
+				if (allDone())
+					break;
+
+				std::vector<Parked> parked;
+				parked.swap(m_parked);
+
+				bool resumed = false;
+				for (size_t i = 0; i < parked.size(); ++i)
+				{
+					if (parked[i].op->poll())
+					{
+						parked[i].handle.resume();
+						resumed = true;
+					}
+					else
+					{
+						m_parked.push_back(parked[i]);
+					}
+				}
+
+				if (!resumed)
+					std::this_thread::sleep_for(m_idle);
+			}
+
+			m_tasks.clear();
+			m_started = 0;
+			current() = outer;
+		}
+
+		// The loop running on this thread, if any.
+		static IoLoop*& current()
+		{
+			static thread_local IoLoop* loop = nullptr;
+			return loop;
+		}
+
+		void park(PollAwaiter* op, std::coroutine_handle<> h)
+		{
+			m_parked.push_back(Parked{ op, h });
+		}
+
+	private:
+		struct Parked
+		{
+			PollAwaiter*            op;
+			std::coroutine_handle<> handle;
+		};
+
+		bool allDone() const
+		{
+			for (const Task<void>& task : m_tasks)
+				if (!task.done())
+					return false;
+			return true;
+		}
+
+		std::chrono::microseconds m_idle;
+		std::vector<Task<void>>   m_tasks;
+		size_t                    m_started;
+		std::vector<Parked>       m_parked;
+	};
+
+	// Outside an IoLoop there is nothing else to run: poll in place.
+	inline bool PollAwaiter::await_suspend(std::coroutine_handle<> h)
+	{
+		IoLoop* loop = IoLoop::current();
+		if (loop == nullptr)
+		{
+			while (!poll())
+				std::this_thread::yield();
+			return false;
+		}
+		loop->park(this, h);
+		return true;
+	}
+
+	// INTC2 touch interrupt bit, RA8875_INTC2_TP in RA8875.cpp.
+	static const uint8_t kTouchInterrupt = 0x04;
+
+	///
+	/// Registers read once the draw engine is idle, as readRegisters()
+	/// does.  Other coroutines reading the same display take turns.
+	///
+	class RegisterReadAwaiter : public PollAwaiter
+	{
+	public:
+		RegisterReadAwaiter(const RA8875& tft, std::initializer_list<TFT_Register> regs)
+			: m_tft(tft)
+			, m_count(0)
+			, m_started(false)
+		{
+			for (TFT_Register reg : regs)
+				if (m_count < RA8875::kMaxSplitRead)
+					m_regs[m_count++] = reg;
+		}
+
+		bool poll() override
+		{
+			if (!m_started)
+			{
+				if (!m_tft.pollSync() || m_tft.readInFlight())
+					return false;
+				if (!m_tft.beginReadRegisters(m_regs, m_count))
+				{
+					for (size_t i = 0; i < m_count; ++i)
+						m_values[i] = 0;
+					return true;
+				}
+				m_started = true;
+			}
+			return m_tft.pollReadRegisters(m_values);
+		}
+
+	protected:
+		const RA8875& m_tft;
+		TFT_Register  m_regs[RA8875::kMaxSplitRead];
+		uint8_t       m_values[RA8875::kMaxSplitRead];
+		size_t        m_count;
+		bool          m_started;
+	};
+
+	class ReadRegister8Awaiter : public RegisterReadAwaiter
+	{
+	public:
+		ReadRegister8Awaiter(const RA8875& tft, TFT_Register reg)
+			: RegisterReadAwaiter(tft, { reg })
+		{
+		}
+
+		uint8_t await_resume() const { return m_values[0]; }
+	};
+
+	class TouchedAwaiter : public RegisterReadAwaiter
+	{
+	public:
+		explicit TouchedAwaiter(const RA8875& tft)
+			: RegisterReadAwaiter(tft, { TFT_Register::INTC2 })
+		{
+		}
+
+		bool await_resume() const { return (m_values[0] & kTouchInterrupt) != 0; }
+	};
+
+	// Coordinates of the last touch, as touchRead() stores them.
+	struct TouchPoint
+	{
+		uint16_t x;
+		uint16_t y;
+	};
+
+	class TouchReadAwaiter : public RegisterReadAwaiter
+	{
+	public:
+		explicit TouchReadAwaiter(const RA8875& tft)
+			: RegisterReadAwaiter(tft, { TFT_Register::TPXH, TFT_Register::TPYH, TFT_Register::TPXYL })
+		{
+		}
+
+		TouchPoint await_resume() const
+		{
+			TouchPoint point;
+			RA8875::decodeTouch(m_values, &point.x, &point.y);
+			m_tft.setRegister8(TFT_Register::INTC2, kTouchInterrupt);
+			return point;
+		}
+	};
+
+	class SyncAwaiter : public PollAwaiter
+	{
+	public:
+		explicit SyncAwaiter(const RA8875& tft) : m_tft(tft) {}
+
+		bool poll() override { return m_tft.pollSync(); }
+		void await_resume() const {}
+
+	private:
+		const RA8875& m_tft;
+	};
+
+	inline ReadRegister8Awaiter RA8875::readRegister8Async(TFT_Register reg) const { return ReadRegister8Awaiter(*this, reg); }
+	inline TouchedAwaiter       RA8875::touchedAsync() const { return TouchedAwaiter(*this); }
+	inline TouchReadAwaiter     RA8875::touchReadAsync() const { return TouchReadAwaiter(*this); }
+	inline SyncAwaiter          RA8875::syncAsync() const { return SyncAwaiter(*this); }
+}
+
+#endif
+#endif
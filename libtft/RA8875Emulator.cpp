@@ -0,0 +1,765 @@
+#include "RA8875Emulator.h"
+#include "FT232H.h"
+#include "RA8875Registers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <ftdi.h>
+
+#include <algorithm>
+
+// SPI frame prefixes, see RA8875.cpp.
+#define RA8875_DATAWRITE        0x00
+#define RA8875_DATAREAD         0x40
+#define RA8875_CMDWRITE         0x80
+#define RA8875_CMDREAD          0xC0
+
+namespace hw
+{
+	// Same write chunking as FT232H.
+	static const size_t kChunkSize = 65535;
+
+	RA8875Emulator::RA8875Emulator(int width, int height, Pin cs, Pin rst, Pin wait, Pin interrupt)
+		: m_memory(width, height)
+		, m_decoder(*this)
+		, m_cs(cs)
+		, m_rst(rst)
+		, m_wait(wait)
+		, m_interrupt(interrupt)
+		, m_gpio_direction(0)
+		, m_gpio_values(0)
+		, m_pinDirection(0)
+		, m_pinValues(0)
+		, m_divisor(0)
+		, m_latencyMs(16)
+		, m_buffered(false)
+		, m_capturing(false)
+		, m_stats()
+		, m_selectedChip(false)
+		, m_frameIndex(0)
+		, m_prefix(0)
+		, m_selected(0)
+		, m_pixelPending(false)
+		, m_pixelHigh(0)
+		, m_readLow(false)
+	{
+		chipReset();
+	}
+
+	bool RA8875Emulator::open()
+	{
+		m_decoder.reset();
+		m_response.clear();
+
+		// Initialize all GPIO as inputs, as FT232H::open() does.
+		writeList({ SET_BITS_LOW, 0, 0, SET_BITS_HIGH, 0, 0 });
+		m_gpio_direction = 0x0000;
+		m_gpio_values = 0x0000;
+		return true;
+	}
+
+	void RA8875Emulator::close()
+	{
+		flush();
+	}
+
+	void RA8875Emulator::setPinDirection(Pin pin, Direction dir)
+	{
+		setupPin(pin, dir);
+		writeGpio();
+	}
+
+	Direction RA8875Emulator::getPinDirection(Pin pin)
+	{
+		return (m_gpio_direction & pinToMask(pin)) != 0 ? Direction::Out : Direction::In;
+	}
+
+	void RA8875Emulator::setPinValue(Pin pin, bool value)
+	{
+		outputPin(pin, value);
+		writeGpio();
+	}
+
+	bool RA8875Emulator::getPinValue(Pin pin)
+	{
+		return (readPins() & pinToMask(pin)) != 0;
+	}
+
+	uint16_t RA8875Emulator::readPins()
+	{
+		writeList({ GET_BITS_LOW, GET_BITS_HIGH });
+
+		uint8_t data[2] = { 0, 0 };
+		read(data, 2);
+		m_gpio_values = uint16_t(data[1] << 8 | data[0]);
+		return m_gpio_values;
+	}
+
+	size_t RA8875Emulator::encodePinValue(Pin pin, bool value, uint8_t* out)
+	{
+		outputPin(pin, value);
+		if (static_cast<int>(pin) < 8)
+		{
+			out[0] = SET_BITS_LOW;
+			out[1] = uint8_t(m_gpio_values & 0xff);
+			out[2] = uint8_t(m_gpio_direction & 0xff);
+		}
+		else
+		{
+			out[0] = SET_BITS_HIGH;
+			out[1] = uint8_t(m_gpio_values >> 8);
+			out[2] = uint8_t(m_gpio_direction >> 8);
+		}
+		return 3;
+	}
+
+	bool RA8875Emulator::waitForPin(Pin pin, bool value)
+	{
+		if (!canWaitForPin(pin))
+			return false;
+
+		writeByte(value ? WAIT_ON_HIGH : WAIT_ON_LOW);
+		return true;
+	}
+
+	bool RA8875Emulator::canWaitForPin(Pin pin) const
+	{
+		// Like the FT232H, only GPIOL1 (D5) can be waited on.
+		return pin == Pin::D5;
+	}
+
+	void RA8875Emulator::setClock(int clock_hz, bool adaptive, bool three_phase)
+	{
+		int divisor = FT232H::clockDivisor(clock_hz);
+		if (three_phase)
+			divisor = int(divisor*(2.0 / 3.0));
+
+		writeList({ DIS_DIV_5, uint8_t(adaptive ? EN_ADAPTIVE : DIS_ADAPTIVE), uint8_t(three_phase ? EN_3_PHASE : DIS_3_PHASE) });
+		writeByte(TCK_DIVISOR);
+		writeUInt16(uint16_t(divisor));
+	}
+
+	size_t RA8875Emulator::encodeClock(int clock_hz, uint8_t* out)
+	{
+		int divisor = FT232H::clockDivisor(clock_hz);
+		out[0] = TCK_DIVISOR;
+		out[1] = uint8_t(divisor & 0xff);
+		out[2] = uint8_t(divisor >> 8);
+		return 3;
+	}
+
+	int RA8875Emulator::write(const uint8_t* data, size_t length)
+	{
+		if (m_capturing)
+		{
+			m_capture.insert(m_capture.end(), data, data + length);
+			return static_cast<int>(length);
+		}
+
+		size_t done = 0;
+		while (done < length)
+		{
+			if (!m_buffered)
+			{
+				// libftdi splits large writes into chunk sized transfers.
+				size_t n = std::min(length - done, kChunkSize);
+				transfer(data + done, n);
+				done += n;
+				continue;
+			}
+
+			if (m_buffer.size() == kChunkSize)
+				flush();
+
+			size_t n = std::min(length - done, kChunkSize - m_buffer.size());
+			m_buffer.insert(m_buffer.end(), data + done, data + done + n);
+			done += n;
+		}
+		return static_cast<int>(length);
+	}
+
+	int RA8875Emulator::read(uint8_t* data, int expected, int /*timeOutInMs*/)
+	{
+		if (m_capturing)
+		{
+			fprintf(stderr, "RA8875Emulator: read while capturing commands\n");
+			return -1;
+		}
+
+		flush();
+
+		// Whatever hasn't been produced by now never will be; that's what a
+		// timeout looks like on the real device.
+		int n = std::min(expected, static_cast<int>(m_response.size()));
+		std::copy(m_response.begin(), m_response.begin() + n, data);
+		m_response.erase(m_response.begin(), m_response.begin() + n);
+		m_stats.reads++;
+		m_stats.bytesRead += n;
+		return n;
+	}
+
+	bool RA8875Emulator::setLatencyTimer(int ms)
+	{
+		m_latencyMs = std::min(std::max(ms, 1), 255);
+		return true;
+	}
+
+	void RA8875Emulator::setLatencyProfile(LatencyProfile profile)
+	{
+		setLatencyTimer(profile == LatencyProfile::LowestLatency ? 1 : 16);
+	}
+
+	int RA8875Emulator::flush()
+	{
+		if (m_buffer.empty())
+			return 0;
+
+		int size = static_cast<int>(m_buffer.size());
+		transfer(m_buffer.data(), m_buffer.size());
+		m_buffer.clear();
+		return size;
+	}
+
+	void RA8875Emulator::beginCapture()
+	{
+		flush();
+		m_capture.clear();
+		m_capturing = true;
+	}
+
+	void RA8875Emulator::endCapture(std::vector<uint8_t>& stream)
+	{
+		m_capturing = false;
+		stream.swap(m_capture);
+		m_capture.clear();
+	}
+
+	void RA8875Emulator::setBuffered(bool buffered)
+	{
+		if (!buffered)
+			flush();
+		m_buffered = buffered;
+	}
+
+	void RA8875Emulator::resetStats()
+	{
+		m_stats = Stats();
+	}
+
+	TransferStats RA8875Emulator::transferStats() const
+	{
+		TransferStats t;
+		t.writes = m_stats.transfers;
+		t.reads = m_stats.reads;
+		t.bytesWritten = m_stats.bytesWritten;
+		t.bytesRead = m_stats.bytesRead;
+		return t;
+	}
+
+	void RA8875Emulator::touch(uint16_t x, uint16_t y)
+	{
+		m_regs[TFT_Register::TPXH] = uint8_t(x >> 2);
+		m_regs[TFT_Register::TPYH] = uint8_t(y >> 2);
+		m_regs[TFT_Register::TPXYL] = uint8_t((x & 0x03) | (y & 0x03) << 2);
+		if (m_regs[TFT_Register::TPCR0] & 0x80)
+			m_regs[TFT_Register::INTC2] |= 0x04;
+	}
+
+	///
+	/// Hand one USB write to the MPSSE decoder; anything the chip answers is
+	/// queued for read().
+	///
+	void RA8875Emulator::transfer(const uint8_t* data, size_t length)
+	{
+		m_stats.transfers++;
+		m_stats.bytesWritten += length;
+
+		m_decoder.feed(data, length, m_reply);
+		m_response.insert(m_response.end(), m_reply.begin(), m_reply.end());
+		m_reply.clear();
+	}
+
+	//
+	// MPSSE side.
+	//
+
+	void RA8875Emulator::onSetBits(int bank, uint8_t value, uint8_t direction)
+	{
+		uint16_t before = m_pinValues;
+		int shift = bank * 8;
+		m_pinValues = uint16_t((m_pinValues & ~(0xFF << shift)) | value << shift);
+		m_pinDirection = uint16_t((m_pinDirection & ~(0xFF << shift)) | direction << shift);
+
+		uint16_t cs = pinToMask(m_cs);
+		if ((before & cs) && !(m_pinValues & cs))
+		{
+			m_selectedChip = true;
+			m_frameIndex = 0;
+			m_stats.frames++;
+		}
+		else if (!(before & cs) && (m_pinValues & cs))
+		{
+			m_selectedChip = false;
+		}
+
+		// The chip comes out of reset when RST# is released.
+		uint16_t rst = pinToMask(m_rst);
+		if (!(before & rst) && (m_pinValues & rst))
+			chipReset();
+	}
+
+	uint8_t RA8875Emulator::onGetBits(int bank)
+	{
+		uint16_t pins = (m_pinValues & m_pinDirection) | (inputPins() & ~m_pinDirection);
+		return uint8_t(pins >> (bank * 8));
+	}
+
+	void RA8875Emulator::onClockDivisor(uint16_t divisor)
+	{
+		m_divisor = divisor;
+	}
+
+	void RA8875Emulator::onShiftBegin(uint8_t opcode, size_t length)
+	{
+		// Bit mode commands count bits, the others bytes.
+		clocked((opcode & (MPSSE_BITMODE | MPSSE_WRITE_TMS)) ? length : length * 8);
+	}
+
+	void RA8875Emulator::onWaitPin(bool /*high*/)
+	{
+		waitPin();
+	}
+
+	void RA8875Emulator::onSendImmediate()
+	{
+		sendImmediate();
+	}
+
+	uint8_t RA8875Emulator::onShiftByte(uint8_t /*opcode*/, uint8_t out)
+	{
+		if (!m_selectedChip)
+			return 0;
+		return spiByte(out);
+	}
+
+	///
+	/// Levels the RA8875 drives: WAIT# is always high (idle) since the engine
+	/// finishes instantly, INT# goes low while an enabled interrupt is pending.
+	///
+	uint16_t RA8875Emulator::inputPins() const
+	{
+		uint16_t pins = pinToMask(m_wait) | pinToMask(m_interrupt);
+		if (m_regs[TFT_Register::INTC1] & m_regs[TFT_Register::INTC2] & 0x1E)
+			pins &= ~pinToMask(m_interrupt);
+		return pins;
+	}
+
+	void RA8875Emulator::setupPin(Pin pin, Direction dir)
+	{
+		if (dir == Direction::In)
+		{
+			m_gpio_direction &= ~pinToMask(pin);
+			m_gpio_values &= ~pinToMask(pin);
+		}
+		else
+		{
+			m_gpio_direction |= pinToMask(pin);
+		}
+	}
+
+	void RA8875Emulator::outputPin(Pin pin, bool value)
+	{
+		if (value)
+			m_gpio_values |= pinToMask(pin);
+		else
+			m_gpio_values &= ~pinToMask(pin);
+	}
+
+	void RA8875Emulator::writeGpio()
+	{
+		writeList({
+			SET_BITS_LOW, uint8_t(m_gpio_values & 0xff), uint8_t(m_gpio_direction & 0xff),
+			SET_BITS_HIGH, uint8_t(m_gpio_values >> 8), uint8_t(m_gpio_direction >> 8),
+		});
+	}
+
+	uint16_t RA8875Emulator::pinToMask(Pin pin)
+	{
+		return uint16_t(1 << static_cast<int>(pin));
+	}
+
+	//
+	// RA8875 side.
+	//
+
+	///
+	/// One byte of an SPI frame.  The first byte selects the access type,
+	/// the following ones are its data.  Returns the byte shifted out on MISO.
+	///
+	uint8_t RA8875Emulator::spiByte(uint8_t out)
+	{
+		if (m_frameIndex++ == 0)
+		{
+			m_prefix = out & 0xC0;
+			return 0;
+		}
+
+		switch (m_prefix)
+		{
+		case RA8875_CMDWRITE:
+			m_selected = out;
+			m_pixelPending = false;
+			m_readLow = false;
+			return 0;
+		case RA8875_CMDREAD:
+			return readStatus();
+		case RA8875_DATAWRITE:
+			writeRegister(m_selected, out);
+			return 0;
+		default:
+			return readRegister(m_selected);
+		}
+	}
+
+	void RA8875Emulator::chipReset()
+	{
+		memset(m_regs, 0, sizeof(m_regs));
+		m_regs[TFT_Register::STSR] = 0x75;
+
+		// Start with the whole memory as the display and active window.
+		int w = m_memory.width();
+		int h = m_memory.height();
+		m_regs[TFT_Register::HDWR] = uint8_t(w / 8 - 1);
+		setReg16(TFT_Register::VDHR0, uint16_t(h - 1));
+		setReg16(TFT_Register::HEAW0, uint16_t(w - 1));
+		setReg16(TFT_Register::VEAW0, uint16_t(h - 1));
+
+		m_selected = 0;
+		m_pixelPending = false;
+		m_readLow = false;
+	}
+
+	void RA8875Emulator::writeRegister(uint8_t reg, uint8_t value)
+	{
+		switch (reg)
+		{
+		case TFT_Register::STSR:
+			// Read only.
+			break;
+		case TFT_Register::MRWC:
+			memoryWrite(value);
+			break;
+		case TFT_Register::PWRR:
+			if (value & 0x01)
+				chipReset();
+			m_regs[reg] = value & ~0x01;
+			break;
+		case TFT_Register::INTC2:
+			// Write one to clear.
+			m_regs[reg] &= uint8_t(~value);
+			break;
+		case TFT_Register::MCLR:
+			m_regs[reg] = value;
+			if (value & 0x80)
+				memoryClear();
+			m_regs[reg] &= ~0x80;
+			break;
+		case TFT_Register::DCR:
+			m_regs[reg] = value;
+			if (value & 0x80)
+				drawLineEngine();
+			else if (value & 0x40)
+				drawCircleEngine();
+			m_regs[reg] &= ~0xC0;
+			break;
+		case TFT_Register::ELLIPSE:
+			m_regs[reg] = value;
+			if (value & 0x80)
+				drawEllipseEngine();
+			m_regs[reg] &= ~0x80;
+			break;
+		default:
+			m_regs[reg] = value;
+			break;
+		}
+	}
+
+	uint8_t RA8875Emulator::readRegister(uint8_t reg)
+	{
+		if (reg == TFT_Register::MRWC)
+			return memoryRead();
+		return m_regs[reg];
+	}
+
+	uint8_t RA8875Emulator::readStatus()
+	{
+		uint8_t status = 0;
+		if (m_regs[TFT_Register::INTC2] & 0x04)
+			status |= 0x20;    // touch event
+		if (m_regs[TFT_Register::PWRR] & 0x02)
+			status |= 0x10;    // sleep
+		return status;
+	}
+
+	void RA8875Emulator::setReg16(uint8_t reg, uint16_t value)
+	{
+		m_regs[reg] = uint8_t(value & 0xFF);
+		m_regs[reg + 1] = uint8_t(value >> 8);
+	}
+
+	uint16_t RA8875Emulator::color(uint8_t reg) const
+	{
+		return uint16_t((m_regs[reg] & 0x1F) << 11 | (m_regs[reg + 1] & 0x3F) << 5 | (m_regs[reg + 2] & 0x1F));
+	}
+
+	void RA8875Emulator::clipToActiveWindow()
+	{
+		m_memory.setClip(reg16(TFT_Register::HSAW0), reg16(TFT_Register::VSAW0),
+			reg16(TFT_Register::HEAW0), reg16(TFT_Register::VEAW0));
+	}
+
+	///
+	/// 16bpp over the 8 bit interface: every pixel is two writes, high byte
+	/// first.  The write cursor wraps inside the active window.
+	///
+	void RA8875Emulator::memoryWrite(uint8_t value)
+	{
+		if (m_regs[TFT_Register::MWCR0] & 0x80)
+		{
+			textWrite(value);
+			return;
+		}
+
+		if (!m_pixelPending)
+		{
+			m_pixelHigh = value;
+			m_pixelPending = true;
+			return;
+		}
+		m_pixelPending = false;
+
+		int x = reg16(TFT_Register::CURH0);
+		int y = reg16(TFT_Register::CURV0);
+		clipToActiveWindow();
+		m_memory.drawPixel(x, y, uint16_t(m_pixelHigh << 8 | value));
+
+		if (++x > reg16(TFT_Register::HEAW0))
+		{
+			x = reg16(TFT_Register::HSAW0);
+			if (++y > reg16(TFT_Register::VEAW0))
+				y = reg16(TFT_Register::VSAW0);
+		}
+		setReg16(TFT_Register::CURH0, uint16_t(x));
+		setReg16(TFT_Register::CURV0, uint16_t(y));
+	}
+
+	uint8_t RA8875Emulator::memoryRead()
+	{
+		int x = reg16(TFT_Register::RCURH0);
+		int y = reg16(TFT_Register::RCURV0);
+		uint16_t pixel = m_memory.getPixel(x, y);
+
+		if (!m_readLow)
+		{
+			m_readLow = true;
+			return uint8_t(pixel >> 8);
+		}
+		m_readLow = false;
+
+		if (++x > reg16(TFT_Register::HEAW0))
+		{
+			x = reg16(TFT_Register::HSAW0);
+			if (++y > reg16(TFT_Register::VEAW0))
+				y = reg16(TFT_Register::VSAW0);
+		}
+		setReg16(TFT_Register::RCURH0, uint16_t(x));
+		setReg16(TFT_Register::RCURV0, uint16_t(y));
+		return uint8_t(pixel & 0xFF);
+	}
+
+	///
+	/// Internal font character at the font write cursor.  Cell size, scaling
+	/// and transparency follow FNCR1; the glyph itself is a block.
+	///
+	void RA8875Emulator::textWrite(uint8_t c)
+	{
+		uint8_t fncr1 = m_regs[TFT_Register::FNCR1];
+		int sx = ((fncr1 >> 2) & 0x03) + 1;
+		int sy = (fncr1 & 0x03) + 1;
+		int w = 8 * sx;
+		int h = 16 * sy;
+		int x = reg16(TFT_Register::F_CURXL);
+		int y = reg16(TFT_Register::F_CURYL);
+
+		clipToActiveWindow();
+		engineRun(EngineOp::Text, clippedPixels(uint64_t(w) * h, true, x, y, x + w - 1, y + h - 1));
+
+		if (!(fncr1 & 0x40))
+			m_memory.fillRect(x, y, x + w - 1, y + h - 1, color(TFT_Register::BGCR0));
+		if (c > ' ' && c < 0x7F)
+			m_memory.fillRect(x + sx, y + 2 * sy, x + 7 * sx - 1, y + 14 * sy - 1, color(TFT_Register::FGCR0));
+
+		x += w;
+		if (x + w - 1 > reg16(TFT_Register::HEAW0))
+		{
+			x = reg16(TFT_Register::HSAW0);
+			y += h;
+		}
+		setReg16(TFT_Register::F_CURXL, uint16_t(x));
+		setReg16(TFT_Register::F_CURYL, uint16_t(y));
+	}
+
+	void RA8875Emulator::drawLineEngine()
+	{
+		uint8_t dcr = m_regs[TFT_Register::DCR];
+		bool filled = (dcr & 0x20) != 0;
+		int x0 = reg16(TFT_Register::DLHSR0);
+		int y0 = reg16(TFT_Register::DLVSR0);
+		int x1 = reg16(TFT_Register::DLHER0);
+		int y1 = reg16(TFT_Register::DLVER0);
+		uint16_t fg = color(TFT_Register::FGCR0);
+		uint64_t w = uint64_t(std::abs(x1 - x0)) + 1;
+		uint64_t h = uint64_t(std::abs(y1 - y0)) + 1;
+
+		clipToActiveWindow();
+		if (dcr & 0x10)
+		{
+			if (filled)
+				m_memory.fillRect(x0, y0, x1, y1, fg);
+			else
+				m_memory.drawRect(x0, y0, x1, y1, fg);
+			engineRun(filled ? EngineOp::FillRect : EngineOp::Rect, clippedPixels(filled ? w * h : 2 * (w + h), filled, x0, y0, x1, y1));
+		}
+		else if (dcr & 0x01)
+		{
+			int x2 = reg16(TFT_Register::DTPH0);
+			int y2 = reg16(TFT_Register::DTPV0);
+			if (filled)
+				m_memory.fillTriangle(x0, y0, x1, y1, x2, y2, fg);
+			else
+				m_memory.drawTriangle(x0, y0, x1, y1, x2, y2, fg);
+
+			int64_t area2 = std::abs(int64_t(x1 - x0) * (y2 - y0) - int64_t(x2 - x0) * (y1 - y0));
+			uint64_t edges = std::max(w, h) + uint64_t(std::max(std::abs(x2 - x1), std::abs(y2 - y1)))
+				+ uint64_t(std::max(std::abs(x0 - x2), std::abs(y0 - y2)));
+			engineRun(filled ? EngineOp::FillTriangle : EngineOp::Triangle,
+				clippedPixels(filled ? uint64_t(area2 / 2) + edges : edges, filled,
+					std::min(x0, std::min(x1, x2)), std::min(y0, std::min(y1, y2)),
+					std::max(x0, std::max(x1, x2)), std::max(y0, std::max(y1, y2))));
+		}
+		else
+		{
+			m_memory.drawLine(x0, y0, x1, y1, fg);
+			engineRun(EngineOp::Line, clippedPixels(std::max(w, h), false, x0, y0, x1, y1));
+		}
+	}
+
+	void RA8875Emulator::drawCircleEngine()
+	{
+		int cx = reg16(TFT_Register::DCHR0);
+		int cy = reg16(TFT_Register::DCVR0);
+		int r = m_regs[TFT_Register::DCRR];
+		uint16_t fg = color(TFT_Register::FGCR0);
+
+		bool filled = (m_regs[TFT_Register::DCR] & 0x20) != 0;
+
+		clipToActiveWindow();
+		if (filled)
+			m_memory.fillEllipse(cx, cy, r, r, fg);
+		else
+			m_memory.drawEllipse(cx, cy, r, r, fg);
+		engineRun(filled ? EngineOp::FillEllipse : EngineOp::Ellipse,
+			clippedPixels(ellipsePixels(r, r, filled, 4), filled, cx - r, cy - r, cx + r, cy + r));
+	}
+
+	void RA8875Emulator::drawEllipseEngine()
+	{
+		uint8_t ctrl = m_regs[TFT_Register::ELLIPSE];
+		bool filled = (ctrl & 0x40) != 0;
+		uint16_t fg = color(TFT_Register::FGCR0);
+
+		clipToActiveWindow();
+		if (ctrl & 0x20)
+		{
+			// Rounded rectangle; drawn with square corners.
+			int x0 = reg16(TFT_Register::DLHSR0);
+			int y0 = reg16(TFT_Register::DLVSR0);
+			int x1 = reg16(TFT_Register::DLHER0);
+			int y1 = reg16(TFT_Register::DLVER0);
+			if (filled)
+				m_memory.fillRect(x0, y0, x1, y1, fg);
+			else
+				m_memory.drawRect(x0, y0, x1, y1, fg);
+
+			uint64_t w = uint64_t(std::abs(x1 - x0)) + 1;
+			uint64_t h = uint64_t(std::abs(y1 - y0)) + 1;
+			engineRun(filled ? EngineOp::FillRect : EngineOp::Rect, clippedPixels(filled ? w * h : 2 * (w + h), filled, x0, y0, x1, y1));
+			return;
+		}
+
+		int cx = reg16(TFT_Register::DEHR0);
+		int cy = reg16(TFT_Register::DEVR0);
+		int a = reg16(TFT_Register::ELL_A0);
+		int b = reg16(TFT_Register::ELL_B0);
+		uint8_t quadrants = (ctrl & 0x10) ? uint8_t(1 << (ctrl & 0x03)) : uint8_t(Canvas::AllQuadrants);
+
+		if (filled)
+			m_memory.fillEllipse(cx, cy, a, b, fg, quadrants);
+		else
+			m_memory.drawEllipse(cx, cy, a, b, fg, quadrants);
+
+		// The box of the quadrants drawn.
+		int x0 = (quadrants & (Canvas::LowerLeft | Canvas::UpperLeft)) ? cx - a : cx;
+		int x1 = (quadrants & (Canvas::UpperRight | Canvas::LowerRight)) ? cx + a : cx;
+		int y0 = (quadrants & (Canvas::UpperLeft | Canvas::UpperRight)) ? cy - b : cy;
+		int y1 = (quadrants & (Canvas::LowerLeft | Canvas::LowerRight)) ? cy + b : cy;
+		engineRun(filled ? EngineOp::FillEllipse : EngineOp::Ellipse,
+			clippedPixels(ellipsePixels(a, b, filled, (ctrl & 0x10) ? 1 : 4), filled, x0, y0, x1, y1));
+	}
+
+	///
+	/// Approximate pixel count of an ellipse outline (Ramanujan) or area, for
+	/// 'quarters' of its four quadrants.
+	///
+	uint64_t RA8875Emulator::ellipsePixels(int a, int b, bool filled, int quarters)
+	{
+		const double pi = 3.14159265358979;
+		double full = filled
+			? pi * a * b
+			: pi * (3.0 * (a + b) - sqrt((3.0 * a + b) * (a + 3.0 * b)));
+		return uint64_t(full * quarters / 4) + 1;
+	}
+
+	///
+	/// 'pixels' of a shape within the box (x0,y0)-(x1,y1), scaled down to the
+	/// part of the box inside the clip window: the engine skips the rest.
+	/// Areas scale with the clipped area, lines and outlines with the
+	/// clipped width plus height.
+	///
+	uint64_t RA8875Emulator::clippedPixels(uint64_t pixels, bool filled, int x0, int y0, int x1, int y1) const
+	{
+		int64_t w = int64_t(std::abs(x1 - x0)) + 1;
+		int64_t h = int64_t(std::abs(y1 - y0)) + 1;
+		int64_t cw = std::min(std::max(x0, x1), m_memory.clipX1()) - std::max(std::min(x0, x1), m_memory.clipX0()) + 1;
+		int64_t ch = std::min(std::max(y0, y1), m_memory.clipY1()) - std::max(std::min(y0, y1), m_memory.clipY0()) + 1;
+		if (cw <= 0 || ch <= 0)
+			return 0;
+		double part = filled ? double(cw * ch) / double(w * h) : double(cw + ch) / double(w + h);
+		return part >= 1.0 ? pixels : uint64_t(double(pixels) * part);
+	}
+
+	void RA8875Emulator::memoryClear()
+	{
+		// Bit 6 limits the clear to the active window.
+		if (m_regs[TFT_Register::MCLR] & 0x40)
+			clipToActiveWindow();
+		else
+			m_memory.resetClip();
+		m_memory.fill(color(TFT_Register::BGCR0));
+
+		uint64_t w = uint64_t(std::max(m_memory.clipX1() - m_memory.clipX0() + 1, 0));
+		uint64_t h = uint64_t(std::max(m_memory.clipY1() - m_memory.clipY0() + 1, 0));
+		engineRun(EngineOp::Clear, w * h);
+	}
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "IDevice.h"
+#include "Canvas.h"
+#include "MpsseDecoder.h"
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+namespace hw
+{
+	///
+	/// An FT232H with an RA8875 attached, in memory.  Everything written is
+	/// decoded as MPSSE commands; SPI frames (delimited by chip select edges)
+	/// drive a model of the RA8875 register file, display memory and draw
+	/// engine, so RA8875 can be run and checked without hardware.
+	///
+	/// Modelled: register reads and writes, memory writes and reads through
+	/// MRWC (left to right, top to bottom within the active window), the
+	/// line/rectangle/triangle/circle/ellipse/curve engine, memory clear,
+	/// touch registers and interrupts.  The draw engine finishes instantly,
+	/// so the WAIT pin always reads ready.  There is no font ROM: internal
+	/// font characters are drawn as solid blocks in their 8x16 cells.
+	///
+	class RA8875Emulator : public IDevice, private MpsseDecoder::Listener
+	{
+	public:
+		// Draw engine operations, as reported to engineRun().
+		enum class EngineOp
+		{
+			Line, Rect, FillRect, Triangle, FillTriangle,
+			Ellipse, FillEllipse, Clear, Text,
+		};
+
+		struct Stats
+		{
+			size_t transfers;      // USB writes the FT232H would have seen
+			size_t reads;
+			size_t bytesWritten;
+			size_t bytesRead;
+			size_t frames;         // chip select pulses
+		};
+
+		RA8875Emulator(int width = 800, int height = 480, Pin cs = Pin::D3, Pin rst = Pin::D4, Pin wait = Pin::D5, Pin interrupt = Pin::D6);
+
+		RA8875Emulator(const RA8875Emulator&) = delete;
+		RA8875Emulator& operator=(const RA8875Emulator&) = delete;
+
+		bool open() override;
+		void close() override;
+
+		// GPIO access.
+		void      setPinDirection(Pin pin, Direction dir) override;
+		Direction getPinDirection(Pin pin) override;
+
+		void      setPinValue(Pin pin, bool value) override;
+		bool      getPinValue(Pin pin) override;
+		uint16_t  readPins() override;
+		size_t    encodePinValue(Pin pin, bool value, uint8_t* out) override;
+		bool      waitForPin(Pin pin, bool value) override;
+		bool      canWaitForPin(Pin pin) const override;
+
+		// MPSSE access.
+		void      setClock(int clock_hz, bool adaptive = false, bool three_phase = false) override;
+		size_t    encodeClock(int clock_hz, uint8_t* out) override;
+		int       write(const uint8_t* data, size_t length) override;
+		int       read(uint8_t* data, int expected, int timeOutInMs = 500) override;
+		bool      setLatencyTimer(int ms) override;
+		void      setLatencyProfile(LatencyProfile profile) override;
+		int       flush() override;
+		void      beginCapture() override;
+		void      endCapture(std::vector<uint8_t>& stream) override;
+		size_t    captured() const override { return m_capture.size(); }
+		TransferStats transferStats() const override;
+		void      resetTransferStats() override { resetStats(); }
+
+		// Same meaning as FT232H::setBuffered().
+		void      setBuffered(bool buffered);
+
+		// Emulator state.
+		const Canvas& display() const { return m_memory; }
+		bool      savePPM(const char* path) const { return m_memory.savePPM(path); }
+		uint8_t   reg(uint8_t reg) const { return m_regs[reg]; }
+		int       clockHz() const { return 30000000 / (1 + m_divisor); }
+		int       latencyTimerMs() const { return m_latencyMs; }
+		const Stats& stats() const { return m_stats; }
+		void      resetStats();
+
+		// Raw 10 bit touch panel readings; raises the touch interrupt when
+		// the panel is enabled.
+		void      touch(uint16_t x, uint16_t y);
+
+	protected:
+		// Chip side, called as SPI frames are decoded.
+		virtual void    chipReset();
+		virtual void    writeRegister(uint8_t reg, uint8_t value);
+		virtual uint8_t readRegister(uint8_t reg);
+		virtual uint8_t readStatus();
+
+		// The USB side: one bulk write of 'length' bytes.
+		virtual void    transfer(const uint8_t* data, size_t length);
+
+		// Hooks for models layered on the emulator, called while a transfer
+		// is decoded: bits shifted on the SPI bus, draw engine runs (with
+		// roughly the number of pixels touched), WAIT_ON_HIGH/LOW and
+		// SEND_IMMEDIATE commands.
+		virtual void    clocked(size_t /*bits*/) {}
+		virtual void    engineRun(EngineOp /*op*/, uint64_t /*pixels*/) {}
+		virtual void    waitPin() {}
+		virtual void    sendImmediate() {}
+
+		uint16_t  reg16(uint8_t reg) const { return uint16_t(m_regs[reg] | m_regs[reg + 1] << 8); }
+		void      setReg16(uint8_t reg, uint16_t value);
+		uint16_t  color(uint8_t reg) const;
+		void      clipToActiveWindow();
+
+	private:
+		// MpsseDecoder::Listener
+		void      onSetBits(int bank, uint8_t value, uint8_t direction) override;
+		uint8_t   onGetBits(int bank) override;
+		void      onClockDivisor(uint16_t divisor) override;
+		void      onShiftBegin(uint8_t opcode, size_t length) override;
+		uint8_t   onShiftByte(uint8_t opcode, uint8_t out) override;
+		void      onWaitPin(bool high) override;
+		void      onSendImmediate() override;
+
+		uint16_t  inputPins() const;
+		void      setupPin(Pin pin, Direction dir);
+		void      outputPin(Pin pin, bool value);
+		void      writeGpio();
+		uint8_t   spiByte(uint8_t out);
+		void      memoryWrite(uint8_t value);
+		uint8_t   memoryRead();
+		void      textWrite(uint8_t c);
+		void      drawLineEngine();
+		void      drawCircleEngine();
+		void      drawEllipseEngine();
+		void      memoryClear();
+		static uint64_t ellipsePixels(int a, int b, bool filled, int quarters);
+		uint64_t  clippedPixels(uint64_t pixels, bool filled, int x0, int y0, int x1, int y1) const;
+		static uint16_t pinToMask(Pin pin);
+
+	protected:
+		uint8_t       m_regs[256];
+		Canvas        m_memory;
+
+	private:
+		MpsseDecoder  m_decoder;
+		Pin           m_cs;
+		Pin           m_rst;
+		Pin           m_wait;
+		Pin           m_interrupt;
+		uint16_t      m_gpio_direction;   // as set by the host
+		uint16_t      m_gpio_values;
+		uint16_t      m_pinDirection;     // as applied by decoded commands
+		uint16_t      m_pinValues;
+		uint16_t      m_divisor;
+		int           m_latencyMs;
+
+		bool          m_buffered;
+		std::vector<uint8_t> m_buffer;
+		bool          m_capturing;
+		std::vector<uint8_t> m_capture;
+		std::vector<uint8_t> m_reply;
+		std::deque<uint8_t>  m_response;
+		Stats         m_stats;
+
+		// SPI frame state.
+		bool          m_selectedChip;
+		size_t        m_frameIndex;
+		uint8_t       m_prefix;
+		uint8_t       m_selected;
+		bool          m_pixelPending;
+		uint8_t       m_pixelHigh;
+		bool          m_readLow;
+	};
+}
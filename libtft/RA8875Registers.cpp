@@ -0,0 +1,183 @@
+#include "RA8875Registers.h"
+
+namespace hw
+{
+	// Generated from the TFT_Register enum; keep the two in step.
+	const char* registerName(uint8_t reg)
+	{
+		switch (reg)
+		{
+		case STSR: return "STSR";
+		case PWRR: return "PWRR";
+		case MRWC: return "MRWC";
+		case PCSR: return "PCSR";
+		case SROC: return "SROC";
+		case SFCLR: return "SFCLR";
+		case SYSR: return "SYSR";
+		case GPI: return "GPI";
+		case GPO: return "GPO";
+		case HDWR: return "HDWR";
+		case HNDFTR: return "HNDFTR";
+		case HNDR: return "HNDR";
+		case HSTR: return "HSTR";
+		case HPWR: return "HPWR";
+		case VDHR0: return "VDHR0";
+		case VDHR1: return "VDHR1";
+		case VNDR0: return "VNDR0";
+		case VNDR1: return "VNDR1";
+		case VSTR0: return "VSTR0";
+		case VSTR1: return "VSTR1";
+		case VPWR: return "VPWR";
+		case DPCR: return "DPCR";
+		case FNCR0: return "FNCR0";
+		case FNCR1: return "FNCR1";
+		case CGSR: return "CGSR";
+		case HOFS0: return "HOFS0";
+		case HOFS1: return "HOFS1";
+		case VOFS0: return "VOFS0";
+		case VOFS1: return "VOFS1";
+		case FLDR: return "FLDR";
+		case F_CURXL: return "F_CURXL";
+		case F_CURXH: return "F_CURXH";
+		case F_CURYL: return "F_CURYL";
+		case F_CURYH: return "F_CURYH";
+		case F_TSET: return "F_TSET";
+		case F_RSET: return "F_RSET";
+		case HSAW0: return "HSAW0";
+		case HSAW1: return "HSAW1";
+		case VSAW0: return "VSAW0";
+		case VSAW1: return "VSAW1";
+		case HEAW0: return "HEAW0";
+		case HEAW1: return "HEAW1";
+		case VEAW0: return "VEAW0";
+		case VEAW1: return "VEAW1";
+		case HSSW0: return "HSSW0";
+		case HSSW1: return "HSSW1";
+		case VSSW0: return "VSSW0";
+		case VSSW1: return "VSSW1";
+		case HESW0: return "HESW0";
+		case HESW1: return "HESW1";
+		case VESW0: return "VESW0";
+		case VESW1: return "VESW1";
+		case MWCR0: return "MWCR0";
+		case MWCR1: return "MWCR1";
+		case BTCR: return "BTCR";
+		case MRCD: return "MRCD";
+		case CURH0: return "CURH0";
+		case CURH1: return "CURH1";
+		case CURV0: return "CURV0";
+		case CURV1: return "CURV1";
+		case RCURH0: return "RCURH0";
+		case RCURH1: return "RCURH1";
+		case RCURV0: return "RCURV0";
+		case RCURV1: return "RCURV1";
+		case CURHS: return "CURHS";
+		case CURVS: return "CURVS";
+		case BECR0: return "BECR0";
+		case BECR1: return "BECR1";
+		case LTPR0: return "LTPR0";
+		case LTPR1: return "LTPR1";
+		case HSBE0: return "HSBE0";
+		case HSBE1: return "HSBE1";
+		case VSBE0: return "VSBE0";
+		case VSBE1: return "VSBE1";
+		case HDBE0: return "HDBE0";
+		case HDBE1: return "HDBE1";
+		case VDBE0: return "VDBE0";
+		case VDBE1: return "VDBE1";
+		case BEWR0: return "BEWR0";
+		case BEWR1: return "BEWR1";
+		case BEHR0: return "BEHR0";
+		case BEHR1: return "BEHR1";
+		case BGCR0: return "BGCR0";
+		case BGCR1: return "BGCR1";
+		case BGCR2: return "BGCR2";
+		case FGCR0: return "FGCR0";
+		case FGCR1: return "FGCR1";
+		case FGCR2: return "FGCR2";
+		case PTNO: return "PTNO";
+		case BGTR0: return "BGTR0";
+		case BGTR1: return "BGTR1";
+		case BGTR2: return "BGTR2";
+		case TPCR0: return "TPCR0";
+		case TPCR1: return "TPCR1";
+		case TPXH: return "TPXH";
+		case TPYH: return "TPYH";
+		case TPXYL: return "TPXYL";
+		case GCHP0: return "GCHP0";
+		case GCHP1: return "GCHP1";
+		case GCVP0: return "GCVP0";
+		case GCVP1: return "GCVP1";
+		case GCC0: return "GCC0";
+		case GCC1: return "GCC1";
+		case PLLC1: return "PLLC1";
+		case PLLC2: return "PLLC2";
+		case P1CR: return "P1CR";
+		case P1DCR: return "P1DCR";
+		case P2CR: return "P2CR";
+		case P2DCR: return "P2DCR";
+		case MCLR: return "MCLR";
+		case DCR: return "DCR";
+		case DLHSR0: return "DLHSR0";
+		case DLHSR1: return "DLHSR1";
+		case DLVSR0: return "DLVSR0";
+		case DLVSR1: return "DLVSR1";
+		case DLHER0: return "DLHER0";
+		case DLHER1: return "DLHER1";
+		case DLVER0: return "DLVER0";
+		case DLVER1: return "DLVER1";
+		case DCHR0: return "DCHR0";
+		case DCHR1: return "DCHR1";
+		case DCVR0: return "DCVR0";
+		case DCVR1: return "DCVR1";
+		case DCRR: return "DCRR";
+		case ELLIPSE: return "ELLIPSE";
+		case ELL_A0: return "ELL_A0";
+		case ELL_A1: return "ELL_A1";
+		case ELL_B0: return "ELL_B0";
+		case ELL_B1: return "ELL_B1";
+		case DEHR0: return "DEHR0";
+		case DEHR1: return "DEHR1";
+		case DEVR0: return "DEVR0";
+		case DEVR1: return "DEVR1";
+		case DTPH0: return "DTPH0";
+		case DTPH1: return "DTPH1";
+		case DTPV0: return "DTPV0";
+		case DTPV1: return "DTPV1";
+		case SSAR0: return "SSAR0";
+		case SSAR1: return "SSAR1";
+		case SSAR2: return "SSAR2";
+		case BWR0: return "BWR0";
+		case BWR1: return "BWR1";
+		case BHR0: return "BHR0";
+		case BHR1: return "BHR1";
+		case SPWR0: return "SPWR0";
+		case SPWR1: return "SPWR1";
+		case DMACR: return "DMACR";
+		case KSCR1: return "KSCR1";
+		case KSCR2: return "KSCR2";
+		case KSDR0: return "KSDR0";
+		case KSDR1: return "KSDR1";
+		case KSDR2: return "KSDR2";
+		case GPIOX: return "GPIOX";
+		case FWSAXA0: return "FWSAXA0";
+		case FWSAXA1: return "FWSAXA1";
+		case FWSAYA0: return "FWSAYA0";
+		case FWSAYA1: return "FWSAYA1";
+		case FWW0: return "FWW0";
+		case FWW1: return "FWW1";
+		case FWH0: return "FWH0";
+		case FWH1: return "FWH1";
+		case FWDXA0_: return "FWDXA0";
+		case FWDXA1_: return "FWDXA1";
+		case FWDYA0_: return "FWDYA0";
+		case FWDYA1_: return "FWDYA1";
+		case SACS_MODE: return "SACS_MODE";
+		case SACS_ADDR: return "SACS_ADDR";
+		case SACS_DATA: return "SACS_DATA";
+		case INTC1: return "INTC1";
+		case INTC2: return "INTC2";
+		default: return nullptr;
+		}
+	}
+}
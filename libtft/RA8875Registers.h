@@ -0,0 +1,187 @@
+#pragma once
+
+#include <stdint.h>
+
+//
+// RA8875 register addresses.  RA8875.h only forward declares the enum, so
+// code that needs the values (the driver itself, the emulator, tools)
+// includes this header.
+//
+enum TFT_Register : uint8_t {
+	STSR = 0x00, // Status Register
+	PWRR = 0x01, // Power and Display Control Register (PWRR)
+	MRWC = 0x02, // Memory Read/Write Command (MRWC)
+	PCSR = 0x04, // Pixel Clock Setting Register (PCSR)
+	SROC = 0x05, // Serial Flash/ROM Configuration Register (SROC)
+	SFCLR = 0x06, // Serial Flash/ROM CLK Setting Register(SFCLR)
+	SYSR = 0x10, // System Configuration Register (SYSR)
+	GPI = 0x12, // GPI
+	GPO = 0x13, // GPO
+	HDWR = 0x14, // LCD Horizontal Display Width Register (HDWR)
+	HNDFTR = 0x15, // Horizontal Non-Display Period Fine Tuning Option Register (HNDFTR)
+	HNDR = 0x16, // LCD Horizontal Non-Display Period Register (HNDR)
+	HSTR = 0x17, // HSYNC Start Position Register (HSTR)
+	HPWR = 0x18, // HSYNC Pulse Width Register (HPWR)
+	VDHR0 = 0x19, // LCD Vertical Display Height Register (VDHR0)
+	VDHR1 = 0x1A, // LCD Vertical Display Height Register0 (VDHR1)
+	VNDR0 = 0x1B, // LCD Vertical Non-Display Period Register (VNDR0)
+	VNDR1 = 0x1C, // LCD Vertical Non-Display Period Register (VNDR1)
+	VSTR0 = 0x1D, // VSYNC Start Position Register (VSTR0)
+	VSTR1 = 0x1E, // VSYNC Start Position Register (VSTR1)
+	VPWR = 0x1F, // VSYNC Pulse Width Register (VPWR)
+	DPCR = 0x20, // Display Configuration Register (DPCR)
+	FNCR0 = 0x21, // Font Control Register 0 (FNCR0)
+	FNCR1 = 0x22, // Font Control Register 1 (FNCR1)
+	CGSR = 0x23, // CGRAM Select Register (CGSR)
+	HOFS0 = 0x24, // Horizontal Scroll Offset Register 0 (HOFS0)
+	HOFS1 = 0x25, // Horizontal Scroll Offset Register 1 (HOFS1)
+	VOFS0 = 0x26, // Vertical Scroll Offset Register 0 (VOFS0)
+	VOFS1 = 0x27, // Vertical Scroll Offset Register 1 (VOFS1)
+	FLDR = 0x29, // Font Line Distance Setting Register (FLDR)
+	F_CURXL = 0x2A, // Font Write Cursor Horizontal Position Register 0 (F_CURXL)
+	F_CURXH = 0x2B, // Font Write Cursor Horizontal Position Register 1 (F_CURXH)
+	F_CURYL = 0x2C, // Font Write Cursor Vertical Position Register 0 (F_CURYL)
+	F_CURYH = 0x2D, // Font Write Cursor Vertical Position Register 1 (F_CURYH)
+	F_TSET = 0x2E, // Font Write Type Setting Register
+	F_RSET = 0x2F, // Serial Font ROM Setting
+	HSAW0 = 0x30, // Horizontal Start Point 0 of Active Window (HSAW0)
+	HSAW1 = 0x31, // Horizontal Start Point 1 of Active Window (HSAW1)
+	VSAW0 = 0x32, // Vertical Start Point 0 of Active Window (VSAW0)
+	VSAW1 = 0x33, // Vertical Start Point 1 of Active Window (VSAW1)
+	HEAW0 = 0x34, // Horizontal End Point 0 of Active Window (HEAW0)
+	HEAW1 = 0x35, // Horizontal End Point 1 of Active Window (HEAW1)
+	VEAW0 = 0x36, // Vertical End Point of Active Window 0 (VEAW0)
+	VEAW1 = 0x37, // Vertical End Point of Active Window 1 (VEAW1)
+	HSSW0 = 0x38, // Horizontal Start Point 0 of Scroll Window (HSSW0)
+	HSSW1 = 0x39, // Horizontal Start Point 1 of Scroll Window (HSSW1)
+	VSSW0 = 0x3A, // Vertical Start Point 0 of Scroll Window (VSSW0)
+	VSSW1 = 0x3B, // Vertical Start Point 1 of Scroll Window (VSSW1)
+	HESW0 = 0x3C, // Horizontal End Point 0 of Scroll Window (HESW0)
+	HESW1 = 0x3D, // Horizontal End Point 1 of Scroll Window (HESW1)
+	VESW0 = 0x3E, // Vertical End Point 0 of Scroll Window (VESW0)
+	VESW1 = 0x3F, // Vertical End Point 1 of Scroll Window (VESW1)
+	MWCR0 = 0x40, // Memory Write Control Register 0 (MWCR0)
+	MWCR1 = 0x41, // Memory Write Control Register1 (MWCR1)
+	BTCR = 0x44, // Blink Time Control Register (BTCR)
+	MRCD = 0x45, // Memory Read Cursor Direction (MRCD)
+	CURH0 = 0x46, // Memory Write Cursor Horizontal Position Register 0 (CURH0)
+	CURH1 = 0x47, // Memory Write Cursor Horizontal Position Register 1 (CURH1)
+	CURV0 = 0x48, // Memory Write Cursor Vertical Position Register 0 (CURV0)
+	CURV1 = 0x49, // Memory Write Cursor Vertical Position Register 1 (CURV1)
+	RCURH0 = 0x4A, // Memory Read Cursor Horizontal Position Register 0 (RCURH0)
+	RCURH1 = 0x4B, // Memory Read Cursor Horizontal Position Register 1 (RCURH1)
+	RCURV0 = 0x4C, // Memory Read Cursor Vertical Position Register 0 (RCURV0)
+	RCURV1 = 0x4D, // Memory Read Cursor Vertical Position Register 1 (RCURV1)
+	CURHS = 0x4E, // Font Write Cursor and Memory Write Cursor Horizontal Size Register (CURHS)
+	CURVS = 0x4F, // Font Write Cursor Vertical Size Register (CURVS)
+	BECR0 = 0x50, // BTE Function Control Register 0 (BECR0)
+	BECR1 = 0x51, // BTE Function Control Register1 (BECR1)
+	LTPR0 = 0x52, // Layer Transparency Register0 (LTPR0)
+	LTPR1 = 0x53, // Layer Transparency Register1 (LTPR1)
+	HSBE0 = 0x54, // Horizontal Source Point 0 of BTE (HSBE0)
+	HSBE1 = 0x55, // Horizontal Source Point 1 of BTE (HSBE1)
+	VSBE0 = 0x56, // Vertical Source Point 0 of BTE (VSBE0)
+	VSBE1 = 0x57, // Vertical Source Point 1 of BTE (VSBE1)
+	HDBE0 = 0x58, // Horizontal Destination Point 0 of BTE (HDBE0)
+	HDBE1 = 0x59, // Horizontal Destination Point 1 of BTE (HDBE1)
+	VDBE0 = 0x5A, // Vertical Destination Point 0 of BTE (VDBE0)
+	VDBE1 = 0x5B, // Vertical Destination Point 1 of BTE (VDBE1)
+	BEWR0 = 0x5C, // BTE Width Register 0 (BEWR0)
+	BEWR1 = 0x5D, // BTE Width Register 1 (BEWR1)
+	BEHR0 = 0x5E, // BTE Height Register 0 (BEHR0)
+	BEHR1 = 0x5F, // BTE Height Register 1 (BEHR1)
+	BGCR0 = 0x60, // Background Color Register 0 (BGCR0)
+	BGCR1 = 0x61, // Background Color Register 1 (BGCR1)
+	BGCR2 = 0x62, // Background Color Register 2 (BGCR2)
+	FGCR0 = 0x63, // Foreground Color Register 0 (FGCR0)
+	FGCR1 = 0x64, // Foreground Color Register 1 (FGCR1)
+	FGCR2 = 0x65, // Foreground Color Register 2 (FGCR2)
+	PTNO = 0x66, // Pattern Set No for BTE (PTNO)
+	BGTR0 = 0x67, // Background Color Register for Transparent 0 (BGTR0)
+	BGTR1 = 0x68, // Background Color Register for Transparent 1 (BGTR1)
+	BGTR2 = 0x69, // Background Color Register for Transparent 2 (BGTR2)
+	TPCR0 = 0x70, // Touch Panel Control Register 0 (TPCR0)
+	TPCR1 = 0x71, // Touch Panel Control Register 1 (TPCR1)
+	TPXH = 0x72, // Touch Panel X High Byte Data Register (TPXH)
+	TPYH = 0x73, // Touch Panel Y High Byte Data Register (TPYH)
+	TPXYL = 0x74, // Touch Panel X/Y Low Byte Data Register (TPXYL)
+	GCHP0 = 0x80, // Graphic Cursor Horizontal Position Register 0 (GCHP0)
+	GCHP1 = 0x81, // Graphic Cursor Horizontal Position Register 1 (GCHP1)
+	GCVP0 = 0x82, // Graphic Cursor Vertical Position Register 0 (GCVP0)
+	GCVP1 = 0x83, // Graphic Cursor Vertical Position Register 1 (GCVP1)
+	GCC0 = 0x84, // Graphic Cursor Color 0 (GCC0)
+	GCC1 = 0x85, // Graphic Cursor Color 1 (GCC1)
+	PLLC1 = 0x88, // PLL Control Register 1 (PLLC1)
+	PLLC2 = 0x89, // PLL Control Register 2 (PLLC2)
+	P1CR = 0x8A, // PWM1 Control Register (P1CR)
+	P1DCR = 0x8B, // PWM1 Duty Cycle Register (P1DCR)
+	P2CR = 0x8C, // PWM2 Control Register (P2CR)
+	P2DCR = 0x8D, // PWM2 Control Register (P2DCR)
+	MCLR = 0x8E, // Memory Clear Control Register (MCLR)
+	DCR = 0x90, // Draw Line/Circle/Square Control Register (DCR)
+	DLHSR0 = 0x91, // Draw Line/Square Horizontal Start Address Register0 (DLHSR0)
+	DLHSR1 = 0x92, // Draw Line/Square Horizontal Start Address Register1 (DLHSR1)
+	DLVSR0 = 0x93, // Draw Line/Square Vertical Start Address Register0 (DLVSR0)
+	DLVSR1 = 0x94, // Draw Line/Square Vertical Start Address Register1 (DLVSR1)
+	DLHER0 = 0x95, // Draw Line/Square Horizontal End Address Register0 (DLHER0)
+	DLHER1 = 0x96, // Draw Line/Square Horizontal End Address Register1 (DLHER1)
+	DLVER0 = 0x97, // Draw Line/Square Vertical End Address Register0 (DLVER0)
+	DLVER1 = 0x98, // Draw Line/Square Vertical End Address Register1 (DLVER1)
+	DCHR0 = 0x99, // Draw Circle Center Horizontal Address Register0 (DCHR0)
+	DCHR1 = 0x9A, // Draw Circle Center Horizontal Address Register1 (DCHR1)
+	DCVR0 = 0x9B, // Draw Circle Center Vertical Address Register0 (DCVR0)
+	DCVR1 = 0x9C, // Draw Circle Center Vertical Address Register1 (DCVR1)
+	DCRR = 0x9D, // Draw Circle Radius Register (DCRR)
+	ELLIPSE = 0xA0, // Draw Ellipse/Ellipse Curve/Circle Square Control Register
+	ELL_A0 = 0xA1, // Draw Ellipse/Circle Square Long axis Setting Register (ELL_A0)
+	ELL_A1 = 0xA2, // Draw Ellipse/Circle Square Long axis Setting Register (ELL_A1)
+	ELL_B0 = 0xA3, // Draw Ellipse/Circle Square Short axis Setting Register (ELL_B0)
+	ELL_B1 = 0xA4, // Draw Ellipse/Circle Square Short axis Setting Register (ELL_B1)
+	DEHR0 = 0xA5, // Draw Ellipse/Circle Square Center Horizontal Address Register0 (DEHR0)
+	DEHR1 = 0xA6, // Draw Ellipse/Circle Square Center Horizontal Address Register1 (DEHR1)
+	DEVR0 = 0xA7, // Draw Ellipse/Circle Square Center Vertical Address Register0 (DEVR0)
+	DEVR1 = 0xA8, // Draw Ellipse/Circle Square Center Vertical Address Register1 (DEVR1)
+	DTPH0 = 0xA9, // Draw Triangle Point 2 Horizontal Address Register0 (DTPH0)
+	DTPH1 = 0xAA, // Draw Triangle Point 2 Horizontal Address Register1 (DTPH1)
+	DTPV0 = 0xAB, // Draw Triangle Point 2 Vertical Address Register0 (DTPV0)
+	DTPV1 = 0xAC, // Draw Triangle Point 2 Vertical Address Register1 (DTPV1)
+	SSAR0 = 0xB0, // Source Starting Address REG0 (SSAR0)
+	SSAR1 = 0xB1, // Source Starting Address REG 1 (SSAR1)
+	SSAR2 = 0xB2, // Source Starting Address REG 2 (SSAR2)
+	BWR0 = 0xB4, // Block Width REG 0(BWR0) / DMA Transfer Number REG 0 (DTNR0)
+	BWR1 = 0xB5, // Block Width REG 1 (BWR1)
+	BHR0 = 0xB6, // Block Height REG 0(BHR0) /DMA Transfer Number REG 1 (DTNR1)
+	BHR1 = 0xB7, // Block Height REG 1 (BHR1)
+	SPWR0 = 0xB8, // Source Picture Width REG 0(SPWR0) / DMA Transfer Number REG 2(DTNR2)
+	SPWR1 = 0xB9, // Source Picture Width REG 1 (SPWR1)
+	DMACR = 0xBF, // DMA Configuration REG (DMACR)
+	KSCR1 = 0xC0, // Key-Scan Control Register 1 (KSCR1)
+	KSCR2 = 0xC1, // Key-Scan Controller Register 2 (KSCR2)
+	KSDR0 = 0xC2, // Key-Scan Data Register (KSDR0)
+	KSDR1 = 0xC3, // Key-Scan Data Register (KSDR1)
+	KSDR2 = 0xC4, // Key-Scan Data Register (KSDR2)
+	GPIOX = 0xC7, // Extra General Purpose IO Register (GPIOX)
+	FWSAXA0 = 0xD0, // Floating Windows Start Address XA 0 (FWSAXA0)
+	FWSAXA1 = 0xD1, // Floating Windows Start Address XA 1 (FWSAXA1)
+	FWSAYA0 = 0xD2, // Floating Windows Start Address YA 0 (FWSAYA0)
+	FWSAYA1 = 0xD3, // Floating Windows Start Address YA 1 (FWSAYA1)
+	FWW0 = 0xD4, // Floating Windows Width 0 (FWW0)
+	FWW1 = 0xD5, // Floating Windows Width 1 (FWW1)
+	FWH0 = 0xD6, // Floating Windows Height 0 (FWH0)
+	FWH1 = 0xD7, // Floating Windows Height 1 (FWH1)
+	FWDXA0_ = 0xD8, // Floating Windows Display X Address 0 (FWDXA0)
+	FWDXA1_ = 0xD9, // Floating Windows Display X Address 1 (FWDXA1)
+	FWDYA0_ = 0xDA, // Floating Windows Display Y Address 0 (FWDYA0)
+	FWDYA1_ = 0xDB, // Floating Windows Display Y Address 1 (FWDYA1)
+	SACS_MODE = 0xE0, // Serial Flash/ROM Direct Access Mode
+	SACS_ADDR = 0xE1, // Serial Flash/ROM Direct Access Mode Address
+	SACS_DATA = 0xE2, // Serial Flash/ROM Direct Access Data Read
+	INTC1 = 0xF0, // Interrupt Control Register1 (INTC1)
+	INTC2 = 0xF1, // Interrupt Control Register2 (INTC2)
+};
+
+namespace hw
+{
+	// The TFT_Register name for 'reg', or nullptr for unnamed addresses.
+	const char* registerName(uint8_t reg);
+}
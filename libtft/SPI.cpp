@@ -1,4 +1,5 @@
 #include "SPI.h"
+#include "Timeline.h"
 #include <stdio.h>
 #include <ftdi.h>
 
@@ -13,7 +14,16 @@ namespace hw
 		: m_device(&device)
 		, m_cs(cs)
 		, m_flags(0)
+		, m_payloadOffset(0)
+		, m_queuedRead(0)
+		, m_writeHz(max_speed_hz)
+		, m_readHz(max_speed_hz)
+		, m_currentHz(0)
 	{
+		// Room for the largest frame plus its clock, chip select and flush
+		// commands, so bulk writes never reallocate.
+		m_buffer.reserve(kMaxFrame + 32);
+
 		// D0=clock(output), D1=MOSI(output), D1=MISO(input)
 		m_device->setPinDirection(Pin::D0, Direction::Out);
 		m_device->setPinDirection(Pin::D1, Direction::Out);
@@ -36,6 +46,20 @@ namespace hw
 	void SPI::setClock(int hz) const
 	{
 		m_device->setClock(hz);
+		m_writeHz = hz;
+		m_readHz = hz;
+		m_currentHz = hz;
+	}
+
+	///
+	/// Use separate clocks for frames that only write and frames that read.
+	/// The switch is folded into the transaction's command buffer, so it
+	/// costs 3 bytes and no extra USB transfer.
+	///
+	void SPI::setClocks(int writeHz, int readHz) const
+	{
+		m_writeHz = writeHz;
+		m_readHz = readHz;
 	}
 
 
@@ -97,12 +121,8 @@ namespace hw
 	/// 
 	void SPI::write(const uint8_t* data, uint16_t length) const
 	{
-		m_device->setLow(m_cs);
-		m_device->writeByte(MPSSE_DO_WRITE | m_flags);
-		m_device->writeUInt16(length-1);
-		m_device->write(data, length);
-		m_device->writeByte(0x87);
-		m_device->setHigh(m_cs);
+		queueWrite(data, length);
+		submit();
 	}
 
 	/// 
@@ -111,13 +131,11 @@ namespace hw
 	/// 
 	int SPI::read(uint8_t* data, uint16_t length) const
 	{
-		m_device->setLow(m_cs);
-		m_device->writeByte(MPSSE_DO_READ | m_flags);
-		m_device->writeUInt16(length - 1);
-		m_device->writeByte(0x87);
-		m_device->setHigh(m_cs);
+		beginFrame(MPSSE_DO_READ | m_flags, length);
+		endFrame();
+		m_queuedRead += length;
 
-		return m_device->read(data, length);
+		return submit(data);
 	}
 
 	/// 
@@ -127,13 +145,118 @@ namespace hw
 	///
 	int SPI::transfer(const uint8_t* output, uint8_t* response, uint16_t length) const
 	{
-		m_device->setLow(m_cs);
-		m_device->writeByte(MPSSE_DO_WRITE | MPSSE_DO_READ | m_flags);
-		m_device->writeUInt16(length - 1);
-		m_device->write(output, length);
-		m_device->writeByte(0x87);
-		m_device->setHigh(m_cs);
+		queueTransfer(output, length);
+		return submit(response);
+	}
+
+	void SPI::queueWrite(const uint8_t* data, uint16_t length) const
+	{
+		beginFrame(MPSSE_DO_WRITE | m_flags, length);
+		m_buffer.insert(m_buffer.end(), data, data + length);
+		endFrame();
+	}
+
+	uint8_t* SPI::queueWriteInPlace(uint16_t length) const
+	{
+		beginFrame(MPSSE_DO_WRITE | m_flags, length);
+		size_t at = m_buffer.size();
+		m_buffer.resize(at + length);
+		endFrame();
+		return m_buffer.data() + at;
+	}
+
+	///
+	/// Encode the framing of a write frame without queueing one.  The chip
+	/// select ends high, as the device expects between frames.
+	///
+	SPI::WriteFraming SPI::writeFraming() const
+	{
+		WriteFraming f;
+		f.clockSize = m_device->encodeClock(m_writeHz, f.clock);
+		f.beginSize = m_device->encodePinValue(m_cs, false, f.begin);
+		f.begin[f.beginSize++] = uint8_t(MPSSE_DO_WRITE | m_flags);
+		f.endSize = m_device->encodePinValue(m_cs, true, f.end);
+		return f;
+	}
+
+	void SPI::queueTransfer(const uint8_t* output, uint16_t length) const
+	{
+		beginFrame(MPSSE_DO_WRITE | MPSSE_DO_READ | m_flags, length);
+		m_buffer.insert(m_buffer.end(), output, output + length);
+		endFrame();
+		m_queuedRead += length;
+	}
+
+	///
+	/// Hand all queued transactions to the device as a single write, so they
+	/// cost one USB bulk transfer instead of one per command, then collect
+	/// the responses of the queued transfers, if any.
+	///
+	int SPI::submit(uint8_t* response) const
+	{
+		TFT_TIMELINE_SCOPE("spi", "submit", "bytes", int64_t(m_buffer.size()));
+		m_buffer.push_back(SEND_IMMEDIATE);
+		m_device->write(m_buffer.data(), m_buffer.size());
+		m_buffer.clear();
+
+		int expected = static_cast<int>(m_queuedRead);
+		m_queuedRead = 0;
+		if (expected == 0)
+			return 0;
+
+		return m_device->read(response, expected);
+	}
+
+	bool SPI::beginSubmit(uint8_t* response) const
+	{
+		TFT_TIMELINE_SCOPE("spi", "beginSubmit", "bytes", int64_t(m_buffer.size()));
+		m_buffer.push_back(SEND_IMMEDIATE);
+		m_device->write(m_buffer.data(), m_buffer.size());
+		m_buffer.clear();
+
+		int expected = static_cast<int>(m_queuedRead);
+		m_queuedRead = 0;
+		return m_device->beginRead(response, expected);
+	}
+
+	bool SPI::pollSubmit(int& result) const
+	{
+		return m_device->pollRead(result);
+	}
+
+	///
+	/// Append a transaction to the scratch buffer: chip select low followed
+	/// by the clock command header for 'length' bytes.
+	///
+	void SPI::beginFrame(uint8_t command, uint16_t length) const
+	{
+		int hz = (command & MPSSE_DO_READ) ? m_readHz : m_writeHz;
+		if (hz != m_currentHz)
+		{
+			uint8_t clk[IDevice::kMaxClockCommand];
+			size_t n = m_device->encodeClock(hz, clk);
+			m_buffer.insert(m_buffer.end(), clk, clk + n);
+			m_currentHz = hz;
+		}
+
+		uint8_t cs[IDevice::kMaxPinCommand];
+		size_t n = m_device->encodePinValue(m_cs, false, cs);
+
+		m_buffer.insert(m_buffer.end(), cs, cs + n);
+		m_buffer.push_back(command);
+		m_buffer.push_back(uint8_t((length - 1) & 0xff));
+		m_buffer.push_back(uint8_t((length - 1) >> 8));
+		m_payloadOffset = m_buffer.size();
+	}
+
+	///
+	/// Close the transaction: chip select high.
+	///
+	void SPI::endFrame() const
+	{
+		uint8_t cs[IDevice::kMaxPinCommand];
+		size_t n = m_device->encodePinValue(m_cs, true, cs);
 
-		return m_device->read(response, length);
+		m_buffer.insert(m_buffer.end(), cs, cs + n);
 	}
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "IDevice.h"
+#include <vector>
 
 namespace hw
 {
@@ -10,6 +11,10 @@ namespace hw
 		SPI(IDevice& device, Pin cs, int max_speed_hz = 1000000, int mode = 0, bool lsbFirst = false);
 
 		void setClock(int hz) const;
+		void setClocks(int writeHz, int readHz) const;
+		int  writeClock() const { return m_writeHz; }
+		int  readClock() const { return m_readHz; }
+		void invalidateClock() const { m_currentHz = 0; }
 		void setMode(int mode);
 		void setBitOrder(bool lsbFirst);
 
@@ -17,9 +22,61 @@ namespace hw
 		int  read(uint8_t* data, uint16_t length) const;
 		int  transfer(const uint8_t* output, uint8_t* response, uint16_t length) const;
 
+		// Queued transactions: any number of frames, each with its own chip
+		// select pulse, sent together by submit().  The responses of all
+		// queued transfers come back in one read, in queue order.
+		void queueWrite(const uint8_t* data, uint16_t length) const;
+		void queueTransfer(const uint8_t* output, uint16_t length) const;
+		int  submit(uint8_t* response = nullptr) const;
+
+		// submit() in two steps, see IDevice::beginRead().  'response' must
+		// stay valid until pollSubmit() returns true.
+		bool beginSubmit(uint8_t* response) const;
+		bool pollSubmit(int& result) const;
+
+		// Queue a write frame of 'length' bytes and return where its payload
+		// goes, for bulk data built in place instead of copied.  The pointer
+		// is valid until the next call on this SPI.  The scratch buffer is
+		// preallocated for one frame of kMaxFrame bytes.
+		static const size_t kMaxFrame = 65535;
+		uint8_t* queueWriteInPlace(uint16_t length) const;
+
+		// Where the payload of the last transaction started within the bytes
+		// handed to the device.
+		size_t lastPayloadOffset() const { return m_payloadOffset; }
+
+		// The bytes around a write frame, for building command streams away
+		// from the SPI, e.g. on other threads: 'begin' (chip select low and
+		// the command) goes before the two length bytes and the payload,
+		// 'end' after.  A stream should start with 'clock', the write clock.
+		struct WriteFraming
+		{
+			uint8_t clock[IDevice::kMaxClockCommand];
+			size_t  clockSize;
+			uint8_t begin[IDevice::kMaxPinCommand + 1];
+			size_t  beginSize;
+			uint8_t end[IDevice::kMaxPinCommand];
+			size_t  endSize;
+		};
+		WriteFraming writeFraming() const;
+
+	private:
+		void beginFrame(uint8_t command, uint16_t length) const;
+		void endFrame() const;
+
 	private:
 		IDevice*    m_device;
 		Pin         m_cs;
 		uint8_t     m_flags;
+
+		// Scratch buffer holding the MPSSE commands of the current transaction.
+		mutable std::vector<uint8_t> m_buffer;
+		mutable size_t               m_payloadOffset;
+		mutable size_t               m_queuedRead;
+
+		// Frames that clock data in run at m_readHz, all others at m_writeHz.
+		mutable int                  m_writeHz;
+		mutable int                  m_readHz;
+		mutable int                  m_currentHz;
 	};
 }
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <vector>
+
+namespace hw
+{
+	///
+	/// Bounded lock-free queue for exactly one producer thread and one
+	/// consumer thread.  Storage is allocated once, at construction; the
+	/// capacity is rounded up to a power of two.
+	///
+	template <class T>
+	class SpscQueue
+	{
+	public:
+		explicit SpscQueue(size_t capacity)
+			: m_head(0)
+			, m_tail(0)
+		{
+			size_t size = 1;
+			while (size < capacity)
+				size <<= 1;
+			m_items.resize(size);
+			m_mask = size - 1;
+		}
+
+		SpscQueue(const SpscQueue&) = delete;
+		SpscQueue& operator=(const SpscQueue&) = delete;
+
+		// Producer side; false if the queue is full.
+		bool tryPush(const T& item)
+		{
+			size_t tail = m_tail.load(std::memory_order_relaxed);
+			if (tail - m_head.load(std::memory_order_acquire) > m_mask)
+				return false;
+			m_items[tail & m_mask] = item;
+			m_tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer side; false if the queue is empty.
+		bool tryPop(T& item)
+		{
+			size_t head = m_head.load(std::memory_order_relaxed);
+			if (head == m_tail.load(std::memory_order_acquire))
+				return false;
+			item = m_items[head & m_mask];
+			m_head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		bool empty() const
+		{
+			return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+		}
+
+	private:
+		std::vector<T> m_items;
+		size_t         m_mask;
+
+		// Apart, so the two threads don't share a cache line.
+		alignas(64) std::atomic<size_t> m_head;
+		alignas(64) std::atomic<size_t> m_tail;
+	};
+}
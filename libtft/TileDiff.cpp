@@ -0,0 +1,121 @@
+#include "TileDiff.h"
+#include "PixelFormat.h"
+
+#include <algorithm>
+
+namespace hw
+{
+	TileDiff::TileDiff()
+		: m_width(0)
+		, m_height(0)
+		, m_cols(0)
+		, m_rows(0)
+		, m_valid(false)
+	{
+	}
+
+	void TileDiff::reset(int width, int height)
+	{
+		m_width = width;
+		m_height = height;
+		m_cols = (width + kTileWidth - 1) / kTileWidth;
+		m_rows = (height + kTileHeight - 1) / kTileHeight;
+		m_hashes.assign(size_t(m_cols) * m_rows, 0);
+		m_changed.assign(m_hashes.size(), 0);
+		m_valid = false;
+	}
+
+	size_t TileDiff::diff(const uint16_t* frame, size_t strideBytes, std::vector<Framebuffer::Rect>& changed)
+	{
+		size_t count = hashRows(frame, strideBytes, 0, m_rows);
+		collect(changed);
+		return count;
+	}
+
+	size_t TileDiff::hashRows(const uint16_t* frame, size_t strideBytes, int first, int last)
+	{
+		const uint8_t* base = reinterpret_cast<const uint8_t*>(frame);
+
+		size_t count = 0;
+		for (int ty = first; ty < last; ++ty)
+		{
+			const int y = ty * kTileHeight;
+			const size_t rows = size_t(std::min(int(kTileHeight), m_height - y));
+			for (int tx = 0; tx < m_cols; ++tx)
+			{
+				const int x = tx * kTileWidth;
+				const size_t rowBytes = size_t(std::min(int(kTileWidth), m_width - x)) * 2;
+				const size_t i = size_t(ty) * m_cols + tx;
+
+				uint64_t h = hashPixels(base + y * strideBytes + x * 2, rowBytes, rows, strideBytes);
+				bool differs = !m_valid || h != m_hashes[i];
+				m_hashes[i] = h;
+				m_changed[i] = differs;
+				count += differs;
+			}
+		}
+		return count;
+	}
+
+	void TileDiff::collect(std::vector<Framebuffer::Rect>& changed)
+	{
+		size_t runs = 0;
+		for (size_t i = 0; i < m_changed.size(); ++i)
+			runs += m_changed[i] && (i % m_cols == 0 || !m_changed[i - 1]);
+		m_valid = true;
+
+		changed.clear();
+		for (int ty = 0; ty < m_rows; ++ty)
+			addRuns(ty, runs > kMaxRuns, changed);
+	}
+
+	/*
+	 * Append tile row 'row' to 'changed', extending a region from the row
+	 * above when its run has the same columns.  With 'span' the row is a
+	 * single run from its first changed tile to its last.
+	 */
+	void TileDiff::addRuns(int row, bool span, std::vector<Framebuffer::Rect>& changed) const
+	{
+		const uint8_t* tiles = &m_changed[size_t(row) * m_cols];
+		const int y0 = row * kTileHeight;
+		const int y1 = std::min(y0 + kTileHeight, m_height) - 1;
+
+		for (int tx = 0; tx < m_cols; )
+		{
+			if (!tiles[tx])
+			{
+				++tx;
+				continue;
+			}
+
+			int end = tx + 1;
+			if (span)
+			{
+				for (int j = end; j < m_cols; ++j)
+					if (tiles[j])
+						end = j + 1;
+			}
+			else
+			{
+				while (end < m_cols && tiles[end])
+					++end;
+			}
+
+			Framebuffer::Rect r = { tx * kTileWidth, y0, std::min(end * kTileWidth, m_width) - 1, y1 };
+			bool extended = false;
+			for (size_t i = 0; i < changed.size(); ++i)
+			{
+				Framebuffer::Rect& above = changed[i];
+				if (above.y1 + 1 == y0 && above.x0 == r.x0 && above.x1 == r.x1)
+				{
+					above.y1 = y1;
+					extended = true;
+					break;
+				}
+			}
+			if (!extended)
+				changed.push_back(r);
+			tx = end;
+		}
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Framebuffer.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace hw
+{
+	///
+	/// Finds what changed between whole frames by hashing them in tiles
+	/// and comparing each tile's hash with the one from the frame before.
+	/// Memory is one hash per tile, not a copy of the frame.
+	///
+	class TileDiff
+	{
+	public:
+		static const int kTileWidth = 32;
+		static const int kTileHeight = 16;
+
+		TileDiff();
+
+		// Size the grid and forget the last frame.
+		void      reset(int width, int height);
+		// The next frame is reported as changed everywhere.
+		void      invalidate() { m_valid = false; }
+		int       width() const { return m_width; }
+		int       height() const { return m_height; }
+
+		///
+		/// Hash a host order RGB565 frame, 'strideBytes' between rows, and
+		/// set 'changed' to the tiles that differ from the last frame,
+		/// joined into runs along each tile row and then down equal runs.
+		/// Returns the number of changed tiles.
+		///
+		size_t    diff(const uint16_t* frame, size_t strideBytes, std::vector<Framebuffer::Rect>& changed);
+
+		///
+		/// diff() in two steps, for hashing bands of tile rows on several
+		/// threads: hashRows() compares tile rows [first, last) and returns
+		/// their changed tiles, collect() joins all rows into 'changed'.
+		///
+		int       tileRows() const { return m_rows; }
+		size_t    hashRows(const uint16_t* frame, size_t strideBytes, int first, int last);
+		void      collect(std::vector<Framebuffer::Rect>& changed);
+
+	private:
+		// Past this many runs each tile row is taken as one span.
+		static const size_t kMaxRuns = 64;
+
+		void      addRuns(int row, bool span, std::vector<Framebuffer::Rect>& changed) const;
+
+	private:
+		int       m_width;
+		int       m_height;
+		int       m_cols;
+		int       m_rows;
+		bool      m_valid;
+		std::vector<uint64_t> m_hashes;
+		std::vector<uint8_t>  m_changed;
+	};
+}
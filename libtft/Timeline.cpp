@@ -0,0 +1,151 @@
+#include "Timeline.h"
+#include <stdio.h>
+#include <thread>
+
+namespace hw
+{
+	std::atomic<Timeline*> Timeline::s_active(nullptr);
+	std::atomic<int>       Timeline::s_open(0);
+
+	static int64_t steadyNs()
+	{
+		using namespace std::chrono;
+		return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+	}
+
+	Timeline::Timeline(size_t maxEvents)
+		: m_origin(steadyNs())
+		, m_maxEvents(maxEvents)
+		, m_dropped(0)
+	{
+	}
+
+	Timeline::~Timeline()
+	{
+		stop();
+	}
+
+	void Timeline::start()
+	{
+		s_active.store(this);
+	}
+
+	///
+	/// Scopes opened before the timeline went inactive may still be about to
+	/// record; wait them out.  The count covers every timeline, which only
+	/// makes the wait longer in the rare case another one was started since.
+	///
+	void Timeline::stop()
+	{
+		Timeline* self = this;
+		s_active.compare_exchange_strong(self, nullptr);
+		while (s_open.load() != 0)
+			std::this_thread::yield();
+	}
+
+	///
+	/// Count the scope as open before reading the active timeline again: if
+	/// that read still finds one, stop() can't have passed its own check of
+	/// the count yet, and will wait for leave().
+	///
+	Timeline* Timeline::enter()
+	{
+		if (s_active.load(std::memory_order_relaxed) == nullptr)
+			return nullptr;
+
+		s_open.fetch_add(1);
+		Timeline* timeline = s_active.load();
+		if (timeline == nullptr)
+			s_open.fetch_sub(1);
+		return timeline;
+	}
+
+	void Timeline::leave()
+	{
+		s_open.fetch_sub(1);
+	}
+
+	void Timeline::clear()
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_spans.clear();
+		m_dropped = 0;
+		m_origin.store(steadyNs());
+	}
+
+	size_t Timeline::size() const
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		return m_spans.size();
+	}
+
+	uint64_t Timeline::now() const
+	{
+		int64_t ns = steadyNs() - m_origin.load(std::memory_order_relaxed);
+		return ns > 0 ? uint64_t(ns) : 0;
+	}
+
+	///
+	/// Small per thread numbers, in order of first use, read better in the
+	/// viewer than hashed thread ids.
+	///
+	uint32_t Timeline::threadIndex()
+	{
+		static std::atomic<uint32_t> next(1);
+		static thread_local uint32_t index = 0;
+		if (index == 0)
+			index = next++;
+		return index;
+	}
+
+	void Timeline::span(const char* category, const char* name, uint64_t startNs, uint64_t endNs, const char* argName, int64_t arg)
+	{
+		Span s;
+		s.category = category;
+		s.name = name;
+		s.argName = argName;
+		s.arg = arg;
+		s.startNs = startNs;
+		s.durationNs = endNs > startNs ? endNs - startNs : 0;
+		s.thread = threadIndex();
+
+		std::lock_guard<std::mutex> lock(m_lock);
+		if (m_spans.size() >= m_maxEvents)
+		{
+			m_dropped++;
+			return;
+		}
+		m_spans.push_back(s);
+	}
+
+	///
+	/// Complete ("X") events with microsecond timestamps.  Names are written
+	/// as is; they are identifiers from the library.
+	///
+	bool Timeline::save(const char* path) const
+	{
+		FILE* f = fopen(path, "w");
+		if (f == nullptr)
+		{
+			fprintf(stderr, "Unable to write timeline %s\n", path);
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(m_lock);
+		fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+		for (size_t i = 0; i < m_spans.size(); ++i)
+		{
+			const Span& s = m_spans[i];
+			fprintf(f, "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u",
+				s.name, s.category, s.startNs / 1000.0, s.durationNs / 1000.0, s.thread);
+			if (s.argName != nullptr)
+				fprintf(f, ",\"args\":{\"%s\":%lld}", s.argName, (long long)s.arg);
+			fprintf(f, "}%s\n", i + 1 < m_spans.size() ? "," : "");
+		}
+		fprintf(f, "],\"otherData\":{\"dropped\":%zu}}\n", m_dropped);
+
+		bool ok = ferror(f) == 0;
+		fclose(f);
+		return ok;
+	}
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace hw
+{
+	///
+	/// Opt-in span recorder.  While a Timeline is active, every
+	/// TimelineScope in the library (RA8875 calls, register access, SPI
+	/// transactions, FT232H transfers and reads) adds a span to it; save()
+	/// writes them as Chrome trace_event JSON, which chrome://tracing and
+	/// Perfetto show as a nested timeline per thread.
+	///
+	/// With no active timeline a scope costs one atomic load.
+	///
+	/// stop(), and so the destructor, waits until scopes open on other
+	/// threads have closed, so don't call it from inside a scope.
+	///
+	class Timeline
+	{
+	public:
+		// At most maxEvents spans are kept; later ones are counted as dropped.
+		explicit Timeline(size_t maxEvents = 1000000);
+		~Timeline();
+
+		Timeline(const Timeline&) = delete;
+		Timeline& operator=(const Timeline&) = delete;
+
+		// The timeline scopes record to, or nullptr.
+		static Timeline* active() { return s_active.load(std::memory_order_relaxed); }
+		void      start();
+		// No scope records to this timeline once stop() returns.
+		void      stop();
+
+		void      clear();
+		size_t    size() const;
+		size_t    dropped() const { return m_dropped; }
+		bool      save(const char* path) const;
+
+		// Nanoseconds since construction or clear().  Spans open across a
+		// clear() are kept with zero duration.
+		uint64_t  now() const;
+
+		// 'category', 'name' and 'argName' must outlive the timeline,
+		// e.g. string literals.
+		void      span(const char* category, const char* name, uint64_t startNs, uint64_t endNs,
+		               const char* argName = nullptr, int64_t arg = 0);
+
+	private:
+		struct Span
+		{
+			const char* category;
+			const char* name;
+			const char* argName;
+			int64_t     arg;
+			uint64_t    startNs;
+			uint64_t    durationNs;
+			uint32_t    thread;
+		};
+
+		static uint32_t threadIndex();
+
+		// Scopes hold the active timeline between enter() and leave().
+		static Timeline* enter();
+		static void      leave();
+
+		friend class TimelineScope;
+
+	private:
+		static std::atomic<Timeline*> s_active;
+		static std::atomic<int>       s_open;
+
+		std::atomic<int64_t> m_origin;      // steady_clock, in nanoseconds
+		size_t              m_maxEvents;
+		size_t              m_dropped;
+		mutable std::mutex  m_lock;
+		std::vector<Span>   m_spans;
+	};
+
+	///
+	/// Records a span from construction to destruction on the active
+	/// timeline, if there is one.
+	///
+	class TimelineScope
+	{
+	public:
+		TimelineScope(const char* category, const char* name, const char* argName = nullptr, int64_t arg = 0)
+			: m_timeline(Timeline::enter())
+			, m_category(category)
+			, m_name(name)
+			, m_argName(argName)
+			, m_arg(arg)
+			, m_start(m_timeline != nullptr ? m_timeline->now() : 0)
+		{
+		}
+
+		~TimelineScope()
+		{
+			if (m_timeline != nullptr)
+			{
+				m_timeline->span(m_category, m_name, m_start, m_timeline->now(), m_argName, m_arg);
+				Timeline::leave();
+			}
+		}
+
+		TimelineScope(const TimelineScope&) = delete;
+		TimelineScope& operator=(const TimelineScope&) = delete;
+
+	private:
+		Timeline*   m_timeline;
+		const char* m_category;
+		const char* m_name;
+		const char* m_argName;
+		int64_t     m_arg;
+		uint64_t    m_start;
+	};
+}
+
+#define TFT_TIMELINE_CAT2(a, b) a##b
+#define TFT_TIMELINE_CAT(a, b)  TFT_TIMELINE_CAT2(a, b)
+
+// A span covering the rest of the enclosing block.
+#define TFT_TIMELINE_SCOPE(...) hw::TimelineScope TFT_TIMELINE_CAT(timelineScope_, __LINE__)(__VA_ARGS__)
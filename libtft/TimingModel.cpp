@@ -0,0 +1,139 @@
+#include "TimingModel.h"
+#include "RA8875Registers.h"
+
+namespace hw
+{
+	TimingModel::TimingModel(const Costs& costs, int width, int height)
+		: RA8875Emulator(width, height)
+		, m_costs(costs)
+	{
+		resetTime();
+	}
+
+	TimingModel::Costs TimingModel::defaultCosts()
+	{
+		Costs c;
+		c.transferUs = 125.0;      // one high speed microframe
+		c.usbByteNs = 25.0;        // ~40MB/s bulk throughput
+		c.readUs = 250.0;          // bulk IN poll plus host wakeup
+		c.engineSetupNs = 200.0;
+		c.outlinePixelNs = 36.0;   // 2 system clocks per pixel
+		c.fillPixelNs = 18.0;      // 1 system clock per pixel
+		return c;
+	}
+
+	void TimingModel::resetTime()
+	{
+		m_breakdown = Breakdown();
+		m_nowUs = 0;
+		m_engineDoneUs = 0;
+		m_pushed = false;
+		m_polled = false;
+	}
+
+	void TimingModel::transfer(const uint8_t* data, size_t length)
+	{
+		double usb = m_costs.transferUs + length * m_costs.usbByteNs / 1000.0;
+		m_nowUs += usb;
+		m_breakdown.usbUs += usb;
+
+		RA8875Emulator::transfer(data, length);
+	}
+
+	///
+	/// A read costs a round trip.  Without SEND_IMMEDIATE the FT232H holds
+	/// the reply until its latency timer expires.  If the host was polling
+	/// the engine, it keeps polling until the engine is done.
+	///
+	int TimingModel::read(uint8_t* data, int expected, int timeOutInMs)
+	{
+		int ret = RA8875Emulator::read(data, expected, timeOutInMs);
+
+		if (m_polled)
+			waitEngine();
+
+		double wait = m_costs.readUs;
+		if (!m_pushed)
+			wait += latencyTimerMs() * 1000.0;
+		m_nowUs += wait;
+		m_breakdown.readUs += wait;
+		m_breakdown.reads++;
+
+		m_pushed = false;
+		m_polled = false;
+		return ret;
+	}
+
+	uint8_t TimingModel::readRegister(uint8_t reg)
+	{
+		switch (reg)
+		{
+		case TFT_Register::DCR:
+		case TFT_Register::ELLIPSE:
+		case TFT_Register::MCLR:
+		case TFT_Register::DMACR:
+			m_polled = true;
+			break;
+		default:
+			break;
+		}
+		return RA8875Emulator::readRegister(reg);
+	}
+
+	uint8_t TimingModel::readStatus()
+	{
+		m_polled = true;
+		return RA8875Emulator::readStatus();
+	}
+
+	void TimingModel::clocked(size_t bits)
+	{
+		double spi = bits * 1e6 / clockHz();
+		m_nowUs += spi;
+		m_breakdown.spiUs += spi;
+	}
+
+	void TimingModel::engineRun(EngineOp op, uint64_t pixels)
+	{
+		// The engine takes one operation at a time.
+		waitEngine();
+
+		double perPixel = m_costs.fillPixelNs;
+		switch (op)
+		{
+		case EngineOp::Line:
+		case EngineOp::Rect:
+		case EngineOp::Triangle:
+		case EngineOp::Ellipse:
+			perPixel = m_costs.outlinePixelNs;
+			break;
+		default:
+			break;
+		}
+
+		double busy = (m_costs.engineSetupNs + pixels * perPixel) / 1000.0;
+		m_engineDoneUs = m_nowUs + busy;
+		m_breakdown.engineBusyUs += busy;
+		m_breakdown.engineOps++;
+	}
+
+	void TimingModel::waitPin()
+	{
+		// The FT232H stops processing commands until WAIT# goes high.
+		waitEngine();
+	}
+
+	void TimingModel::sendImmediate()
+	{
+		m_pushed = true;
+	}
+
+	void TimingModel::waitEngine()
+	{
+		if (m_engineDoneUs > m_nowUs)
+		{
+			m_breakdown.engineWaitUs += m_engineDoneUs - m_nowUs;
+			m_nowUs = m_engineDoneUs;
+		}
+	}
+}
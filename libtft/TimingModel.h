@@ -0,0 +1,79 @@
+#pragma once
+
+#include "RA8875Emulator.h"
+
+namespace hw
+{
+	///
+	/// RA8875Emulator that also predicts how long the traffic it sees would
+	/// take on real hardware: USB transfer overhead, command bytes over USB,
+	/// SPI clocking at the current TCK divisor, read turnarounds (including
+	/// the latency timer when a read isn't pushed with SEND_IMMEDIATE) and
+	/// draw engine time per primitive and area inside the active window.
+	///
+	/// The engine runs concurrently with the host; the prediction only waits
+	/// for it when the stream does (a status poll, or a WAIT pin command).
+	/// Host side delays such as RA8875::delay() are not included.
+	///
+	class TimingModel : public RA8875Emulator
+	{
+	public:
+		// Times in microseconds unless noted.
+		struct Costs
+		{
+			double transferUs;        // fixed cost per USB bulk write
+			double usbByteNs;         // per byte of a bulk write
+			double readUs;            // round trip of a read pushed with SEND_IMMEDIATE
+			double engineSetupNs;     // per draw engine operation
+			double outlinePixelNs;    // lines and outlines
+			double fillPixelNs;       // filled shapes, memory clear and text cells
+		};
+
+		// Where the predicted time went.
+		struct Breakdown
+		{
+			double usbUs;
+			double spiUs;
+			double readUs;            // read turnarounds, incl. latency timer waits
+			double engineWaitUs;      // host stalled on the draw engine
+			double engineBusyUs;      // engine run time, overlapped or not
+			size_t reads;
+			size_t engineOps;
+		};
+
+		explicit TimingModel(const Costs& costs = defaultCosts(), int width = 800, int height = 480);
+
+		// Rough FT232H on USB 2.0 high speed with the RA8875 at 55MHz.
+		static Costs defaultCosts();
+
+		const Costs& costs() const { return m_costs; }
+		void      setCosts(const Costs& costs) { m_costs = costs; }
+
+		// Predicted wall clock time since construction or the last reset.
+		double    elapsedUs() const { return m_nowUs; }
+		const Breakdown& breakdown() const { return m_breakdown; }
+		void      resetTime();
+
+		int       read(uint8_t* data, int expected, int timeOutInMs = 500) override;
+
+	protected:
+		void      transfer(const uint8_t* data, size_t length) override;
+		uint8_t   readRegister(uint8_t reg) override;
+		uint8_t   readStatus() override;
+		void      clocked(size_t bits) override;
+		void      engineRun(EngineOp op, uint64_t pixels) override;
+		void      waitPin() override;
+		void      sendImmediate() override;
+
+	private:
+		void      waitEngine();
+
+	private:
+		Costs     m_costs;
+		Breakdown m_breakdown;
+		double    m_nowUs;
+		double    m_engineDoneUs;
+		bool      m_pushed;     // SEND_IMMEDIATE since the last read
+		bool      m_polled;     // engine status read since the last read
+	};
+}
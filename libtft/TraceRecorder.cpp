@@ -0,0 +1,346 @@
+#include "TraceRecorder.h"
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+namespace hw
+{
+	// File layout:
+	//   "RA8875TR" u32 version (little endian)
+	//   records until the end of the file, each:
+	//     u8 kind, varint start (ns after the previous record's start),
+	//     varint duration (ns), varint arg, varint length, length bytes
+	// Varints are LEB128: 7 bits per byte, low bits first, high bit set on
+	// all but the last byte.
+	static const char     kMagic[8] = { 'R', 'A', '8', '8', '7', '5', 'T', 'R' };
+	static const uint32_t kVersion  = 1;
+
+	static bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& value)
+	{
+		value = 0;
+		for (int shift = 0; p < end && shift < 64; shift += 7)
+		{
+			uint8_t b = *p++;
+			value |= uint64_t(b & 0x7F) << shift;
+			if ((b & 0x80) == 0)
+				return true;
+		}
+		return false;
+	}
+
+	TraceRecorder::TraceRecorder(IDevice& device)
+		: m_device(&device)
+		, m_splitData(nullptr)
+		, m_splitExpected(0)
+		, m_splitFinished(false)
+		, m_splitResult(0)
+	{
+		clear();
+	}
+
+	void TraceRecorder::clear()
+	{
+		m_trace.clear();
+		m_origin = Clock::now();
+		m_lastNs = 0;
+	}
+
+	void TraceRecorder::mark(const char* label)
+	{
+		record(Kind::Mark, Clock::now(), 0, reinterpret_cast<const uint8_t*>(label), strlen(label));
+	}
+
+	void TraceRecorder::putVarint(uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			m_trace.push_back(uint8_t(value | 0x80));
+			value >>= 7;
+		}
+		m_trace.push_back(uint8_t(value));
+	}
+
+	void TraceRecorder::record(Kind kind, Clock::time_point start, uint32_t arg, const uint8_t* data, size_t length)
+	{
+		using namespace std::chrono;
+		uint64_t startNs = duration_cast<nanoseconds>(start - m_origin).count();
+		uint64_t endNs = duration_cast<nanoseconds>(Clock::now() - m_origin).count();
+		// A split read is recorded when it completes, after calls that
+		// started later.
+		if (startNs < m_lastNs)
+			startNs = m_lastNs;
+
+		m_trace.push_back(uint8_t(kind));
+		putVarint(startNs - m_lastNs);
+		putVarint(endNs - startNs);
+		putVarint(arg);
+		putVarint(length);
+		if (length > 0)
+			m_trace.insert(m_trace.end(), data, data + length);
+		m_lastNs = startNs;
+	}
+
+	bool TraceRecorder::save(const char* path) const
+	{
+		FILE* f = fopen(path, "wb");
+		if (f == nullptr)
+		{
+			fprintf(stderr, "Unable to write trace %s\n", path);
+			return false;
+		}
+
+		uint8_t version[] = { uint8_t(kVersion), uint8_t(kVersion >> 8), uint8_t(kVersion >> 16), uint8_t(kVersion >> 24) };
+		bool ok = fwrite(kMagic, 1, sizeof(kMagic), f) == sizeof(kMagic)
+			&& fwrite(version, 1, sizeof(version), f) == sizeof(version)
+			&& fwrite(m_trace.data(), 1, m_trace.size(), f) == m_trace.size();
+
+		fclose(f);
+		return ok;
+	}
+
+	bool TraceRecorder::load(const char* path, std::vector<Event>& events)
+	{
+		events.clear();
+
+		FILE* f = fopen(path, "rb");
+		if (f == nullptr)
+		{
+			fprintf(stderr, "Unable to read trace %s\n", path);
+			return false;
+		}
+
+		std::vector<uint8_t> file;
+		uint8_t chunk[4096];
+		size_t n;
+		while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+			file.insert(file.end(), chunk, chunk + n);
+		fclose(f);
+
+		const uint8_t* p = file.data();
+		const uint8_t* end = p + file.size();
+		bool ok = file.size() >= sizeof(kMagic) + 4
+			&& memcmp(p, kMagic, sizeof(kMagic)) == 0
+			&& uint32_t(p[8] | p[9] << 8 | p[10] << 16 | p[11] << 24) == kVersion;
+		p += sizeof(kMagic) + 4;
+
+		uint64_t now = 0;
+		while (ok && p < end)
+		{
+			Event e;
+			uint64_t delta, arg, length;
+			e.kind = Kind(*p++);
+			ok = e.kind <= Kind::Mark
+				&& getVarint(p, end, delta)
+				&& getVarint(p, end, e.durationNs)
+				&& getVarint(p, end, arg)
+				&& getVarint(p, end, length)
+				&& length <= uint64_t(end - p);
+			if (!ok)
+				break;
+
+			now += delta;
+			e.startNs = now;
+			e.arg = uint32_t(arg);
+			e.data.assign(p, p + length);
+			p += length;
+			events.push_back(std::move(e));
+		}
+
+		if (!ok)
+		{
+			fprintf(stderr, "Malformed trace %s\n", path);
+			events.clear();
+		}
+		return ok;
+	}
+
+	bool TraceRecorder::open()
+	{
+		Clock::time_point start = Clock::now();
+		bool ok = m_device->open();
+		record(Kind::Open, start, ok);
+		return ok;
+	}
+
+	void TraceRecorder::close()
+	{
+		Clock::time_point start = Clock::now();
+		m_device->close();
+		record(Kind::Close, start, 0);
+	}
+
+	void TraceRecorder::setPinDirection(Pin pin, Direction dir)
+	{
+		Clock::time_point start = Clock::now();
+		m_device->setPinDirection(pin, dir);
+		record(Kind::PinDirection, start, uint32_t(pin) << 1 | (dir == Direction::Out));
+	}
+
+	Direction TraceRecorder::getPinDirection(Pin pin)
+	{
+		return m_device->getPinDirection(pin);
+	}
+
+	void TraceRecorder::setPinValue(Pin pin, bool value)
+	{
+		Clock::time_point start = Clock::now();
+		m_device->setPinValue(pin, value);
+		record(Kind::SetPin, start, uint32_t(pin) << 1 | value);
+	}
+
+	bool TraceRecorder::getPinValue(Pin pin)
+	{
+		Clock::time_point start = Clock::now();
+		bool value = m_device->getPinValue(pin);
+		record(Kind::GetPin, start, uint32_t(pin) << 1 | value);
+		return value;
+	}
+
+	uint16_t TraceRecorder::readPins()
+	{
+		Clock::time_point start = Clock::now();
+		uint16_t pins = m_device->readPins();
+		record(Kind::ReadPins, start, pins);
+		return pins;
+	}
+
+	size_t TraceRecorder::encodePinValue(Pin pin, bool value, uint8_t* out)
+	{
+		// The encoded command shows up in a later write().
+		return m_device->encodePinValue(pin, value, out);
+	}
+
+	bool TraceRecorder::waitForPin(Pin pin, bool value)
+	{
+		Clock::time_point start = Clock::now();
+		bool ok = m_device->waitForPin(pin, value);
+		if (ok)
+			record(Kind::WaitForPin, start, uint32_t(pin) << 1 | value);
+		return ok;
+	}
+
+	bool TraceRecorder::canWaitForPin(Pin pin) const
+	{
+		return m_device->canWaitForPin(pin);
+	}
+
+	void TraceRecorder::setClock(int clock_hz, bool adaptive, bool three_phase)
+	{
+		Clock::time_point start = Clock::now();
+		m_device->setClock(clock_hz, adaptive, three_phase);
+		uint8_t mode[] = { adaptive, three_phase };
+		record(Kind::SetClock, start, uint32_t(clock_hz), mode, sizeof(mode));
+	}
+
+	size_t TraceRecorder::encodeClock(int clock_hz, uint8_t* out)
+	{
+		return m_device->encodeClock(clock_hz, out);
+	}
+
+	int TraceRecorder::write(const uint8_t* data, size_t length)
+	{
+		Clock::time_point start = Clock::now();
+		int ret = m_device->write(data, length);
+		record(Kind::Write, start, 0, data, length);
+		return ret;
+	}
+
+	int TraceRecorder::read(uint8_t* data, int expected, int timeOutInMs)
+	{
+		// The split read in flight gets its reply first; record it first.
+		if (m_splitData != nullptr)
+		{
+			int result;
+			while (!m_device->pollRead(result))
+				std::this_thread::yield();
+			recordSplitRead(result);
+			m_splitFinished = true;
+			m_splitResult = result;
+		}
+
+		Clock::time_point start = Clock::now();
+		int ret = m_device->read(data, expected, timeOutInMs);
+		record(Kind::Read, start, uint32_t(expected), data, ret > 0 ? size_t(ret) : 0);
+		return ret;
+	}
+
+	bool TraceRecorder::beginRead(uint8_t* data, int expected, int timeOutInMs)
+	{
+		if (m_splitData != nullptr || m_splitFinished)
+		{
+			fprintf(stderr, "TraceRecorder: a split read is already in flight\n");
+			return false;
+		}
+
+		Clock::time_point start = Clock::now();
+		if (!m_device->beginRead(data, expected, timeOutInMs))
+			return false;
+		m_splitData = data;
+		m_splitExpected = expected;
+		m_splitStart = start;
+		return true;
+	}
+
+	bool TraceRecorder::pollRead(int& result)
+	{
+		if (m_splitFinished)
+		{
+			m_splitFinished = false;
+			result = m_splitResult;
+			return true;
+		}
+		if (m_splitData == nullptr)
+		{
+			result = -1;
+			return true;
+		}
+
+		if (!m_device->pollRead(result))
+			return false;
+		recordSplitRead(result);
+		return true;
+	}
+
+	void TraceRecorder::recordSplitRead(int result)
+	{
+		record(Kind::Read, m_splitStart, uint32_t(m_splitExpected), m_splitData, result > 0 ? size_t(result) : 0);
+		m_splitData = nullptr;
+	}
+
+	bool TraceRecorder::setLatencyTimer(int ms)
+	{
+		Clock::time_point start = Clock::now();
+		bool ok = m_device->setLatencyTimer(ms);
+		record(Kind::LatencyTimer, start, uint32_t(ms));
+		return ok;
+	}
+
+	void TraceRecorder::setLatencyProfile(LatencyProfile profile)
+	{
+		Clock::time_point start = Clock::now();
+		m_device->setLatencyProfile(profile);
+		record(Kind::LatencyProfile, start, uint32_t(profile));
+	}
+
+	int TraceRecorder::flush()
+	{
+		Clock::time_point start = Clock::now();
+		int ret = m_device->flush();
+		record(Kind::Flush, start, ret > 0 ? uint32_t(ret) : 0);
+		return ret;
+	}
+
+	void TraceRecorder::beginCapture()
+	{
+		Clock::time_point start = Clock::now();
+		m_device->beginCapture();
+		record(Kind::BeginCapture, start, 0);
+	}
+
+	void TraceRecorder::endCapture(std::vector<uint8_t>& stream)
+	{
+		Clock::time_point start = Clock::now();
+		m_device->endCapture(stream);
+		record(Kind::EndCapture, start, uint32_t(stream.size()));
+	}
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "IDevice.h"
+#include <stdint.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace hw
+{
+	///
+	/// An IDevice that passes every call through to another device and
+	/// records it, with a timestamp and how long the call took, for the
+	/// traceDecode tool.  Bytes written and bytes read back are kept, so the
+	/// trace can be expanded into MPSSE commands, SPI frames and RA8875
+	/// register accesses afterwards.
+	///
+	/// mark() labels the calls that follow it; traceDecode reports its
+	/// statistics per label.
+	///
+	class TraceRecorder : public IDevice
+	{
+	public:
+		enum class Kind : uint8_t
+		{
+			Open, Close,
+			PinDirection,   // arg: pin << 1 | direction
+			SetPin,         // arg: pin << 1 | value
+			GetPin,         // arg: pin << 1 | value read
+			ReadPins,       // arg: pins read
+			WaitForPin,     // arg: pin << 1 | value
+			SetClock,       // arg: hz, data: adaptive, three phase
+			Write,          // data: bytes written
+			Read,           // arg: bytes expected, data: bytes read
+			LatencyTimer,   // arg: ms
+			LatencyProfile, // arg: profile
+			Flush,          // arg: bytes sent
+			BeginCapture,
+			EndCapture,     // arg: bytes captured
+			Mark,           // data: label
+		};
+
+		struct Event
+		{
+			Kind     kind;
+			uint64_t startNs;     // since recording started
+			uint64_t durationNs;
+			uint32_t arg;
+			std::vector<uint8_t> data;
+		};
+
+		explicit TraceRecorder(IDevice& device);
+
+		// Start again with an empty trace.
+		void      clear();
+		void      mark(const char* label);
+		size_t    size() const { return m_trace.size(); }
+
+		bool      save(const char* path) const;
+		static bool load(const char* path, std::vector<Event>& events);
+
+		bool open() override;
+		void close() override;
+
+		// GPIO access.
+		void      setPinDirection(Pin pin, Direction dir) override;
+		Direction getPinDirection(Pin pin) override;
+
+		void      setPinValue(Pin pin, bool value) override;
+		bool      getPinValue(Pin pin) override;
+		uint16_t  readPins() override;
+		size_t    encodePinValue(Pin pin, bool value, uint8_t* out) override;
+		bool      waitForPin(Pin pin, bool value) override;
+		bool      canWaitForPin(Pin pin) const override;
+
+		// MPSSE access.
+		void      setClock(int clock_hz, bool adaptive = false, bool three_phase = false) override;
+		size_t    encodeClock(int clock_hz, uint8_t* out) override;
+		int       write(const uint8_t* data, size_t length) override;
+		int       read(uint8_t* data, int expected, int timeOutInMs = 500) override;
+		bool      beginRead(uint8_t* data, int expected, int timeOutInMs = 500) override;
+		bool      pollRead(int& result) override;
+		bool      setLatencyTimer(int ms) override;
+		void      setLatencyProfile(LatencyProfile profile) override;
+		int       flush() override;
+		void      beginCapture() override;
+		void      endCapture(std::vector<uint8_t>& stream) override;
+		size_t    captured() const override { return m_device->captured(); }
+		TransferStats transferStats() const override { return m_device->transferStats(); }
+		void      resetTransferStats() override { m_device->resetTransferStats(); }
+
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		void      record(Kind kind, Clock::time_point start, uint32_t arg, const uint8_t* data = nullptr, size_t length = 0);
+		void      recordSplitRead(int result);
+		void      putVarint(uint64_t value);
+
+	private:
+		IDevice*  m_device;
+		Clock::time_point m_origin;
+		uint64_t  m_lastNs;
+		std::vector<uint8_t> m_trace;
+
+		// The split read in flight, recorded as a Read once it completes.
+		uint8_t*  m_splitData;
+		int       m_splitExpected;
+		Clock::time_point m_splitStart;
+		// Finished by read(), until pollRead() hands over the result.
+		bool      m_splitFinished;
+		int       m_splitResult;
+	};
+}
@@ -0,0 +1,65 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+namespace hw
+{
+	WorkerPool::WorkerPool(int threads)
+		: m_stop(false)
+	{
+		if (threads <= 0)
+			threads = std::max(1, int(std::thread::hardware_concurrency()));
+		for (int i = 0; i < threads; ++i)
+			m_threads.emplace_back(&WorkerPool::work, this, i);
+	}
+
+	WorkerPool::~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_stop = true;
+		}
+		m_work.notify_all();
+		for (std::thread& t : m_threads)
+			t.join();
+	}
+
+	void WorkerPool::run(size_t count, const Job& job)
+	{
+		if (count == 0)
+			return;
+
+		Batch batch = { &job, count, 0, 0 };
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_batches.push_back(&batch);
+		m_work.notify_all();
+		m_done.wait(lock, [&] { return batch.done == batch.count; });
+	}
+
+	/*
+	 * Jobs are taken one at a time from the oldest batch with any left,
+	 * and a batch leaves the list once its last job has been taken.
+	 */
+	void WorkerPool::work(int worker)
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+		for (;;)
+		{
+			m_work.wait(lock, [&] { return m_stop || !m_batches.empty(); });
+			if (m_stop)
+				return;
+
+			Batch* batch = m_batches.front();
+			size_t i = batch->next++;
+			if (batch->next == batch->count)
+				m_batches.erase(m_batches.begin());
+
+			lock.unlock();
+			(*batch->job)(i, worker);
+			lock.lock();
+
+			if (++batch->done == batch->count)
+				m_done.notify_all();
+		}
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stddef.h>
+#include <thread>
+#include <vector>
+
+namespace hw
+{
+	///
+	/// A fixed set of threads running numbered jobs.  Several threads may
+	/// hand work to the same pool at once; their jobs are interleaved.
+	///
+	class WorkerPool
+	{
+	public:
+		typedef std::function<void(size_t job, int worker)> Job;
+
+		// 0 threads picks one per core.
+		explicit WorkerPool(int threads = 0);
+		~WorkerPool();
+
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool& operator=(const WorkerPool&) = delete;
+
+		int       size() const { return int(m_threads.size()); }
+
+		///
+		/// Call job(i, worker) for every i in [0, count) and return once
+		/// all calls did.  'worker' is the index of the thread making the
+		/// call, below size(), for per-thread scratch state.
+		///
+		void      run(size_t count, const Job& job);
+
+	private:
+		struct Batch
+		{
+			const Job* job;
+			size_t     count;
+			size_t     next;
+			size_t     done;
+		};
+
+		void      work(int worker);
+
+	private:
+		std::vector<std::thread> m_threads;
+		std::vector<Batch*>      m_batches;
+		std::mutex               m_lock;
+		std::condition_variable  m_work;
+		std::condition_variable  m_done;
+		bool                     m_stop;
+	};
+}
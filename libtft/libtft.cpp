@@ -1,6 +1,10 @@
 
 #include "libtft.h"
 #include "RA8875.h"
+#include "Timeline.h"
+
+// The timeline behind TFT_startTimeline()/TFT_stopTimeline().
+static hw::Timeline* s_timeline = nullptr;
 
 
 FT232HHandle TFT_createDevice() {
@@ -11,6 +15,22 @@ int TFT_openDevice(FT232HHandle device) {
 	return reinterpret_cast<hw::FT232H*>(device)->open();
 }
 
+void TFT_setBuffered(FT232HHandle device, bool buffered) {
+	reinterpret_cast<hw::FT232H*>(device)->setBuffered(buffered);
+}
+
+void TFT_setAsyncTransfers(FT232HHandle device, int count) {
+	reinterpret_cast<hw::FT232H*>(device)->setAsyncTransfers(count);
+}
+
+bool TFT_setLatencyTimer(FT232HHandle device, int ms) {
+	return reinterpret_cast<hw::FT232H*>(device)->setLatencyTimer(ms);
+}
+
+void TFT_setLatencyProfile(FT232HHandle device, int lowestCpu) {
+	reinterpret_cast<hw::FT232H*>(device)->setLatencyProfile(lowestCpu ? hw::LatencyProfile::LowestCpu : hw::LatencyProfile::LowestLatency);
+}
+
 RA8875Handle TFT_createTft(FT232HHandle device) {
 	return reinterpret_cast<void*>(new hw::RA8875(*reinterpret_cast<hw::FT232H*>(device)));
 }
@@ -103,6 +123,38 @@ void TFT_drawPixels(RA8875Handle tft, uint16_t p[], uint16_t count, int16_t x, i
 	reinterpret_cast<hw::RA8875*>(tft)->drawPixels(p, count, x, y);
 }
 
+void TFT_pushRect(RA8875Handle tft, int16_t x, int16_t y, uint16_t w, uint16_t h, const uint16_t* pixels, size_t stride) {
+	reinterpret_cast<hw::RA8875*>(tft)->pushRect(x, y, w, h, pixels, stride);
+}
+
+void TFT_pushRectFormat(RA8875Handle tft, int16_t x, int16_t y, uint16_t w, uint16_t h, TFT_PixelFormat format, const void* pixels, size_t strideBytes) {
+	reinterpret_cast<hw::RA8875*>(tft)->pushRect(x, y, w, h, format, pixels, strideBytes);
+}
+
+void TFT_setColorDepth(RA8875Handle tft, uint8_t bpp) {
+	reinterpret_cast<hw::RA8875*>(tft)->setColorDepth(bpp);
+}
+
+void TFT_setDither(RA8875Handle tft, TFT_Dither mode) {
+	reinterpret_cast<hw::RA8875*>(tft)->setDither(mode);
+}
+
+void TFT_setFramebuffer(RA8875Handle tft, bool on) {
+	reinterpret_cast<hw::RA8875*>(tft)->setFramebuffer(on);
+}
+
+size_t TFT_flushFramebuffer(RA8875Handle tft) {
+	return reinterpret_cast<hw::RA8875*>(tft)->flushFramebuffer();
+}
+
+size_t TFT_presentFrame(RA8875Handle tft, const uint16_t* pixels, size_t stride) {
+	return reinterpret_cast<hw::RA8875*>(tft)->presentFrame(pixels, stride);
+}
+
+void TFT_invalidateFrame(RA8875Handle tft) {
+	reinterpret_cast<hw::RA8875*>(tft)->invalidateFrame();
+}
+
 //void TFT_fillRect() {
 //	reinterpret_cast<hw::RA8875*>(tft)->fillRect();
 //}
@@ -199,6 +251,10 @@ bool TFT_touchRead(RA8875Handle tft, uint16_t *x, uint16_t *y) {
 	return reinterpret_cast<hw::RA8875*>(tft)->touchRead(x, y);
 }
 
+bool TFT_touchPoll(RA8875Handle tft, uint16_t *x, uint16_t *y) {
+	return reinterpret_cast<hw::RA8875*>(tft)->touchPoll(x, y);
+}
+
 /* Low level access */
 void TFT_setRegister8(RA8875Handle tft, TFT_Register reg, uint8_t val) {
 	reinterpret_cast<hw::RA8875*>(tft)->setRegister8(reg, val);
@@ -216,6 +272,9 @@ uint8_t TFT_readRegister8(RA8875Handle tft, TFT_Register reg) {
 	return reinterpret_cast<hw::RA8875*>(tft)->readRegister8(reg);
 }
 
+void TFT_readRegisters(RA8875Handle tft, const TFT_Register* regs, uint8_t* values, size_t count) {
+	reinterpret_cast<hw::RA8875*>(tft)->readRegisters(regs, values, count);
+}
 
 void TFT_writeData(RA8875Handle tft, uint8_t d) {
 	reinterpret_cast<hw::RA8875*>(tft)->writeData(d);
@@ -237,10 +296,67 @@ bool TFT_waitPoll(RA8875Handle tft, TFT_Register reg, uint8_t f) {
 	return reinterpret_cast<hw::RA8875*>(tft)->waitPoll(reg, f);
 }
 
+bool TFT_setHardwareWait(RA8875Handle tft, bool on) {
+	return reinterpret_cast<hw::RA8875*>(tft)->setHardwareWait(on);
+}
+
+void TFT_setPipelined(RA8875Handle tft, bool on) {
+	reinterpret_cast<hw::RA8875*>(tft)->setPipelined(on);
+}
+
+void TFT_sync(RA8875Handle tft) {
+	reinterpret_cast<hw::RA8875*>(tft)->sync();
+}
+
+void TFT_setSpiClockLimit(RA8875Handle tft, int hz) {
+	reinterpret_cast<hw::RA8875*>(tft)->setSpiClockLimit(hz);
+}
+
+int TFT_calibrateSpiClock(RA8875Handle tft) {
+	return reinterpret_cast<hw::RA8875*>(tft)->calibrateSpiClock();
+}
+
+int TFT_reconcileShadow(RA8875Handle tft) {
+	return reinterpret_cast<hw::RA8875*>(tft)->reconcileShadow();
+}
+
+void TFT_setShadowVerify(RA8875Handle tft, unsigned everyNWrites) {
+	reinterpret_cast<hw::RA8875*>(tft)->setShadowVerify(everyNWrites);
+}
+
 uint16_t TFT_width(RA8875Handle tft) {
 	return reinterpret_cast<hw::RA8875*>(tft)->width();
 }
 
 uint16_t TFT_height(RA8875Handle tft) {
 	return reinterpret_cast<hw::RA8875*>(tft)->height();
+}
+
+void TFT_flush(RA8875Handle tft) {
+	reinterpret_cast<hw::RA8875*>(tft)->flush();
+}
+
+void TFT_getStats(RA8875Handle tft, TFT_Stats* stats) {
+	*stats = reinterpret_cast<hw::RA8875*>(tft)->stats();
+}
+
+void TFT_resetStats(RA8875Handle tft) {
+	reinterpret_cast<hw::RA8875*>(tft)->resetStats();
+}
+
+void TFT_startTimeline(size_t maxEvents) {
+	delete s_timeline;
+	s_timeline = new hw::Timeline(maxEvents);
+	s_timeline->start();
+}
+
+bool TFT_stopTimeline(const char* path) {
+	if (s_timeline == nullptr)
+		return false;
+
+	s_timeline->stop();
+	bool ok = path == nullptr || s_timeline->save(path);
+	delete s_timeline;
+	s_timeline = nullptr;
+	return ok;
 }
\ No newline at end of file
@@ -33,6 +33,10 @@ extern "C"
 	EXPORT FT232HHandle   TFT_createDevice();
 	EXPORT RA8875Handle   TFT_createTft(FT232HHandle device);
 	EXPORT int     TFT_openDevice(FT232HHandle device);
+	EXPORT void    TFT_setBuffered(FT232HHandle device, bool buffered);
+	EXPORT void    TFT_setAsyncTransfers(FT232HHandle device, int count);
+	EXPORT bool    TFT_setLatencyTimer(FT232HHandle device, int ms);
+	EXPORT void    TFT_setLatencyProfile(FT232HHandle device, int lowestCpu);
 	EXPORT void    TFT_destroyTft(RA8875Handle tft);
 	EXPORT void    TFT_destroyDevice(FT232HHandle device);
 
@@ -64,6 +68,14 @@ extern "C"
 	EXPORT void    TFT_fillScreen(RA8875Handle tft, uint16_t color);
 	EXPORT void    TFT_drawPixel(RA8875Handle tft, int16_t x, int16_t y, uint16_t color);
 	EXPORT void    TFT_drawPixels(RA8875Handle tft, uint16_t p[], uint16_t count, int16_t x, int16_t y);
+	EXPORT void    TFT_pushRect(RA8875Handle tft, int16_t x, int16_t y, uint16_t w, uint16_t h, const uint16_t* pixels, size_t stride);
+	EXPORT void    TFT_pushRectFormat(RA8875Handle tft, int16_t x, int16_t y, uint16_t w, uint16_t h, TFT_PixelFormat format, const void* pixels, size_t strideBytes);
+	EXPORT void    TFT_setColorDepth(RA8875Handle tft, uint8_t bpp);
+	EXPORT void    TFT_setDither(RA8875Handle tft, TFT_Dither mode);
+	EXPORT void    TFT_setFramebuffer(RA8875Handle tft, bool on);
+	EXPORT size_t  TFT_flushFramebuffer(RA8875Handle tft);
+	EXPORT size_t  TFT_presentFrame(RA8875Handle tft, const uint16_t* pixels, size_t stride);
+	EXPORT void    TFT_invalidateFrame(RA8875Handle tft);
 	EXPORT void    TFT_drawLine(RA8875Handle tft, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t color);
 	EXPORT void    TFT_drawRect(RA8875Handle tft, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color);
 	EXPORT void    TFT_fillRect(RA8875Handle tft, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color);
@@ -89,20 +101,38 @@ extern "C"
 	EXPORT void    TFT_touchEnable(RA8875Handle tft, bool on);
 	EXPORT bool    TFT_touched(RA8875Handle tft);
 	EXPORT bool    TFT_touchRead(RA8875Handle tft, uint16_t *x, uint16_t *y);
+	EXPORT bool    TFT_touchPoll(RA8875Handle tft, uint16_t *x, uint16_t *y);
 
 	/* Low level access */
 	EXPORT void     TFT_setRegister8(RA8875Handle tft, TFT_Register reg, uint8_t val);
 	EXPORT void     TFT_setRegister16(RA8875Handle tft, TFT_Register reg, uint16_t val);
 	EXPORT void     TFT_setColorRegister(RA8875Handle tft, TFT_Register reg, uint16_t color);
 	EXPORT uint8_t  TFT_readRegister8(RA8875Handle tft, TFT_Register reg);
+	EXPORT void     TFT_readRegisters(RA8875Handle tft, const TFT_Register* regs, uint8_t* values, size_t count);
 
 	EXPORT void     TFT_writeData(RA8875Handle tft, uint8_t d);
 	EXPORT uint8_t  TFT_readData(RA8875Handle tft);
 	EXPORT void     TFT_writeCommand(RA8875Handle tft, uint8_t d);
 	EXPORT uint8_t  TFT_readStatus(RA8875Handle tft);
 	EXPORT bool     TFT_waitPoll(RA8875Handle tft, TFT_Register reg, uint8_t f);
+	EXPORT bool     TFT_setHardwareWait(RA8875Handle tft, bool on);
+	EXPORT void     TFT_setPipelined(RA8875Handle tft, bool on);
+	EXPORT void     TFT_setSpiClockLimit(RA8875Handle tft, int hz);
+	EXPORT int      TFT_calibrateSpiClock(RA8875Handle tft);
+	EXPORT void     TFT_sync(RA8875Handle tft);
+	EXPORT int      TFT_reconcileShadow(RA8875Handle tft);
+	EXPORT void     TFT_setShadowVerify(RA8875Handle tft, unsigned everyNWrites);
 	EXPORT uint16_t TFT_width(RA8875Handle tft);
 	EXPORT uint16_t TFT_height(RA8875Handle tft);
+	EXPORT void     TFT_flush(RA8875Handle tft);
+
+	/* Counters */
+	EXPORT void     TFT_getStats(RA8875Handle tft, TFT_Stats* stats);
+	EXPORT void     TFT_resetStats(RA8875Handle tft);
+
+	/* Timeline: spans of every call, written as Chrome trace_event JSON */
+	EXPORT void     TFT_startTimeline(size_t maxEvents);
+	EXPORT bool     TFT_stopTimeline(const char* path);
 
 }
 
@@ -42,4 +42,7 @@ solution 'displayTest'
     include 'libftdi'
     include 'libtft'
     include 'displayTest'
+    include 'traceDecode'
+    include 'bench'
+    include 'check'
 
@@ -0,0 +1,509 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ftdi.h>
+
+#include "TraceRecorder.h"
+#include "MpsseDecoder.h"
+#include "RA8875Registers.h"
+
+#include <string>
+#include <vector>
+
+using hw::TraceRecorder;
+
+//
+// Expands a TraceRecorder trace: device calls, the MPSSE commands in each
+// write, the SPI frames between chip select edges and the RA8875 register
+// accesses they carry, followed by statistics per mark() label and per
+// register.
+//
+
+static const char* kPinNames[] = {
+	"D0", "D1", "D2", "D3", "D4", "D5", "D6", "D7",
+	"C0", "C1", "C2", "C3", "C4", "C5", "C6", "C7",
+};
+
+static const char* kKindNames[] = {
+	"open", "close", "direction", "set", "get", "pins", "wait",
+	"clock", "write", "read", "latency", "profile", "flush",
+	"capture", "end capture", "mark",
+};
+
+static int parsePin(const char* name)
+{
+	for (int i = 0; i < 16; ++i)
+	{
+		if (strcmp(name, kPinNames[i]) == 0)
+			return i;
+	}
+	return -1;
+}
+
+class TraceDecoder : private hw::MpsseDecoder::Listener
+{
+public:
+	TraceDecoder(int cs, bool mpsse, bool quiet);
+
+	void    run(const std::vector<TraceRecorder::Event>& events);
+	void    printStats() const;
+
+private:
+	struct Section
+	{
+		std::string label;
+		size_t   count;       // times the label was marked
+		size_t   writes, flushes, reads, frames;
+		uint64_t bytesOut, bytesIn;
+		uint64_t callNs;      // time spent in device calls
+		uint64_t wallNs;      // mark to next mark
+	};
+
+	struct Access
+	{
+		size_t   writes, reads;
+	};
+
+	struct SpiByte
+	{
+		uint8_t  out, in;
+		bool     read;
+	};
+
+	// MpsseDecoder::Listener
+	void    onSetBits(int bank, uint8_t value, uint8_t direction) override;
+	uint8_t onGetBits(int bank) override;
+	void    onClockDivisor(uint16_t divisor) override;
+	void    onClockMode(uint8_t opcode) override;
+	void    onShiftBegin(uint8_t opcode, size_t length) override;
+	uint8_t onShiftByte(uint8_t opcode, uint8_t out) override;
+	void    onWaitPin(bool high) override;
+	void    onSendImmediate() override;
+	void    onBadCommand(uint8_t opcode) override;
+
+	void    event(const TraceRecorder::Event& e);
+	void    select(const char* label, uint64_t ns);
+	void    chipSelect(bool high);
+	void    endFrame();
+	uint8_t reply();
+	static const char* name(uint8_t reg, char* buffer);
+
+private:
+	hw::MpsseDecoder m_decoder;
+	int      m_cs;
+	bool     m_mpsse;
+	bool     m_quiet;
+
+	std::vector<uint8_t> m_replies;    // every byte read, in order
+	size_t   m_replyIndex;
+	std::vector<uint8_t> m_ignored;
+	bool     m_capturing;
+	bool     m_csHigh;
+	bool     m_div5;
+	std::vector<SpiByte> m_frame;
+	uint8_t  m_register;
+
+	std::vector<Section> m_sections;
+	size_t   m_section;
+	uint64_t m_sectionStart;
+	uint64_t m_endNs;
+	Access   m_access[256];
+};
+
+TraceDecoder::TraceDecoder(int cs, bool mpsse, bool quiet)
+	: m_decoder(*this)
+	, m_cs(cs)
+	, m_mpsse(mpsse)
+	, m_quiet(quiet)
+	, m_replyIndex(0)
+	, m_capturing(false)
+	, m_csHigh(true)
+	, m_div5(false)
+	, m_register(0)
+	, m_section(0)
+	, m_sectionStart(0)
+	, m_endNs(0)
+{
+	memset(m_access, 0, sizeof(m_access));
+	m_sections.push_back(Section());
+	m_sections[0].label = "(unmarked)";
+}
+
+void TraceDecoder::run(const std::vector<TraceRecorder::Event>& events)
+{
+	// Reads return the bytes of commands written before them, so collect
+	// them up front and hand them out as the commands are decoded.
+	for (const TraceRecorder::Event& e : events)
+	{
+		if (e.kind == TraceRecorder::Kind::Read)
+			m_replies.insert(m_replies.end(), e.data.begin(), e.data.end());
+	}
+
+	for (const TraceRecorder::Event& e : events)
+		event(e);
+
+	m_sections[m_section].wallNs += m_endNs - m_sectionStart;
+}
+
+void TraceDecoder::event(const TraceRecorder::Event& e)
+{
+	using Kind = TraceRecorder::Kind;
+
+	if (e.kind == Kind::Mark)
+		select(std::string(e.data.begin(), e.data.end()).c_str(), e.startNs);
+
+	Section& s = m_sections[m_section];
+	s.callNs += e.durationNs;
+	if (e.startNs + e.durationNs > m_endNs)
+		m_endNs = e.startNs + e.durationNs;
+
+	if (!m_quiet)
+	{
+		printf("%12.3f ms  %-11s", e.startNs / 1e6, kKindNames[int(e.kind)]);
+		switch (e.kind)
+		{
+		case Kind::PinDirection:
+			printf(" %s %s", kPinNames[(e.arg >> 1) & 15], (e.arg & 1) ? "out" : "in");
+			break;
+		case Kind::SetPin:
+		case Kind::GetPin:
+		case Kind::WaitForPin:
+			printf(" %s %s", kPinNames[(e.arg >> 1) & 15], (e.arg & 1) ? "high" : "low");
+			break;
+		case Kind::ReadPins:
+			printf(" 0x%04x", e.arg);
+			break;
+		case Kind::SetClock:
+			printf(" %u Hz%s%s", e.arg,
+				e.data.size() > 0 && e.data[0] ? " adaptive" : "",
+				e.data.size() > 1 && e.data[1] ? " three phase" : "");
+			break;
+		case Kind::Write:
+			printf(" %zu bytes%s", e.data.size(), m_capturing ? " (captured)" : "");
+			break;
+		case Kind::Read:
+			printf(" %zu of %u bytes", e.data.size(), e.arg);
+			for (size_t i = 0; i < e.data.size() && i < 8; ++i)
+				printf(" %02x", e.data[i]);
+			if (e.data.size() > 8)
+				printf(" ...");
+			break;
+		case Kind::LatencyTimer:
+			printf(" %u ms", e.arg);
+			break;
+		case Kind::LatencyProfile:
+			printf(" %s", e.arg == 0 ? "lowest latency" : "lowest cpu");
+			break;
+		case Kind::Flush:
+		case Kind::EndCapture:
+			printf(" %u bytes", e.arg);
+			break;
+		case Kind::Mark:
+			printf(" %.*s", int(e.data.size()), reinterpret_cast<const char*>(e.data.data()));
+			break;
+		default:
+			break;
+		}
+		printf("  (%.1f us)\n", e.durationNs / 1e3);
+	}
+
+	switch (e.kind)
+	{
+	case Kind::SetPin:
+		if (int((e.arg >> 1) & 15) == m_cs)
+			chipSelect((e.arg & 1) != 0);
+		break;
+	case Kind::Write:
+		// Captured commands reach the wire later, as a write of their own.
+		if (!m_capturing)
+		{
+			s.writes++;
+			s.bytesOut += e.data.size();
+			m_decoder.feed(e.data.data(), e.data.size(), m_ignored);
+			m_ignored.clear();
+		}
+		break;
+	case Kind::Read:
+		s.reads++;
+		s.bytesIn += e.data.size();
+		break;
+	case Kind::Flush:
+		if (e.arg > 0)
+			s.flushes++;
+		break;
+	case Kind::BeginCapture:
+		m_capturing = true;
+		break;
+	case Kind::EndCapture:
+		m_capturing = false;
+		break;
+	default:
+		break;
+	}
+}
+
+void TraceDecoder::select(const char* label, uint64_t ns)
+{
+	m_sections[m_section].wallNs += ns - m_sectionStart;
+	m_sectionStart = ns;
+
+	for (m_section = 0; m_section < m_sections.size(); ++m_section)
+	{
+		if (m_sections[m_section].label == label)
+			break;
+	}
+	if (m_section == m_sections.size())
+	{
+		m_sections.push_back(Section());
+		m_sections.back().label = label;
+	}
+	m_sections[m_section].count++;
+}
+
+uint8_t TraceDecoder::reply()
+{
+	return m_replyIndex < m_replies.size() ? m_replies[m_replyIndex++] : 0;
+}
+
+void TraceDecoder::chipSelect(bool high)
+{
+	if (high == m_csHigh)
+		return;
+	m_csHigh = high;
+
+	if (high)
+		endFrame();
+	else
+		m_frame.clear();
+}
+
+const char* TraceDecoder::name(uint8_t reg, char* buffer)
+{
+	const char* n = hw::registerName(reg);
+	if (n != nullptr)
+		return n;
+	sprintf(buffer, "0x%02x", reg);
+	return buffer;
+}
+
+///
+/// An RA8875 SPI transaction: a prefix byte (command or data, read or
+/// write) followed by the register number or data bytes.
+///
+void TraceDecoder::endFrame()
+{
+	if (m_frame.empty())
+		return;
+
+	m_sections[m_section].frames++;
+	char buffer[8];
+	uint8_t prefix = m_frame[0].out;
+	size_t count = m_frame.size() - 1;
+
+	switch (prefix)
+	{
+	case 0x80:      // command write
+		if (count > 0)
+		{
+			m_register = m_frame[1].out;
+			if (!m_quiet)
+				printf("        select %s\n", name(m_register, buffer));
+		}
+		break;
+
+	case 0x00:      // data write
+		m_access[m_register].writes += count;
+		if (m_quiet)
+			break;
+		if (m_register == MRWC && count > 1)
+		{
+			printf("        write  MRWC <- %zu bytes\n", count);
+			break;
+		}
+		for (size_t i = 1; i < m_frame.size(); ++i)
+			printf("        write  %s = 0x%02x\n", name(m_register, buffer), m_frame[i].out);
+		break;
+
+	case 0x40:      // data read
+		m_access[m_register].reads += count;
+		if (m_quiet)
+			break;
+		for (size_t i = 1; i < m_frame.size(); ++i)
+			printf("        read   %s -> 0x%02x\n", name(m_register, buffer), m_frame[i].in);
+		break;
+
+	case 0xC0:      // status read
+		if (!m_quiet)
+		{
+			for (size_t i = 1; i < m_frame.size(); ++i)
+				printf("        status -> 0x%02x\n", m_frame[i].in);
+		}
+		break;
+
+	default:
+		if (!m_quiet)
+			printf("        spi    %zu bytes, prefix 0x%02x\n", m_frame.size(), prefix);
+		break;
+	}
+	m_frame.clear();
+}
+
+void TraceDecoder::onSetBits(int bank, uint8_t value, uint8_t direction)
+{
+	if (m_mpsse && !m_quiet)
+		printf("      %s 0x%02x dir 0x%02x\n", bank == 0 ? "SET_BITS_LOW " : "SET_BITS_HIGH", value, direction);
+
+	if (m_cs / 8 == bank)
+		chipSelect((value & (1 << (m_cs % 8))) != 0);
+}
+
+uint8_t TraceDecoder::onGetBits(int bank)
+{
+	uint8_t value = reply();
+	if (m_mpsse && !m_quiet)
+		printf("      %s -> 0x%02x\n", bank == 0 ? "GET_BITS_LOW " : "GET_BITS_HIGH", value);
+	return value;
+}
+
+void TraceDecoder::onClockDivisor(uint16_t divisor)
+{
+	if (m_mpsse && !m_quiet)
+		printf("      TCK_DIVISOR %u (%d Hz)\n", divisor, (m_div5 ? 6000000 : 30000000) / (1 + divisor));
+}
+
+void TraceDecoder::onClockMode(uint8_t opcode)
+{
+	const char* n = "?";
+	switch (opcode)
+	{
+	case LOOPBACK_START: n = "LOOPBACK_START"; break;
+	case LOOPBACK_END:   n = "LOOPBACK_END"; break;
+	case DIS_DIV_5:      n = "DIS_DIV_5"; m_div5 = false; break;
+	case EN_DIV_5:       n = "EN_DIV_5"; m_div5 = true; break;
+	case EN_3_PHASE:     n = "EN_3_PHASE"; break;
+	case DIS_3_PHASE:    n = "DIS_3_PHASE"; break;
+	case EN_ADAPTIVE:    n = "EN_ADAPTIVE"; break;
+	case DIS_ADAPTIVE:   n = "DIS_ADAPTIVE"; break;
+	}
+	if (m_mpsse && !m_quiet)
+		printf("      %s\n", n);
+}
+
+void TraceDecoder::onShiftBegin(uint8_t opcode, size_t length)
+{
+	if (!m_mpsse || m_quiet)
+		return;
+
+	printf("      shift 0x%02x %s%s%s %zu %s, %s, %s first\n", opcode,
+		(opcode & MPSSE_WRITE_TMS) ? "tms" : "",
+		(opcode & MPSSE_DO_WRITE) ? "out" : "",
+		(opcode & MPSSE_DO_READ) ? "in" : "",
+		length, (opcode & (MPSSE_BITMODE | MPSSE_WRITE_TMS)) ? "bits" : "bytes",
+		(opcode & MPSSE_WRITE_NEG) ? "-ve out" : "+ve out",
+		(opcode & MPSSE_LSB) ? "lsb" : "msb");
+}
+
+uint8_t TraceDecoder::onShiftByte(uint8_t opcode, uint8_t out)
+{
+	SpiByte b;
+	b.out = out;
+	b.read = (opcode & MPSSE_DO_READ) != 0;
+	b.in = b.read ? reply() : 0;
+	if (!m_csHigh)
+		m_frame.push_back(b);
+	return b.in;
+}
+
+void TraceDecoder::onWaitPin(bool high)
+{
+	if (m_mpsse && !m_quiet)
+		printf("      %s\n", high ? "WAIT_ON_HIGH" : "WAIT_ON_LOW");
+}
+
+void TraceDecoder::onSendImmediate()
+{
+	if (m_mpsse && !m_quiet)
+		printf("      SEND_IMMEDIATE\n");
+}
+
+void TraceDecoder::onBadCommand(uint8_t opcode)
+{
+	// The chip answers with 0xFA and the opcode.
+	reply();
+	reply();
+	if (!m_quiet)
+		printf("      bad opcode 0x%02x\n", opcode);
+}
+
+void TraceDecoder::printStats() const
+{
+	printf("\n%-20s %6s %7s %7s %6s %7s %10s %10s %10s %10s\n",
+		"operation", "count", "writes", "flushes", "reads", "frames", "bytes out", "bytes in", "calls ms", "wall ms");
+	for (const Section& s : m_sections)
+	{
+		if (s.count == 0 && s.writes == 0 && s.reads == 0 && s.callNs == 0)
+			continue;
+		printf("%-20s %6zu %7zu %7zu %6zu %7zu %10llu %10llu %10.3f %10.3f\n",
+			s.label.c_str(), s.count, s.writes, s.flushes, s.reads, s.frames,
+			(unsigned long long)s.bytesOut, (unsigned long long)s.bytesIn,
+			s.callNs / 1e6, s.wallNs / 1e6);
+	}
+
+	printf("\n%-10s %10s %10s\n", "register", "writes", "reads");
+	for (int reg = 0; reg < 256; ++reg)
+	{
+		const Access& a = m_access[reg];
+		if (a.writes == 0 && a.reads == 0)
+			continue;
+		char buffer[8];
+		printf("%-10s %10zu %10zu\n", name(uint8_t(reg), buffer), a.writes, a.reads);
+	}
+}
+
+static int usage()
+{
+	fprintf(stderr,
+		"usage: traceDecode [-m] [-s] [-c pin] trace\n"
+		"  -m      list MPSSE commands\n"
+		"  -s      statistics only\n"
+		"  -c pin  RA8875 chip select (default D3)\n");
+	return 1;
+}
+
+int main(int argc, char* argv[])
+{
+	bool mpsse = false;
+	bool quiet = false;
+	int cs = 3;
+	const char* path = nullptr;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-m") == 0)
+			mpsse = true;
+		else if (strcmp(argv[i], "-s") == 0)
+			quiet = true;
+		else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+		{
+			cs = parsePin(argv[++i]);
+			if (cs < 0)
+				return usage();
+		}
+		else if (argv[i][0] != '-' && path == nullptr)
+			path = argv[i];
+		else
+			return usage();
+	}
+
+	if (path == nullptr)
+		return usage();
+
+	std::vector<TraceRecorder::Event> events;
+	if (!TraceRecorder::load(path, events))
+		return 1;
+
+	TraceDecoder decoder(cs, mpsse, quiet);
+	decoder.run(events);
+	decoder.printStats();
+	return 0;
+}